@@ -241,6 +241,33 @@ int main(int argc, char **argv)
       }
     }
     printf("FUZZY HITS = %.3g%%\n", 100.*hits/it);
+    // DFA states that loop back to themselves carry a SKIP opcode, check that fuzzy matching steps over SKIP and that
+    // results do not depend on the order of the states in the opcode table
+    printf("SKIP DISTANCE=1 TESTING\n");
+    const char *skip_regex_texts[] = {
+      "a[^x]*bc",     "a..bxc a---bc abxc",      "[7,6,0][14,4,1]",
+      "\"[^\"\\n]*\"", "x \"abc\" \"ab\nc\" \"q", "[2,5,0][8,3,1][13,3,0]",
+      "<[^>]*>x",     "<ab>y <c>x <d>",          "[0,5,1][6,4,0][11,3,1]",
+      "α[^β]*β",      "αabcγβ αx",               "[0,9,1][10,3,1]",
+      "(((\\*)+(\\w)?([^*])*).b[a-c])", "\nc *\nacaxxc",   "",
+      NULL, NULL, NULL };
+    for (it = 0; skip_regex_texts[it] != NULL; it += 3)
+    {
+      reflex::FuzzyMatcher matcher(skip_regex_texts[it], 1, skip_regex_texts[it + 1]);
+      std::string result;
+      char hit[64];
+      while (matcher.find())
+      {
+        snprintf(hit, sizeof(hit), "[%zu,%zu,%u]", matcher.first(), matcher.size(), matcher.edits());
+        result.append(hit);
+      }
+      printf("'%s'/'%s'\n\tfind():    %s\n", skip_regex_texts[it], skip_regex_texts[it + 1], result.c_str());
+      if (result != skip_regex_texts[it + 2])
+      {
+        fprintf(stderr, "FAILED: expected %s\n", skip_regex_texts[it + 2]);
+        exit(EXIT_FAILURE);
+      }
+    }
   }
   return 0;
 }
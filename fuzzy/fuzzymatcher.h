@@ -165,6 +165,7 @@ class FuzzyMatcher : public Matcher {
         txt(0),
         cur(0),
         pos(0),
+        num(0),
         ded(ded),
         mrk(false),
         err(0)
@@ -175,6 +176,7 @@ class FuzzyMatcher : public Matcher {
     size_t  txt;
     size_t  cur;
     size_t  pos;
+    size_t  num;
     size_t  ded;
     bool    mrk;
     uint8_t err;
@@ -216,10 +218,15 @@ class FuzzyMatcher : public Matcher {
     // no more alternatives
     if (bpt.pc1 == NULL)
       return NULL;
+    // stop backtracking when the work budget is exhausted
+    if (!step())
+      return bpt.pc1 = NULL;
     // done when no more goto opcodes on characters remain
     if (!Pattern::is_opcode_goto(*bpt.pc1))
       return bpt.pc1 = NULL;
     Pattern::Index jump = Pattern::index_of(*bpt.pc1);
+    // the last goto opcode of a state covers all chars, the opcodes after it belong to another state
+    bool last = Pattern::lo_of(*bpt.pc1) == 0x00 && Pattern::hi_of(*bpt.pc1) == 0xFF;
     // last opcode is a HALT?
     if (jump == Pattern::Const::HALT)
     {
@@ -229,11 +236,16 @@ class FuzzyMatcher : public Matcher {
       for (int i = 0; i < 3; ++i)
       {
         jump = Pattern::index_of(*bpt.pc0);
-        if (jump == Pattern::Const::HALT || pat_->opc_ + jump == bpt.pc0)
+        if (jump == Pattern::Const::HALT)
           return bpt.pc1 = NULL;
         if (jump == Pattern::Const::LONG)
           jump = Pattern::long_index_of(bpt.pc0[1]);
+        // step over SKIP, fuzzy matching does not skip ahead
         const Pattern::Opcode *pc0 = pat_->opc_ + jump;
+        if (Pattern::is_opcode_skip(*pc0))
+          ++pc0;
+        if (pc0 == bpt.pc0)
+          return bpt.pc1 = NULL;
         const Pattern::Opcode *pc1 = pc0;
         while (!Pattern::is_opcode_goto(*pc1))
           ++pc1;
@@ -245,6 +257,7 @@ class FuzzyMatcher : public Matcher {
       jump = Pattern::index_of(*bpt.pc1);
       if (jump == Pattern::Const::HALT)
         return bpt.pc1 = NULL;
+      last = Pattern::lo_of(*bpt.pc1) == 0x00 && Pattern::hi_of(*bpt.pc1) == 0xFF;
       if (jump == Pattern::Const::LONG)
         jump = Pattern::long_index_of(*++bpt.pc1);
       bpt.sub = bpt.alt;
@@ -288,6 +301,8 @@ class FuzzyMatcher : public Matcher {
       }
       bpt.sub = false;
       bpt.pc1 += !bpt.alt;
+      if (last && !bpt.alt)
+        bpt.pc1 = NULL; // no more alternatives after the last goto opcode of the state
     }
     else if (del_)
     {
@@ -295,6 +310,8 @@ class FuzzyMatcher : public Matcher {
       DBGLOG("Delete: jump to %u at pos %zu char %d (0x%x)", jump, pos_, c1, c1);
       bpt.sub = bpt.alt;
       ++bpt.pc1;
+      if (last)
+        bpt.pc1 = NULL; // no more alternatives after the last goto opcode of the state
     }
     else
     {
@@ -347,8 +364,8 @@ redo:
           DBGLOG("Fetch: code[%zu] = 0x%08X", pc - pat_->opc_, opcode);
           if (!Pattern::is_opcode_goto(opcode))
           {
-            // save backtrack point (DFA and relative position in the match)
-            pc0 = pc;
+            // save backtrack point (DFA and relative position in the match), step over SKIP
+            pc0 = Pattern::is_opcode_skip(opcode) ? pc + 1 : pc;
             len0 = pos_ - (txt_ - buf_);
             switch (opcode >> 24)
             {
@@ -383,6 +400,9 @@ redo:
                   ++pc;
                   continue;
                 }
+              case 0xFA: // SKIP
+                ++pc; // do not skip ahead, fuzzy matching needs every byte to backtrack on edits
+                continue;
 #if !defined(WITH_NO_INDENT)
               case Pattern::META_DED - Pattern::META_MIN:
                 if (ded_ > 0)
@@ -439,6 +459,7 @@ redo:
                         continue;
                       }
                     case 0xFB: // HEAD
+                    case 0xFA: // SKIP
                       opcode = *++pc;
                       continue;
 #if !defined(WITH_NO_INDENT)
@@ -649,8 +670,8 @@ redo:
             DBGLOG("Get: c1 = %d (0x%x) at pos %zu", c1, c1, pos_ - 1);
             if (bin_ || (c1 & 0xC0) != 0x80 || c1 == EOF)
             {
-              // save backtrack point (DFA and relative position in the match)
-              pc0 = pc;
+              // save backtrack point (DFA and relative position in the match), step over SKIP
+              pc0 = Pattern::is_opcode_skip(*pc) ? pc + 1 : pc;
               len0 = pos_ - (txt_ - buf_);
             }
             if (c1 == EOF)
@@ -854,8 +875,11 @@ unrolled:
         }
       }
     }
+    // if interrupted in the second pass then resume at the match found in the first pass
+    if (brk_ && sst.use)
+      brp_ = sst.num + sst.txt;
     // if fuzzy find/split with errors then perform a second pass ahead of this match to check for an exact match
-    if (cap_ > 0 && err_ > 0 && !sst.use && (method == Const::FIND || method == Const::SPLIT))
+    if (cap_ > 0 && err_ > 0 && !sst.use && !brk_ && (method == Const::FIND || method == Const::SPLIT))
     {
       // this part is based on advance() in matcher.cpp, limited to advancing ahead till the one of the first pattern char(s) match excluding \n
       size_t loc = txt_ - buf_ + 1;
@@ -879,6 +903,7 @@ unrolled:
             sst.txt = txt_ - buf_;
             sst.cur = cur_;
             sst.pos = pos_;
+            sst.num = num_;
             size_t tmp = ded_;
             ded_ = sst.ded;
             sst.ded = tmp;
@@ -901,6 +926,7 @@ unrolled:
           sst.txt = txt_ - buf_;
           sst.cur = cur_;
           sst.pos = pos_;
+          sst.num = num_;
           size_t tmp = ded_;
           ded_ = sst.ded;
           sst.ded = tmp;
@@ -52,6 +52,11 @@
 #define WITH_SPAN 1
 #endif
 
+/// This compile-time option enables the performance counters returned by stats().
+#ifndef WITH_STATS
+#define WITH_STATS 0
+#endif
+
 #include <reflex/convert.h>
 #include <reflex/debug.h>
 #include <reflex/input.h>
@@ -60,6 +65,11 @@
 #include <cstdlib>
 #include <cctype>
 #include <iterator>
+#include <atomic>
+#include <chrono>
+#if !defined(__WIN32__) && !defined(_WIN32) && !defined(WIN32) && !defined(_WIN64) && !defined(__BORLANDC__)
+#include <sys/mman.h>
+#endif
 
 namespace reflex {
 
@@ -72,7 +82,9 @@ inline int isword(int c) ///< Character to check
 
 /// The abstract matcher base class template defines an interface for all pattern matcher engines.
 /**
-The buffer expands when matches do not fit.  The buffer size is initially BUFSZ.
+The buffer expands when matches do not fit.  The initial buffer size is selected
+by the buffer policy, see buffer_policy(), which is BUFSZ by default when the
+input size is unknown.
 
 ```
       _________________
@@ -119,8 +131,11 @@ class AbstractMatcher {
 #else
     static const size_t BOLSZ = REFLEX_BOLSZ;
 #endif
+    static const size_t LARGE = (2*1024*1024); ///< max buffer size selected for large inputs by the default buffer policy and the transparent huge page size
     static const size_t REDO  = 0x7FFFFFFF; ///< reflex::Matcher::accept() returns "redo" with reflex::Matcher option "A"
+    static const size_t INTR  = 0x7FFFFFFE; ///< accept() returns "interrupted" when the work budget is exhausted or matching was cancelled, the match methods return zero
     static const size_t EMPTY = 0xFFFFFFFF; ///< accept() returns "empty" last split at end of input
+    static const size_t UNLIMITED = static_cast<size_t>(-1); ///< no limit on the work budget
   };
   /// Context returned by before() and after()
   struct Context {
@@ -145,6 +160,34 @@ class AbstractMatcher {
     virtual void operator()(AbstractMatcher&, const char*, size_t, size_t) = 0;
     virtual ~Handler() { };
   };
+  /// Performance counters returned by stats(), counted only when compiled with WITH_STATS enabled.
+  struct Stats {
+    Stats()
+      :
+        attempts(0),
+        scanned(0),
+        advances(0),
+        skipped(0),
+        hits(0),
+        misses(0),
+        shifts(0),
+        reallocs(0),
+        refills(0),
+        bytes(0),
+        converted(0)
+    { }
+    size_t attempts;  ///< number of match attempts made by the DFA
+    size_t scanned;   ///< number of bytes scanned by the DFA, i.e. the number of DFA transitions
+    size_t advances;  ///< number of times advance() searched ahead for a match candidate
+    size_t skipped;   ///< number of bytes skipped by advance()
+    size_t hits;      ///< number of match candidates found by advance() with its needles and predict_match()
+    size_t misses;    ///< number of match candidates found by advance() that the DFA rejected (false positives)
+    size_t shifts;    ///< number of times the buffer contents were shifted to make room for more input
+    size_t reallocs;  ///< number of times the buffer was enlarged
+    size_t refills;   ///< number of times input was read into the buffer
+    size_t bytes;     ///< number of bytes of input read into the buffer
+    size_t converted; ///< number of bytes of input read into the buffer that were converted to UTF-8
+  };
  protected:
   /// AbstractMatcher::Options for matcher engines.
   struct Option {
@@ -221,7 +264,7 @@ class AbstractMatcher {
     Iterator& operator++()
       /// @returns reference to this iterator
     {
-      if (matcher_->match(method_) == 0)
+      if (!matcher_->perform(method_))
         matcher_ = NULL;
       return *this;
     }
@@ -241,7 +284,7 @@ class AbstractMatcher {
         matcher_(matcher),
         method_(method)
     {
-      if (matcher_ && matcher_->match(method_) == 0)
+      if (matcher_ && !matcher_->perform(method_))
         matcher_ = NULL;
     }
    private:
@@ -271,9 +314,9 @@ class AbstractMatcher {
     }
     /// AbstractMatcher::Operation() matches input to a pattern using method Const::SCAN, Const::FIND, or Const::SPLIT.
     size_t operator()() const
-      /// @returns value of accept() >= 1 for match or 0 for end of matches
+      /// @returns value of accept() >= 1 for match or 0 for end of matches or when interrupted()
     {
-      return matcher_->match(method_);
+      return matcher_->perform(method_);
     }
     /// AbstractMatcher::Operation.begin() returns a std::input_iterator to the start of the matches.
     iterator begin() const
@@ -310,7 +353,8 @@ class AbstractMatcher {
     :
       scan(this, Const::SCAN),
       find(this, Const::FIND),
-      split(this, Const::SPLIT)
+      split(this, Const::SPLIT),
+      cnl_(false)
   {
     in = input;
     init(opt);
@@ -322,7 +366,8 @@ class AbstractMatcher {
     :
       scan(this, Const::SCAN),
       find(this, Const::FIND),
-      split(this, Const::SPLIT)
+      split(this, Const::SPLIT),
+      cnl_(false)
   {
     in = input;
     init();
@@ -333,17 +378,7 @@ class AbstractMatcher {
   {
     DBGLOG("AbstractMatcher::~AbstractMatcher()");
     if (own_)
-    {
-#if WITH_REALLOC
-#if defined(__WIN32__) || defined(_WIN32) || defined(WIN32) || defined(_WIN64) || defined(__BORLANDC__)
-      _aligned_free(static_cast<void*>(buf_));
-#else
-      std::free(static_cast<void*>(buf_));
-#endif
-#else
-      delete[] buf_;
-#endif
-    }
+      free_buffer();
   }
   /// Polymorphic cloning.
   virtual AbstractMatcher *clone() = 0;
@@ -379,22 +414,21 @@ class AbstractMatcher {
         }
       }
     }
-    if (!own_)
+    if (iob_ != NULL)
     {
-      max_ = Const::BUFSZ;
-#if WITH_REALLOC
-#if defined(__WIN32__) || defined(_WIN32) || defined(WIN32) || defined(_WIN64) || defined(__BORLANDC__)
-      buf_ = static_cast<char*>(_aligned_malloc(max_, 4096));
-      if (buf_ == NULL)
-        throw std::bad_alloc();
-#else
-      buf_ = NULL;
-      if (posix_memalign(reinterpret_cast<void**>(&buf_), 4096, max_) != 0)
-        throw std::bad_alloc();
-#endif
-#else
-      buf_ = new char[max_];
-#endif
+      // stop scanning an iovec segment in place, see place()
+      buf_ = iob_;
+      max_ = iom_;
+      iob_ = NULL;
+    }
+    size_t size = buffer_size();
+    if (!own_ || size > max_ || (bsh_ && size < max_ / 4))
+    {
+      // allocate a new buffer, or replace the buffer when it is too small, or too large for the input set with input()
+      if (own_)
+        free_buffer();
+      buf_ = alloc_buffer(size);
+      max_ = size;
     }
     buf_[0] = '\0';
     txt_ = buf_;
@@ -421,6 +455,138 @@ class AbstractMatcher {
     own_ = true;
     eof_ = false;
     mat_ = false;
+    brk_ = false;
+    wat_ = false;
+    sus_ = false;
+    lim_ = Const::UNLIMITED;
+    stp_ = Const::UNLIMITED;
+    dln_ = false;
+    bsh_ = false;
+  }
+  /// Set a work budget to interrupt matching when exhausted, the budget is checked when the buffer is filled with more input and by backtracking matchers.
+  void budget(
+      size_t bytes,     ///< max number of input bytes to read from now on, 0 for no limit
+      size_t steps = 0, ///< max number of backtracking steps from now on (FuzzyMatcher, PCRE2Matcher, BoostMatcher), 0 for no limit
+      size_t msec = 0)  ///< time limit in milliseconds from now on, 0 for no limit
+  {
+    lim_ = bytes > 0 ? num_ + end_ + bytes : Const::UNLIMITED;
+    stp_ = steps > 0 ? steps : Const::UNLIMITED;
+    dln_ = msec > 0;
+    if (dln_)
+      ddl_ = std::chrono::steady_clock::now() + std::chrono::milliseconds(msec);
+  }
+  /// Set the buffer policy of this matcher, takes effect when the input is (re)set with input() or reset().
+  void buffer_policy(
+      size_t init,          ///< initial buffer size, 0 to select the size from the input size when known (default)
+      size_t max = 0,       ///< max buffer size, 0 for no limit, std::bad_alloc is thrown when a match does not fit
+      size_t factor = 2,    ///< growth factor 2 or greater to expand the buffer (default 2)
+      bool   huge = false)  ///< true to align buffers of Const::LARGE bytes and larger to transparent huge pages
+  {
+    bsz_ = init;
+    bmx_ = max > 0 && max < Const::BLOCK + 2 ? Const::BLOCK + 2 : max;
+    bgf_ = factor < 2 ? 2 : factor;
+    bhp_ = huge;
+    bsh_ = true;
+  }
+  /// Returns the current size of the buffer of this matcher.
+  size_t buffer_capacity() const
+    /// @returns buffer size in bytes
+  {
+    return max_;
+  }
+  /// Returns the total size of the buffers currently allocated by all matchers.
+  static size_t buffer_memory()
+    /// @returns total buffer size in bytes
+  {
+    return memory().load(std::memory_order_relaxed);
+  }
+  /// Cancel matching, may be invoked by another thread, use cancel(false) before resuming matching.
+  void cancel(bool flag = true) ///< true to cancel, false to permit matching
+  {
+    cnl_.store(flag, std::memory_order_relaxed);
+  }
+  /// Returns true if matching was interrupted by the work budget or was cancelled, i.e. a zero returned by scan, find, split, or matches is not the end of the input, the interrupted match is resumed by the next scan, find, or split.
+  bool interrupted() const
+    /// @returns true if interrupted
+  {
+    return cap_ == Const::INTR;
+  }
+  /// Perform the match method, returns zero with interrupted() true when interrupted by the work budget or cancelled, the interrupted match is resumed by the next invocation.
+  size_t perform(Method method) ///< match method Const::SCAN, Const::FIND, Const::SPLIT, or Const::MATCH
+    /// @returns nonzero when input matched the pattern, zero otherwise or when interrupted()
+  {
+    if (cnl_.load(std::memory_order_relaxed) || (dln_ && std::chrono::steady_clock::now() >= ddl_))
+    {
+      if (sus_)
+        roll_back();
+      reset_text();
+      txt_ = buf_ + cur_;
+      len_ = 0;
+      cap_ = Const::INTR;
+      return 0;
+    }
+    size_t cap = match(method);
+    // at the end of an input of the inputs() list, continue with the next input
+    while (cap == 0 && !brk_ && method != Const::MATCH && sid_ + 1 < src_.size() && hit_end())
+    {
+      columns_lineno();
+      next_input();
+      cap = match(method);
+    }
+    if (!brk_)
+      return cap;
+    brk_ = false;
+    wat_ = false;
+    eof_ = brf_;
+    // roll back to the start of the interrupted match unless match() suspended it, the input that was read is kept in the buffer
+    if (!sus_)
+      roll_back();
+    cap_ = Const::INTR;
+    return 0;
+  }
+  /// Search the input for up to n matches and store their properties in columns, i.e. the arrays first[], size[], accept[], and lineno[] of n elements each, where NULL arrays are skipped.
+  size_t find_columns(
+      size_t  n,              ///< max number of matches to store
+      size_t *first,          ///< array of match positions first() or NULL
+      size_t *size,           ///< array of match sizes size() or NULL
+      size_t *accept,         ///< array of match accept indices accept() or NULL
+      size_t *lineno = NULL,  ///< array of match line numbers lineno() or NULL
+      size_t *source = NULL)  ///< array of match input indices source() or NULL
+    /// @returns number of matches stored, less than n when the end of the input was reached or when interrupted()
+  {
+    size_t k = 0;
+    // lineno[] stores the buffer offsets of the matches until columns_lineno() counts the lines in one pass
+    cln_ = lineno;
+    clj_ = 0;
+    clk_ = 0;
+    try
+    {
+      while (k < n)
+      {
+        size_t cap = perform(Const::FIND);
+        if (cap == 0)
+          break;
+        if (first != NULL)
+          first[k] = num_ + (txt_ - buf_);
+        if (size != NULL)
+          size[k] = len_;
+        if (accept != NULL)
+          accept[k] = cap;
+        if (lineno != NULL)
+          lineno[k] = txt_ - buf_;
+        if (source != NULL)
+          source[k] = sid_;
+        clk_ = ++k;
+      }
+    }
+    catch (...)
+    {
+      cln_ = NULL;
+      throw;
+    }
+    columns_lineno();
+    cln_ = NULL;
+    return k;
   }
   /// Set buffer block size for reading: use 0 (or omit argument) to buffer all input in which case returns true if all the data could be read and false if a read error occurred.
   bool buffer(size_t blk = 0) ///< new block size between 1 and Const::BLOCK, or 0 to buffer all input (default)
@@ -436,12 +602,12 @@ class AbstractMatcher {
     if (n > 0)
     {
       (void)grow(n + 1); // now attempt to fetch all (remaining) data to store in the buffer, +1 for a final \0
-      end_ += get(buf_, n);
+      end_ += refill(buf_ + end_, n);
     }
     while (in.good()) // there is more to get while good(), e.g. via wrap()
     {
       (void)grow();
-      size_t len = get(buf_ + end_, max_ - end_);
+      size_t len = refill(buf_ + end_, max_ - end_);
       if (len == 0)
         break;
       end_ += len;
@@ -498,6 +664,17 @@ class AbstractMatcher {
   {
     return in.get(s, n);
   }
+  /// Returns the performance counters of this matcher, which are always zero unless compiled with WITH_STATS enabled.
+  const Stats& stats() const
+    /// @returns reference to the counters
+  {
+    return cnt_;
+  }
+  /// Reset the performance counters to zero.
+  void reset_stats()
+  {
+    cnt_ = Stats();
+  }
   /// Returns true if wrapping of input after EOF is supported.
   virtual bool wrap()
     /// @returns true if input was succesfully wrapped
@@ -509,10 +686,31 @@ class AbstractMatcher {
     /// @returns this matcher
   {
     DBGLOG("AbstractMatcher::input()");
+    src_.clear();
+    sid_ = 0;
     in = input;
+    bsh_ = true;
+    reset();
+    return *this;
+  }
+  /// Set a list of inputs to search one after the other and reset/restart the matcher, a match never spans two inputs and first(), lineno() and columno() are relative to the input of the match given by source().
+  AbstractMatcher& inputs(const std::vector<Input>& inputs) ///< list of input character sequences for this matcher
+    /// @returns this matcher
+  {
+    DBGLOG("AbstractMatcher::inputs(%zu)", inputs.size());
+    src_ = inputs;
+    sid_ = 0;
+    in = src_.empty() ? Input() : src_[0];
+    bsh_ = true;
     reset();
     return *this;
   }
+  /// Returns the index of the current input in the list of inputs(), i.e. the input of the last match, or zero when a single input was set.
+  size_t source() const
+    /// @returns index of the current input
+  {
+    return sid_;
+  }
   /// Set the buffer base containing 0-terminated character data to scan in place (data may be modified), reset/restart the matcher.
   AbstractMatcher& buffer(
       char *base,  ///< base of the buffer containing 0-terminated character data
@@ -522,17 +720,7 @@ class AbstractMatcher {
     if (size > 0)
     {
       if (own_)
-      {
-#if WITH_REALLOC
-#if defined(__WIN32__) || defined(_WIN32) || defined(WIN32) || defined(_WIN64) || defined(__BORLANDC__)
-        _aligned_free(static_cast<void*>(buf_));
-#else
-        std::free(static_cast<void*>(buf_));
-#endif
-#else
-        delete[] buf_;
-#endif
-      }
+        free_buffer();
       buf_ = base;
       txt_ = buf_;
       len_ = 0;
@@ -565,11 +753,11 @@ class AbstractMatcher {
   
   /// Returns nonzero capture index (i.e. true) if the entire input matches this matcher's pattern (and internally caches the true/false result to permit repeat invocations).
   inline size_t matches()
-    /// @returns nonzero capture index if the entire input matched this matcher's pattern, zero (i.e. false) otherwise
+    /// @returns nonzero capture index if the entire input matched this matcher's pattern, zero (i.e. false) otherwise or when interrupted()
   {
     if (!mat_ && at_bob())
     {
-      mat_ = match(Const::MATCH);
+      mat_ = perform(Const::MATCH);
       if (!at_end())
         mat_ = 0;
     }
@@ -577,7 +765,7 @@ class AbstractMatcher {
   }
   /// Returns a positive integer (true) indicating the capture index of the matched text in the pattern or zero (false) for a mismatch.
   inline size_t accept() const
-    /// @returns nonzero capture index of the match in the pattern, which may be matcher dependent, or zero for a mismatch, or Const::EMPTY for the empty last split
+    /// @returns nonzero capture index of the match in the pattern, which may be matcher dependent, or zero for a mismatch, or Const::EMPTY for the empty last split, or Const::INTR when interrupted()
   {
     return cap_;
   }
@@ -656,82 +844,7 @@ class AbstractMatcher {
   {
 #if WITH_SPAN
     if (lpb_ < txt_)
-    {
-      const char *s = lpb_;
-      const char *t = txt_;
-      size_t n = 0;
-#if defined(HAVE_AVX512BW) && (!defined(_MSC_VER) || defined(_WIN64))
-      if (have_HW_AVX512BW())
-        n = simd_nlcount_avx512bw(s, t);
-      else if (have_HW_AVX2())
-        n = simd_nlcount_avx2(s, t);
-      else
-        n = simd_nlcount_sse2(s, t);
-#elif defined(HAVE_AVX2)
-      if (have_HW_AVX2())
-        n = simd_nlcount_avx2(s, t);
-      else
-        n = simd_nlcount_sse2(s, t);
-#elif defined(HAVE_SSE2)
-      n = simd_nlcount_sse2(s, t);
-#endif
-#if defined(HAVE_NEON)
-      // no ARM AArch64/NEON SIMD optimized loop? - no code that runs faster than the code below?!
-      uint32_t n0 = 0, n1 = 0;
-      while (s < t - 1)
-      {
-        n0 += s[0] == '\n';
-        n1 += s[1] == '\n';
-        s += 2;
-      }
-      n += n0 + n1 + (s < t && *s == '\n');
-#else
-      // clang/gcc 4-way auto-vectorizable loop
-      uint32_t n0 = 0, n1 = 0, n2 = 0, n3 = 0;
-      while (s < t - 3)
-      {
-        n0 += s[0] == '\n';
-        n1 += s[1] == '\n';
-        n2 += s[2] == '\n';
-        n3 += s[3] == '\n';
-        s += 4;
-      }
-      n += n0 + n1 + n2 + n3;
-      // epilogue
-      if (s < t)
-      {
-        n += *s == '\n';
-        if (++s < t)
-        {
-          n += *s == '\n';
-          if (++s < t)
-            n += *s == '\n';
-        }
-      }
-#endif
-      // if newlines are detected, then find begin of the last line to adjust bol
-      if (n > 0)
-      {
-        lno_ += n;
-        s = lpb_;
-        // clang/gcc 4-way auto-vectorizable loop
-        while (t >= s + 4)
-        {
-          if ((t[-1] == '\n') | (t[-2] == '\n') | (t[-3] == '\n') | (t[-4] == '\n'))
-            break;
-          t -= 4;
-        }
-        // epilogue
-        if (--t >= s && *t != '\n')
-          if (--t >= s && *t != '\n')
-            if (--t >= s && *t != '\n')
-              --t;
-        bol_ = t + 1;
-        cpb_ = bol_;
-        cno_ = 0;
-      }
-      lpb_ = txt_;
-    }
+      newlines(txt_, nlcount(lpb_, txt_));
 #else
     size_t n = lno_;
     size_t k = cno_;
@@ -1065,9 +1178,13 @@ class AbstractMatcher {
       return EOF;
     while (true)
     {
+      if (halt())
+        return EOF;
+      if (place())
+        return static_cast<unsigned char>(buf_[pos_]);
       if (end_ + blk_ + 1 >= max_)
         (void)grow();
-      end_ += get(buf_ + end_, blk_ > 0 ? blk_ : max_ - end_ - 1);
+      end_ += refill(buf_ + end_, blk_ > 0 ? blk_ : max_ - end_ - 1);
       if (pos_ < end_)
         return static_cast<unsigned char>(buf_[pos_]);
       DBGLOGN("peek(): EOF");
@@ -1106,7 +1223,7 @@ class AbstractMatcher {
         break;
       (void)grow();
       loc = end_;
-      end_ += get(buf_ + end_, blk_ > 0 ? blk_ : max_ - end_ - 1);
+      end_ += refill(buf_ + end_, blk_ > 0 ? blk_ : max_ - end_ - 1);
       if (loc >= end_ && !wrap())
       {
         eof_ = true;
@@ -1241,7 +1358,7 @@ class AbstractMatcher {
     {
       (void)grow();
       pos_ = end_;
-      end_ += get(buf_ + end_, blk_ > 0 ? blk_ : max_ - end_ - 1);
+      end_ += refill(buf_ + end_, blk_ > 0 ? blk_ : max_ - end_ - 1);
       if (pos_ >= end_ && !wrap())
         eof_ = true;
     }
@@ -1380,18 +1497,72 @@ class AbstractMatcher {
   {
     DBGLOG("AbstractMatcher::init(%s)", opt ? opt : "");
     own_ = false; // require allocation of a buffer
+    iob_ = NULL;
+    sid_ = 0;
+    bsz_ = 0;
+    bmx_ = 0;
+    bgf_ = 2;
+    bhp_ = false;
+    bsh_ = false;
+    cln_ = NULL;
+    clj_ = 0;
+    clk_ = 0;
     reset(opt);
   }
+  /// Continue with the next input of the inputs() list as if at the start of the input, keeps the buffer and the remaining work budget.
+  void next_input()
+  {
+    DBGLOG("AbstractMatcher::next_input(%zu)", sid_ + 1);
+    size_t lim = lim_;
+    if (lim != Const::UNLIMITED)
+      lim = lim > num_ + end_ ? lim - num_ - end_ : 0;
+    size_t stp = stp_;
+    bool dln = dln_;
+#if WITH_SPAN
+    Handler *evh = evh_;
+#endif
+    in = src_[++sid_];
+    reset();
+    lim_ = lim;
+    stp_ = stp;
+    dln_ = dln;
+#if WITH_SPAN
+    evh_ = evh;
+#endif
+  }
   /// The abstract match operation implemented by pattern matching engines derived from AbstractMatcher.
   virtual size_t match(Method method)
     /// @returns nonzero when input matched the pattern using method Const::SCAN, Const::FIND, Const::SPLIT, or Const::MATCH
     = 0;
+  /// Returns more input data with get(s, n) to fill the buffer, counts the input read when compiled with WITH_STATS enabled.
+  inline size_t refill(
+      /// @returns the nonzero number of (less or equal to n) 8-bit characters added to buffer s from the current input, or zero when EOF
+      char  *s, ///< points to the string buffer to fill with input
+      size_t n) ///< size of buffer pointed to by s
+  {
+#if WITH_STATS
+    size_t len = get(s, n);
+    ++cnt_.refills;
+    cnt_.bytes += len;
+    if (in.wstring() != NULL || (in.file() != NULL && in.file_encoding() > Input::file_encoding::utf8))
+      cnt_.converted += len;
+    return len;
+#else
+    return get(s, n);
+#endif
+  }
   /// Shift or expand the internal buffer when it is too small to accommodate more input, where the buffer size is doubled when needed, change cur_, pos_, end_, max_, ind_, buf_, bol_, lpb_, and txt_.
   inline bool grow(size_t need = Const::BLOCK) ///< optional needed space = Const::BLOCK size by default
     /// @returns true if buffer was shifted or enlarged
   {
     if (max_ - end_ >= need + 1)
       return false;
+#if WITH_TRACE
+    REFLEX_TRACE_SPAN("AbstractMatcher::grow");
+#endif
+    columns_lineno();
+    if (iob_ != NULL)
+      unplace();
 #if WITH_SPAN
     (void)lineno();
     cno_ = 0;
@@ -1416,6 +1587,9 @@ class AbstractMatcher {
       lpb_ -= gap;
       num_ += gap;
       std::memmove(buf_, buf_ + gap, end_);
+#if WITH_STATS
+      ++cnt_.shifts;
+#endif
     }
     if (max_ - end_ >= need)
     {
@@ -1423,23 +1597,13 @@ class AbstractMatcher {
     }
     else
     {
-      size_t newmax = end_ + need;
-      while (max_ < newmax)
-        max_ *= 2;
+      size_t oldmax = max_;
+      max_ = grow_size(end_ + need);
       DBGLOG("Expand buffer to %zu bytes", max_);
-#if WITH_REALLOC
-#if defined(__WIN32__) || defined(_WIN32) || defined(WIN32) || defined(_WIN64) || defined(__BORLANDC__)
-      char *newbuf = static_cast<char*>(_aligned_realloc(static_cast<void*>(buf_), max_, 4096));
-#else
-      char *newbuf = static_cast<char*>(std::realloc(static_cast<void*>(buf_), max_));
-#endif
-      if (newbuf == NULL)
-        throw std::bad_alloc();
-#else
-      char *newbuf = new char[max_];
-      std::memcpy(newbuf, buf_, end_);
-      delete[] buf_;
+#if WITH_STATS
+      ++cnt_.reallocs;
 #endif
+      char *newbuf = realloc_buffer(oldmax, buf_, end_);
       txt_ = newbuf + (txt_ - buf_);
       lpb_ = newbuf + (lpb_ - buf_);
       buf_ = newbuf;
@@ -1461,43 +1625,360 @@ class AbstractMatcher {
         std::memmove(buf_, txt_, end_);
       txt_ = buf_;
       lpb_ = buf_;
+#if WITH_STATS
+      ++cnt_.shifts;
+#endif
     }
     else
     {
-      size_t newmax = end_ - gap + need;
       size_t oldmax = max_;
-      while (max_ < newmax)
-        max_ *= 2;
+      max_ = grow_size(end_ - gap + need);
       if (oldmax < max_)
       {
         DBGLOG("Expand buffer from %zu to %zu bytes", oldmax, max_);
+#if WITH_STATS
+        ++cnt_.reallocs;
+#endif
         (void)lineno();
         cur_ -= gap;
         ind_ -= gap;
         pos_ -= gap;
         end_ -= gap;
         num_ += gap;
+        buf_ = realloc_buffer(oldmax, txt_, end_);
+        txt_ = buf_;
+        lpb_ = buf_;
+      }
+    }
+#endif
+    return true;
+  }
+#if WITH_SPAN
+  /// Returns the number of newlines in the range s to t.
+  static inline size_t nlcount(
+      const char *s, ///< start of the range
+      const char *t) ///< end of the range
+    /// @returns number of newlines
+  {
+    size_t n = 0;
+#if defined(HAVE_AVX512BW) && (!defined(_MSC_VER) || defined(_WIN64))
+    if (have_HW_AVX512BW())
+      n = simd_nlcount_avx512bw(s, t);
+    else if (have_HW_AVX2())
+      n = simd_nlcount_avx2(s, t);
+    else
+      n = simd_nlcount_sse2(s, t);
+#elif defined(HAVE_AVX2)
+    if (have_HW_AVX2())
+      n = simd_nlcount_avx2(s, t);
+    else
+      n = simd_nlcount_sse2(s, t);
+#elif defined(HAVE_SSE2)
+    n = simd_nlcount_sse2(s, t);
+#endif
+#if defined(HAVE_NEON)
+    // no ARM AArch64/NEON SIMD optimized loop? - no code that runs faster than the code below?!
+    uint32_t n0 = 0, n1 = 0;
+    while (s < t - 1)
+    {
+      n0 += s[0] == '\n';
+      n1 += s[1] == '\n';
+      s += 2;
+    }
+    n += n0 + n1 + (s < t && *s == '\n');
+#else
+    // clang/gcc 4-way auto-vectorizable loop
+    uint32_t n0 = 0, n1 = 0, n2 = 0, n3 = 0;
+    while (s < t - 3)
+    {
+      n0 += s[0] == '\n';
+      n1 += s[1] == '\n';
+      n2 += s[2] == '\n';
+      n3 += s[3] == '\n';
+      s += 4;
+    }
+    n += n0 + n1 + n2 + n3;
+    // epilogue
+    if (s < t)
+    {
+      n += *s == '\n';
+      if (++s < t)
+      {
+        n += *s == '\n';
+        if (++s < t)
+          n += *s == '\n';
+      }
+    }
+#endif
+    return n;
+  }
+  /// Advance the line number by n newlines counted from lpb_ to t and move lpb_ to t.
+  inline void newlines(
+      const char *t, ///< new lpb_ position
+      size_t      n) ///< number of newlines from lpb_ to t
+  {
+    // if newlines are detected, then find begin of the last line to adjust bol
+    if (n > 0)
+    {
+      const char *s = lpb_;
+      const char *e = t;
+      lno_ += n;
+      // clang/gcc 4-way auto-vectorizable loop
+      while (e >= s + 4)
+      {
+        if ((e[-1] == '\n') | (e[-2] == '\n') | (e[-3] == '\n') | (e[-4] == '\n'))
+          break;
+        e -= 4;
+      }
+      // epilogue
+      if (--e >= s && *e != '\n')
+        if (--e >= s && *e != '\n')
+          if (--e >= s && *e != '\n')
+            --e;
+      bol_ = e + 1;
+      cpb_ = bol_;
+      cno_ = 0;
+    }
+    lpb_ = t;
+  }
+#endif
+  /// Replace the buffer offsets of the matches of find_columns() that are stored in lineno[] by their line numbers, in one pass over the buffer, before the buffer is shifted, replaced or reset.
+  void columns_lineno()
+  {
+    if (cln_ == NULL || clj_ >= clk_)
+      return;
+#if WITH_SPAN
+    const char *s = lpb_;
+    size_t n = 0;
+    for (; clj_ < clk_; ++clj_)
+    {
+      const char *t = buf_ + cln_[clj_];
+      n += nlcount(s, t);
+      s = t;
+      cln_[clj_] = lno_ + n;
+    }
+    newlines(s, n);
+#else
+    const char *txt = txt_;
+    for (; clj_ < clk_; ++clj_)
+    {
+      txt_ = buf_ + cln_[clj_];
+      cln_[clj_] = lineno();
+    }
+    txt_ = txt;
+#endif
+  }
+  /// Scan the rest of the current iovec segment in place when the buffer is empty or full and the buffered data to keep is a part of this segment, the matcher's own buffer is set aside until unplace() copies the data to keep at the end of the segment back to it.
+  inline bool place()
+    /// @returns true if AbstractMatcher::buf_ points to the segment
+  {
+    if (iob_ != NULL || blk_ > 0 || in.iov() == NULL || (end_ > 0 && end_ + 1 < max_))
+      return false;
+    size_t loc, len;
+    char *seg = in.iov_segment(loc, len);
+    if (seg == NULL || len - loc <= Const::BLOCK || loc > end_)
+      return false;
+    // the first loc bytes of the segment are buffered at buf_ + gap
+    size_t gap = end_ - loc;
+    columns_lineno();
+    (void)lineno();
+#if WITH_SPAN
+    if (bol_ < buf_ + gap)
+      return false;
+    if (gap > 0 && evh_ != NULL)
+      (*evh_)(*this, buf_, gap, num_);
+    bol_ = seg + (bol_ - buf_ - gap);
+    cpb_ = seg + (cpb_ - buf_ - gap);
+#else
+    if (txt_ < buf_ + gap)
+      return false;
+#endif
+    DBGLOG("Scan segment of %zu bytes in place", len);
+    txt_ = seg + (txt_ - buf_ - gap);
+    lpb_ = seg + (lpb_ - buf_ - gap);
+    iob_ = buf_;
+    iom_ = max_;
+    buf_ = seg;
+    cur_ -= gap;
+    ind_ -= gap;
+    pos_ -= gap;
+    num_ += gap;
+    end_ = len - 1; // keep the last byte out of the buffer to make room for the \0 that text() writes
+    max_ = len;
+    if (chr_ != '\0')
+      txt_[len_] = '\0';
+    in.iov_skip(end_ - loc);
+    return true;
+  }
+  /// Stop scanning an iovec segment in place, copy the data to keep from the segment to the matcher's own buffer.
+  void unplace()
+  {
+    char *seg = buf_;
+    (void)lineno();
+#if WITH_SPAN
+    if (bol_ + Const::BOLSZ - buf_ < txt_ - bol_)
+    {
+      // this line is very long, so keep the data from the match instead of from the begin of the line, as grow() does
+      (void)columno();
+      bol_ = txt_;
+    }
+    size_t gap = bol_ - buf_;
+    if (gap > 0 && evh_ != NULL)
+      (*evh_)(*this, buf_, gap, num_);
+#else
+    size_t gap = txt_ - buf_;
+#endif
+    size_t len = end_ - gap;
+    DBGLOG("Copy %zu bytes of segment", len);
+    buf_ = iob_;
+    max_ = iom_;
+    iob_ = NULL;
+    if (len >= max_)
+    {
+      free_buffer();
+      max_ = grow_size(len + 1);
+      buf_ = alloc_buffer(max_);
+    }
+    std::memcpy(buf_, seg + gap, len);
+    if (chr_ != '\0')
+      txt_[len_] = chr_; // restore the segment, the copy keeps the \0 written by text()
+    txt_ = buf_ + (txt_ - seg - gap);
+    lpb_ = buf_ + (lpb_ - seg - gap);
+#if WITH_SPAN
+    bol_ = buf_ + (bol_ - seg - gap);
+    cpb_ = buf_ + (cpb_ - seg - gap);
+#endif
+    cur_ -= gap;
+    ind_ -= gap;
+    pos_ -= gap;
+    end_ -= gap;
+    num_ += gap;
+  }
+  /// Returns the initial buffer size for the current input selected by the buffer policy, see buffer_policy().
+  size_t buffer_size()
+    /// @returns buffer size in bytes
+  {
+    size_t size = bsz_;
+    if (size == 0)
+    {
+      // select the buffer size from the input size when the input size is known without reading the input
+      if (!in.assigned())
+        size = 64;
+      else if (in.iov() != NULL)
+        size = in.size() < 2 * Const::BLOCK - 2 ? in.size() + 2 : 2 * Const::BLOCK; // segments are scanned in place, see place()
+      else if (in.cstring() != NULL || (in.file() != NULL && in.file_encoding() <= Input::file_encoding::utf8 && in.size() > 0))
+        size = in.size() < Const::LARGE - 2 ? in.size() + 2 : Const::LARGE;
+      else
+        size = Const::BUFSZ;
+    }
+    if (bmx_ > 0 && size > bmx_)
+      size = bmx_;
+    if (bhp_ && size >= Const::LARGE)
+      size = (size + Const::LARGE - 1) & ~(Const::LARGE - 1);
+    else
+      size = (size + 63) & ~static_cast<size_t>(63);
+    return size;
+  }
+  /// Returns the new buffer size to expand the buffer to hold at least need bytes, throws std::bad_alloc when the max buffer size of the buffer policy is exceeded.
+  size_t grow_size(size_t need)
+    /// @returns new buffer size in bytes
+  {
+    if (bmx_ > 0 && need > bmx_)
+      throw std::bad_alloc();
+    size_t size = max_;
+    while (size < need)
+      size = size * bgf_;
+    if (bmx_ > 0 && size > bmx_)
+      size = bmx_;
+    if (bhp_ && size >= Const::LARGE)
+      size = (size + Const::LARGE - 1) & ~(Const::LARGE - 1);
+    return size;
+  }
+  /// Allocate a buffer of the specified size, aligned to transparent huge pages when enabled by the buffer policy and the buffer is large.
+  char *alloc_buffer(size_t size) ///< buffer size in bytes
+    /// @returns new buffer
+  {
+    char *buf;
 #if WITH_REALLOC
-        std::memmove(buf_, txt_, end_);
+    size_t align = bhp_ && size >= Const::LARGE ? Const::LARGE : 4096;
 #if defined(__WIN32__) || defined(_WIN32) || defined(WIN32) || defined(_WIN64) || defined(__BORLANDC__)
-        char *newbuf = static_cast<char*>(_aligned_realloc(static_cast<void*>(buf_), max_, 4096));
+    buf = static_cast<char*>(_aligned_malloc(size, align));
+    if (buf == NULL)
+      throw std::bad_alloc();
 #else
-        char *newbuf = static_cast<char*>(std::realloc(static_cast<void*>(buf_), max_));
+    buf = NULL;
+    if (posix_memalign(reinterpret_cast<void**>(&buf), align, size) != 0)
+      throw std::bad_alloc();
+#ifdef MADV_HUGEPAGE
+    if (align == Const::LARGE)
+      (void)madvise(static_cast<void*>(buf), size, MADV_HUGEPAGE);
+#endif
 #endif
-        if (newbuf == NULL)
-          throw std::bad_alloc();
 #else
-        char *newbuf = new char[max_];
-        std::memcpy(newbuf, txt_, end_);
-        delete[] buf_;
+    buf = new char[size];
 #endif
-        buf_ = newbuf;
-        txt_ = buf_;
-        lpb_ = buf_;
-      }
+    memory().fetch_add(size, std::memory_order_relaxed);
+    return buf;
+  }
+  /// Replace the buffer of oldmax bytes by a buffer of max_ bytes, copying len bytes at src to the start of the new buffer.
+  char *realloc_buffer(
+      size_t      oldmax, ///< current buffer size in bytes
+      const char *src,    ///< points to the data in the current buffer to keep
+      size_t      len)    ///< length of the data to keep
+    /// @returns new buffer
+  {
+    char *newbuf;
+#if WITH_REALLOC
+    if (!bhp_ || max_ < Const::LARGE)
+    {
+      if (src != buf_ && len > 0)
+        std::memmove(buf_, src, len);
+#if defined(__WIN32__) || defined(_WIN32) || defined(WIN32) || defined(_WIN64) || defined(__BORLANDC__)
+      newbuf = static_cast<char*>(_aligned_realloc(static_cast<void*>(buf_), max_, 4096));
+#else
+      newbuf = static_cast<char*>(std::realloc(static_cast<void*>(buf_), max_));
+#endif
+      if (newbuf == NULL)
+        throw std::bad_alloc();
+      memory().fetch_add(max_ - oldmax, std::memory_order_relaxed);
+      return newbuf;
     }
 #endif
-    return true;
+    newbuf = alloc_buffer(max_);
+    std::memcpy(newbuf, src, len);
+    size_t newmax = max_;
+    max_ = oldmax;
+    free_buffer();
+    max_ = newmax;
+    return newbuf;
+  }
+  /// Delete the buffer of max_ bytes.
+  void free_buffer()
+  {
+    if (iob_ != NULL)
+    {
+      // stop scanning an iovec segment in place, see place()
+      buf_ = iob_;
+      max_ = iom_;
+      iob_ = NULL;
+    }
+#if WITH_REALLOC
+#if defined(__WIN32__) || defined(_WIN32) || defined(WIN32) || defined(_WIN64) || defined(__BORLANDC__)
+    _aligned_free(static_cast<void*>(buf_));
+#else
+    std::free(static_cast<void*>(buf_));
+#endif
+#else
+    delete[] buf_;
+#endif
+    memory().fetch_sub(max_, std::memory_order_relaxed);
+  }
+  /// Returns the counter of the total size of the buffers of all matchers.
+  static std::atomic<size_t>& memory()
+    /// @returns reference to the counter
+  {
+    static std::atomic<size_t> bytes(0);
+    return bytes;
   }
   /// Returns the next character read from the current input source.
   inline int get()
@@ -1513,9 +1994,13 @@ class AbstractMatcher {
       return EOF;
     while (true)
     {
+      if (halt())
+        return EOF;
+      if (place())
+        return static_cast<unsigned char>(buf_[pos_++]);
       if (end_ + blk_ + 1 >= max_)
         (void)grow();
-      end_ += get(buf_ + end_, blk_ > 0 ? blk_ : max_ - end_ - 1);
+      end_ += refill(buf_ + end_, blk_ > 0 ? blk_ : max_ - end_ - 1);
       if (pos_ < end_)
         return static_cast<unsigned char>(buf_[pos_++]);
       DBGLOGN("get(): EOF");
@@ -1553,6 +2038,61 @@ class AbstractMatcher {
     set_current(loc);
     txt_ = buf_ + cur_;
   }
+  /// Returns true if matching is interrupted when the work budget is exhausted or matching was cancelled, checked before the buffer is filled with more input.
+  inline bool halt()
+    /// @returns true if interrupted
+  {
+    if (brk_)
+      return true;
+    if (num_ + end_ < lim_ && !cnl_.load(std::memory_order_relaxed) && (!dln_ || std::chrono::steady_clock::now() < ddl_))
+      return false;
+    interrupt();
+    return true;
+  }
+  /// Returns true if a backtracking step can be made within the work budget, otherwise interrupts matching.
+  inline bool step()
+    /// @returns true if step can be made
+  {
+    if (stp_ == Const::UNLIMITED)
+      return true;
+    if (stp_ > 0)
+    {
+      --stp_;
+      return true;
+    }
+    interrupt();
+    return false;
+  }
+  /// Interrupt matching as if EOF was reached, the match is resumed at the start of the current match attempt.
+  inline void interrupt()
+  {
+    if (!brk_)
+    {
+      DBGLOGN("Interrupt at %zu", num_ + (txt_ - buf_));
+      brk_ = true;
+      brp_ = num_ + (txt_ - buf_);
+      brf_ = eof_;
+      eof_ = true;
+    }
+  }
+  /// Interrupt matching to wait for more input, match() may suspend the match in progress to resume it with the next match() without rescanning the input read so far.
+  inline void suspend()
+  {
+    interrupt();
+    wat_ = true;
+  }
+  /// Roll back to the start of the interrupted match to rescan the input from there.
+  inline void roll_back()
+  {
+    reset_text();
+    sus_ = false;
+    set_current(brp_ - num_);
+    if (brp_ == 0)
+      got_ = Const::BOB;
+    txt_ = buf_ + cur_;
+    len_ = 0;
+    DBGLOGN("Interrupted: resume at %zu", brp_);
+  }
   /// Get the next character and grow the buffer to make more room if necessary.
   inline int get_more()
     /// @returns the character read (unsigned char 0..255) or EOF (-1)
@@ -1562,9 +2102,13 @@ class AbstractMatcher {
       return EOF;
     while (true)
     {
+      if (halt())
+        return EOF;
+      if (place())
+        return static_cast<unsigned char>(buf_[pos_++]);
       if (end_ + blk_ + 1 >= max_)
         (void)grow();
-      end_ += get(buf_ + end_, blk_ > 0 ? blk_ : max_ - end_ - 1);
+      end_ += refill(buf_ + end_, blk_ > 0 ? blk_ : max_ - end_ - 1);
       if (pos_ < end_)
         return static_cast<unsigned char>(buf_[pos_++]);
       DBGLOGN("get_more(): EOF");
@@ -1584,9 +2128,13 @@ class AbstractMatcher {
       return EOF;
     while (true)
     {
+      if (halt())
+        return EOF;
+      if (place())
+        return static_cast<unsigned char>(buf_[pos_]);
       if (end_ + blk_ + 1 >= max_)
         (void)grow();
-      end_ += get(buf_ + end_, blk_ > 0 ? blk_ : max_ - end_ - 1);
+      end_ += refill(buf_ + end_, blk_ > 0 ? blk_ : max_ - end_ - 1);
       if (pos_ < end_)
         return static_cast<unsigned char>(buf_[pos_]);
       DBGLOGN("peek_more(): EOF");
@@ -1622,8 +2170,31 @@ class AbstractMatcher {
   size_t      cno_; ///< column number count (cached)
   size_t      num_; ///< character count of the input till bol_
   bool        own_; ///< true if AbstractMatcher::buf_ was allocated and should be deleted
+  char       *iob_; ///< the matcher's own buffer set aside while AbstractMatcher::buf_ points to an iovec segment scanned in place, or NULL
+  size_t      iom_; ///< size of the buffer AbstractMatcher::iob_
   bool        eof_; ///< input has reached EOF
   bool        mat_; ///< true if AbstractMatcher::matches() was successful
+  bool        brk_; ///< true if matching was interrupted
+  bool        brf_; ///< the eof_ state before matching was interrupted
+  size_t      brp_; ///< input position to resume the interrupted match
+  bool        wat_; ///< true if matching was interrupted to wait for more input, see suspend()
+  bool        sus_; ///< true if match() suspended the interrupted match to resume it without rescanning
+  size_t      lim_; ///< work budget: max input position to read
+  size_t      stp_; ///< work budget: remaining backtracking steps
+  bool        dln_; ///< work budget: true if ddl_ is set
+  std::chrono::steady_clock::time_point ddl_; ///< work budget: deadline
+  Stats       cnt_; ///< performance counters, see WITH_STATS
+  std::vector<Input> src_; ///< list of inputs set with inputs(), the current input is in
+  size_t      sid_; ///< index of the current input in src_
+  size_t      bsz_; ///< buffer policy: initial buffer size or 0 to select from the input size
+  size_t      bmx_; ///< buffer policy: max buffer size or 0 for no limit
+  size_t      bgf_; ///< buffer policy: buffer growth factor
+  bool        bhp_; ///< buffer policy: true if large buffers are aligned to transparent huge pages
+  bool        bsh_; ///< buffer policy: true if reset() may shrink the buffer, set by input(), inputs() and buffer_policy() but not when continuing with the next input of inputs()
+  size_t     *cln_; ///< find_columns(): lineno[] array with the buffer offsets of the matches whose line numbers are pending, or NULL
+  size_t      clj_; ///< find_columns(): index of the first match in cln_[] with a pending line number
+  size_t      clk_; ///< find_columns(): index after the last match in cln_[] with a pending line number
+  std::atomic<bool> cnl_; ///< true if matching is cancelled
 };
 
 /// The pattern matcher class template extends abstract matcher base class.
@@ -0,0 +1,268 @@
+/******************************************************************************\
+* Copyright (c) 2016, Robert van Engelen, Genivia Inc. All rights reserved.    *
+*                                                                              *
+* Redistribution and use in source and binary forms, with or without           *
+* modification, are permitted provided that the following conditions are met:  *
+*                                                                              *
+*   (1) Redistributions of source code must retain the above copyright notice, *
+*       this list of conditions and the following disclaimer.                  *
+*                                                                              *
+*   (2) Redistributions in binary form must reproduce the above copyright      *
+*       notice, this list of conditions and the following disclaimer in the    *
+*       documentation and/or other materials provided with the distribution.   *
+*                                                                              *
+*   (3) The name of the author may not be used to endorse or promote products  *
+*       derived from this software without specific prior written permission.  *
+*                                                                              *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF         *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO   *
+* EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,       *
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, *
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;  *
+* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,     *
+* WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR      *
+* OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF       *
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                                   *
+\******************************************************************************/
+
+/**
+@file      async.h
+@brief     asynchronous matching of input that is fed to a matcher in chunks
+@author    Robert van Engelen - engelen@genivia.com
+@copyright (c) 2016-2024, Robert van Engelen, Genivia Inc. All rights reserved.
+@copyright (c) BSD-3 License - see LICENSE.txt
+*/
+
+#ifndef REFLEX_ASYNC_H
+#define REFLEX_ASYNC_H
+
+#include <reflex/matcher.h>
+#include <string>
+
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+#include <coroutine>
+#define REFLEX_ASYNC_COROUTINES 1
+#endif
+
+namespace reflex {
+
+/// Asynchronous matcher class template extends a matcher class with input that is fed to the matcher in chunks, matching is suspended when more input is needed.
+/**
+Input data is added with feed() as it arrives, for example when a socket is
+readable, and close() marks the end of the input.  When a match needs more
+input than was fed so far, scan(), find() and split() return zero and
+waiting() returns true.  The interrupted match is resumed by the next scan(),
+find() or split() after more input was fed.  A reflex::Matcher suspends the
+match in its DFA state to continue with the next chunk without rescanning the
+input of the match, other matchers roll back to the start of the match.
+
+When compiled with C++20 coroutines, async_scan(), async_find() and
+async_split() return an awaitable that suspends the awaiting coroutine until a
+match is found or the end of the input is reached.  The coroutine is resumed by
+feed() or close(), i.e. by the thread that feeds the input, for example the
+thread that runs an epoll loop:
+
+```{.cpp}
+    Task tokenize(reflex::AsyncMatcher<>& matcher) // Task is a coroutine type
+    {
+      while (size_t accept = co_await matcher.async_scan())
+        handle_token(accept, matcher.text());
+    }
+```
+*/
+template<typename M = Matcher> /// @tparam <M> matcher class to extend, e.g. reflex::Matcher
+class AsyncMatcher : public M {
+ public:
+  typedef typename M::Const Const; ///< matcher constants
+  /// Construct an asynchronous matcher from a pattern and options.
+  template<typename P>
+  AsyncMatcher(
+      const P&    pattern,    ///< a pattern or a string regex for this matcher
+      const char *opt = NULL) ///< option string of the form `(A|N|T(=[[:digit:]])?|;)*`
+    :
+      M(pattern, Input(), opt),
+      dpo_(0),
+      eos_(false),
+      wait_(false)
+#ifdef REFLEX_ASYNC_COROUTINES
+      , hdl_(nullptr),
+      met_(Const::SCAN),
+      res_(0)
+#endif
+  { }
+  /// Copy constructor, copies the input fed so far but not an awaiting coroutine.
+  AsyncMatcher(const AsyncMatcher& matcher) ///< matcher to copy
+    :
+      M(matcher),
+      dat_(matcher.dat_),
+      dpo_(matcher.dpo_),
+      eos_(matcher.eos_),
+      wait_(matcher.wait_)
+#ifdef REFLEX_ASYNC_COROUTINES
+      , hdl_(nullptr),
+      met_(Const::SCAN),
+      res_(0)
+#endif
+  { }
+  /// Polymorphic cloning.
+  virtual AsyncMatcher *clone()
+  {
+    return new AsyncMatcher(*this);
+  }
+  /// Feed a chunk of input data to this matcher, resumes an awaiting coroutine when the awaited match is complete.
+  void feed(
+      const char *data, ///< points to the input data, which is copied
+      size_t      size) ///< size of the input data in bytes
+  {
+    if (dpo_ > 0 && dpo_ == dat_.size())
+    {
+      dat_.clear();
+      dpo_ = 0;
+    }
+    dat_.append(data, size);
+#ifdef REFLEX_ASYNC_COROUTINES
+    resume();
+#endif
+  }
+  /// Mark the end of the input, resumes an awaiting coroutine.
+  void close()
+  {
+    eos_ = true;
+#ifdef REFLEX_ASYNC_COROUTINES
+    resume();
+#endif
+  }
+  /// Returns true if the last scan(), find() or split() returned zero to wait for more input to be fed, i.e. not at the end of the input.
+  bool waiting() const
+    /// @returns true if more input is needed
+  {
+    return wait_ && this->interrupted();
+  }
+  /// Returns true if close() was called.
+  bool closed() const
+    /// @returns true if the end of the input was marked
+  {
+    return eos_;
+  }
+  /// Returns the number of bytes fed that were not yet read by the matcher.
+  size_t pending() const
+    /// @returns number of bytes
+  {
+    return dat_.size() - dpo_;
+  }
+#ifdef REFLEX_ASYNC_COROUTINES
+  /// Awaitable returned by async_scan(), async_find() and async_split().
+  class Awaiter {
+   public:
+    /// Construct an awaitable to perform a match with the specified method.
+    Awaiter(
+        AsyncMatcher *matcher, ///< the matcher
+        int           method)  ///< Const::SCAN, Const::FIND or Const::SPLIT
+      :
+        matcher_(matcher),
+        method_(method)
+    { }
+    /// Perform the match, returns false to suspend the awaiting coroutine when more input is needed.
+    bool await_ready()
+      /// @returns true if the match completed
+    {
+      matcher_->res_ = matcher_->perform(method_);
+      return !matcher_->waiting();
+    }
+    /// Suspend the awaiting coroutine until feed() or close() completes the match.
+    void await_suspend(std::coroutine_handle<> handle) ///< the awaiting coroutine
+    {
+      matcher_->hdl_ = handle;
+      matcher_->met_ = method_;
+    }
+    /// Returns the result of the match.
+    size_t await_resume() const
+      /// @returns nonzero capture index of the match, zero at the end of the input or when interrupted() by the work budget or cancelled
+    {
+      return matcher_->res_;
+    }
+   private:
+    AsyncMatcher *matcher_; ///< the matcher
+    int           method_;  ///< the method to perform
+  };
+  /// Scan the input asynchronously, suspends the awaiting coroutine until a token is scanned or the end of the input is reached.
+  Awaiter async_scan()
+    /// @returns awaitable with the result of scan()
+  {
+    return Awaiter(this, Const::SCAN);
+  }
+  /// Search the input asynchronously, suspends the awaiting coroutine until a match is found or the end of the input is reached.
+  Awaiter async_find()
+    /// @returns awaitable with the result of find()
+  {
+    return Awaiter(this, Const::FIND);
+  }
+  /// Split the input asynchronously, suspends the awaiting coroutine until the next split is found or the end of the input is reached.
+  Awaiter async_split()
+    /// @returns awaitable with the result of split()
+  {
+    return Awaiter(this, Const::SPLIT);
+  }
+#endif
+ protected:
+  /// Returns more input data that was fed to this matcher.
+  virtual size_t get(
+      /// @returns the nonzero number of (less or equal to n) 8-bit characters added to buffer s, or zero when no input is available
+      char  *s, ///< points to the string buffer to fill with input
+      size_t n) ///< size of buffer pointed to by s
+  {
+    size_t k = dat_.size() - dpo_;
+    if (k > n)
+      k = n;
+    std::memcpy(s, dat_.data() + dpo_, k);
+    dpo_ += k;
+    if (k > 0)
+    {
+      wait_ = false;
+    }
+    else if (!eos_)
+    {
+      // the matcher needs more input than was fed, also when it still has input buffered to search
+      wait_ = true;
+      this->suspend();
+    }
+    return k;
+  }
+  /// Interrupts matching to wait for more input when no input is available and close() was not called.
+  virtual bool wrap()
+    /// @returns false
+  {
+    wait_ = !eos_;
+    if (wait_)
+      this->suspend();
+    return false;
+  }
+#ifdef REFLEX_ASYNC_COROUTINES
+  /// Resume the awaiting coroutine when its match completes with the input fed so far.
+  void resume()
+  {
+    if (!hdl_)
+      return;
+    res_ = this->perform(met_);
+    if (waiting())
+      return;
+    std::coroutine_handle<> handle = hdl_;
+    hdl_ = nullptr;
+    handle.resume();
+  }
+#endif
+  std::string dat_;  ///< input fed to this matcher
+  size_t      dpo_;  ///< position in dat_ of the input not yet read by the matcher
+  bool        eos_;  ///< true if close() was called
+  bool        wait_; ///< true if matching was interrupted to wait for more input
+#ifdef REFLEX_ASYNC_COROUTINES
+  std::coroutine_handle<> hdl_; ///< the awaiting coroutine or null
+  int                     met_; ///< the method performed by the awaiting coroutine
+  size_t                  res_; ///< result of the last match performed for the awaiting coroutine
+#endif
+};
+
+} // namespace reflex
+
+#endif
@@ -188,6 +188,8 @@ class BoostMatcher : public PatternMatcher<boost::regex> {
     /// @returns nonzero when input matched the pattern using method Const::SCAN, Const::FIND, Const::SPLIT, or Const::MATCH.
   {
     DBGLOG("BEGIN BoostMatcher::match(%d)", method);
+    if (cap_ == Const::INTR) // resume an interrupted match with a new iterator
+      itr_ = fin_;
     reset_text();
     txt_ = buf_ + cur_; // set first of text(), cur_ was last pos_, or cur_ was set with more()
     cur_ = pos_;
@@ -196,7 +198,7 @@ class BoostMatcher : public PatternMatcher<boost::regex> {
       if ((*itr_)[0].second == buf_ + pos_) // if last of regex iterator is still valid in buf_[] then
       {
         DBGLOGN("Continue iterating, pos = %zu", pos_);
-        ++itr_;
+        next_itr();
         if (itr_ != fin_) // set pos_ to last of the (partial) match
           pos_ = (*itr_)[0].second - buf_;
       }
@@ -266,7 +268,7 @@ class BoostMatcher : public PatternMatcher<boost::regex> {
         pos_ = (*itr_)[0].second - buf_; // set pos_ to last of the (partial) match
         if (pos_ == cur_ && !at_bob()) // match is at same pos as previous
         {
-          ++itr_; // advance to next match
+          next_itr(); // advance to next match
           if (itr_ != fin_)
             pos_ = (*itr_)[0].second - buf_; // set pos_ to last of the (partial) match
           else
@@ -333,10 +335,15 @@ class BoostMatcher : public PatternMatcher<boost::regex> {
     DBGLOG("END BoostMatcher::match()");
     return cap_;
   }
-  /// Create a new boost::regex iterator to (continue to) advance over input.
+  /// Create a new boost::regex iterator to (continue to) advance over input, the search takes a step of the work budget.
   inline void new_itr(Method method)
   {
     DBGLOGN("New iterator");
+    if (!step())
+    {
+      itr_ = fin_;
+      return;
+    }
     boost::match_flag_type flg = flg_;
     if (!at_bob())
       flg |= boost::regex_constants::match_not_bob;
@@ -353,6 +360,14 @@ class BoostMatcher : public PatternMatcher<boost::regex> {
     ASSERT(pat_ != NULL);
     itr_ = boost::cregex_iterator(txt_, buf_ + end_, *pat_, flg);
   }
+  /// Advance the boost::regex iterator to the next match, the search takes a step of the work budget.
+  inline void next_itr()
+  {
+    if (step())
+      ++itr_;
+    else
+      itr_ = fin_;
+  }
   boost::match_flag_type flg_; ///< boost::regex match flags
   boost::cregex_iterator itr_; ///< const boost::regex iterator
   boost::cregex_iterator fin_; ///< const boost::regex iterator final end
@@ -0,0 +1,240 @@
+/******************************************************************************\
+* Copyright (c) 2016, Robert van Engelen, Genivia Inc. All rights reserved.    *
+*                                                                              *
+* Redistribution and use in source and binary forms, with or without           *
+* modification, are permitted provided that the following conditions are met:  *
+*                                                                              *
+*   (1) Redistributions of source code must retain the above copyright notice, *
+*       this list of conditions and the following disclaimer.                  *
+*                                                                              *
+*   (2) Redistributions in binary form must reproduce the above copyright      *
+*       notice, this list of conditions and the following disclaimer in the    *
+*       documentation and/or other materials provided with the distribution.   *
+*                                                                              *
+*   (3) The name of the author may not be used to endorse or promote products  *
+*       derived from this software without specific prior written permission.  *
+*                                                                              *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF         *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO   *
+* EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,       *
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, *
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;  *
+* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,     *
+* WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR      *
+* OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF       *
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                                   *
+\******************************************************************************/
+
+/**
+@file      epoll.h
+@brief     scan many file descriptors with matchers driven by epoll
+@author    Robert van Engelen - engelen@genivia.com
+@copyright (c) 2016-2024, Robert van Engelen, Genivia Inc. All rights reserved.
+@copyright (c) BSD-3 License - see LICENSE.txt
+*/
+
+#ifndef REFLEX_EPOLL_H
+#define REFLEX_EPOLL_H
+
+#include <reflex/async.h>
+#include <functional>
+#include <vector>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+namespace reflex {
+
+/// Scan many file descriptors, each with its own matcher that shares the compiled pattern, reading with non-blocking read(2) driven by epoll (Linux).
+/**
+The file descriptors added with add() are owned by the scanner and are closed
+when their input ends, when remove() is called, or when the scanner is deleted.
+Each file descriptor is read with non-blocking read(2) when epoll reports that
+it is readable and the data is fed to its reflex::AsyncMatcher.  Matches are
+delivered to the match handler and the end of the input or a read error to the
+close handler:
+
+```{.cpp}
+    reflex::Pattern pattern("\\w+");
+    reflex::EpollScanner<> scanner(pattern, reflex::AbstractMatcher::Const::FIND);
+    scanner.on_match([](int fd, reflex::AbstractMatcher& matcher, size_t accept) {
+      std::cout << fd << ": " << matcher.text() << std::endl;
+    });
+    scanner.add(fd1);
+    scanner.add(fd2);
+    scanner.run();
+```
+*/
+template<typename M = Matcher> /// @tparam <M> matcher class, e.g. reflex::Matcher
+class EpollScanner {
+ public:
+  typedef AsyncMatcher<M> Stream; ///< the matcher type of a file descriptor
+  typedef std::function<void(int fd, AbstractMatcher& matcher, size_t accept)> MatchHandler; ///< match handler type
+  typedef std::function<void(int fd, int err)> CloseHandler; ///< close handler type, err is zero at the end of the input or the errno value of a read error
+  /// Default size of the buffer to read a file descriptor.
+  static const size_t BUFSZ = 65536;
+  /// Construct a scanner with a pattern and a match method.
+  EpollScanner(
+      const typename M::Pattern& pattern,                        ///< the pattern shared by all matchers
+      int                        method = AbstractMatcher::Const::FIND, ///< Const::SCAN, Const::FIND, or Const::SPLIT
+      const char                *opt = NULL,                      ///< matcher options
+      size_t                     size = BUFSZ)                    ///< size of the buffer to read a file descriptor
+    :
+      pat_(&pattern),
+      met_(method),
+      opt_(opt),
+      buf_(size > 0 ? size : BUFSZ),
+      num_(0),
+      cur_(-1),
+      rmd_(false)
+  {
+    epfd_ = ::epoll_create1(EPOLL_CLOEXEC);
+  }
+  /// The scanner owns its file descriptors and matchers and cannot be copied.
+  EpollScanner(const EpollScanner&) = delete;
+  /// The scanner owns its file descriptors and matchers and cannot be assigned.
+  EpollScanner& operator=(const EpollScanner&) = delete;
+  /// Delete the scanner and close all file descriptors.
+  ~EpollScanner()
+  {
+    for (size_t fd = 0; fd < fds_.size(); ++fd)
+      if (fds_[fd] != NULL)
+        remove(static_cast<int>(fd));
+    if (epfd_ >= 0)
+      ::close(epfd_);
+  }
+  /// Set the match handler, invoked for each match.
+  void on_match(const MatchHandler& handler) ///< match handler
+  {
+    match_ = handler;
+  }
+  /// Set the close handler, invoked when a file descriptor is closed at the end of its input or after a read error.
+  void on_close(const CloseHandler& handler) ///< close handler
+  {
+    close_ = handler;
+  }
+  /// Add a file descriptor to scan, sets the file descriptor to non-blocking.
+  bool add(int fd) ///< file descriptor to read, owned by this scanner
+    /// @returns true if successful, false with errno set otherwise
+  {
+    if (epfd_ < 0 || fd < 0)
+    {
+      errno = EBADF;
+      return false;
+    }
+    int flags = ::fcntl(fd, F_GETFL);
+    if (flags < 0 || ::fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0)
+      return false;
+    struct epoll_event event;
+    event.events = EPOLLIN | EPOLLRDHUP;
+    event.data.fd = fd;
+    if (::epoll_ctl(epfd_, EPOLL_CTL_ADD, fd, &event) < 0)
+      return false;
+    if (static_cast<size_t>(fd) >= fds_.size())
+      fds_.resize(fd + 1, NULL);
+    delete fds_[fd];
+    fds_[fd] = new Stream(pat_, opt_);
+    ++num_;
+    return true;
+  }
+  /// Remove a file descriptor and close it, without invoking the close handler, may be invoked by a handler.
+  void remove(int fd) ///< file descriptor to remove
+  {
+    if (fd < 0 || static_cast<size_t>(fd) >= fds_.size() || fds_[fd] == NULL)
+      return;
+    if (fd == cur_)
+      rmd_ = true;
+    (void)::epoll_ctl(epfd_, EPOLL_CTL_DEL, fd, NULL);
+    ::close(fd);
+    delete fds_[fd];
+    fds_[fd] = NULL;
+    --num_;
+  }
+  /// Returns the matcher of a file descriptor.
+  Stream *matcher(int fd) const
+    /// @returns pointer to the matcher or NULL when fd was not added
+  {
+    return fd >= 0 && static_cast<size_t>(fd) < fds_.size() ? fds_[fd] : NULL;
+  }
+  /// Returns the number of file descriptors scanned.
+  size_t size() const
+    /// @returns number of file descriptors
+  {
+    return num_;
+  }
+  /// Wait for readable file descriptors and scan the data read, invoking the handlers.
+  int poll(int timeout = -1) ///< timeout in milliseconds or -1 to block
+    /// @returns number of file descriptors that were ready, or -1 with errno set
+  {
+    struct epoll_event events[256];
+    int n = ::epoll_wait(epfd_, events, 256, timeout);
+    if (n < 0)
+      return errno == EINTR ? 0 : -1;
+    for (int i = 0; i < n; ++i)
+      ready(events[i].data.fd);
+    return n;
+  }
+  /// Scan until all file descriptors are closed.
+  bool run()
+    /// @returns true when all file descriptors are closed, false with errno set when epoll failed
+  {
+    while (num_ > 0)
+      if (poll() < 0)
+        return false;
+    return true;
+  }
+ protected:
+  /// Read a ready file descriptor and feed its matcher.
+  void ready(int fd) ///< ready file descriptor
+  {
+    Stream *stream = matcher(fd);
+    if (stream == NULL)
+      return;
+    ssize_t n = ::read(fd, &buf_[0], buf_.size());
+    if (n > 0)
+    {
+      stream->feed(&buf_[0], static_cast<size_t>(n));
+      drain(fd, stream);
+    }
+    else if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+    {
+      int err = n == 0 ? 0 : errno;
+      stream->close();
+      if (!drain(fd, stream))
+        return; // the match handler removed fd, which may have been reused by add()
+      remove(fd);
+      if (close_)
+        close_(fd, err);
+    }
+  }
+  /// Match the input fed so far until more input is needed or the input ends, invoking the match handler for each match.
+  bool drain(int fd, Stream *stream)
+    /// @returns false if the match handler removed fd
+  {
+    cur_ = fd;
+    rmd_ = false;
+    size_t accept;
+    while (!rmd_ && (accept = stream->perform(met_)) != 0)
+      if (match_)
+        match_(fd, *stream, accept);
+    cur_ = -1;
+    return !rmd_;
+  }
+  const typename M::Pattern *pat_;   ///< pattern shared by all matchers
+  int                        met_;   ///< the match method
+  const char                *opt_;   ///< matcher options
+  std::vector<char>          buf_;   ///< buffer to read file descriptors
+  std::vector<Stream*>       fds_;   ///< matchers indexed by file descriptor
+  size_t                     num_;   ///< number of file descriptors scanned
+  int                        epfd_;  ///< epoll file descriptor
+  int                        cur_;   ///< file descriptor of the matches delivered by drain() or -1
+  bool                       rmd_;   ///< true if the match handler removed cur_
+  MatchHandler               match_; ///< match handler
+  CloseHandler               close_; ///< close handler
+};
+
+} // namespace reflex
+
+#endif
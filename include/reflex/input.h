@@ -37,13 +37,29 @@
 #ifndef REFLEX_INPUT_H
 #define REFLEX_INPUT_H
 
+#if WITH_TRACE
+#include <reflex/trace.h>
+#endif
 #include <reflex/utf8.h>
 #include <cstdio>
 #include <cstring>
 #include <iostream>
 #include <string>
+#include <vector>
 #include <stdint.h>
 
+#if defined(__WIN32__) || defined(_WIN32) || defined(WIN32) || defined(_WIN64) || defined(__BORLANDC__)
+namespace reflex {
+/// Scatter/gather input segment, the same as the POSIX struct iovec.
+struct iovec {
+  void  *iov_base; ///< start of the segment
+  size_t iov_len;  ///< length of the segment in bytes
+};
+}
+#else
+#include <sys/uio.h>
+#endif
+
 namespace reflex {
 
 extern const unsigned short codepages[][256];
@@ -58,7 +74,8 @@ sequence of characters:
 
 - An Input object is instantiated and (re)assigned a (new) source input: either
   a `char*` string, a `wchar_t*` wide string, a `std::string`, a
-  `std::wstring`, a `FILE*` descriptor, or a `std::istream` object.
+  `std::wstring`, a `FILE*` descriptor, a `std::istream` object, or an array
+  of `iovec` segments of a scatter/gather buffer.
 
 - Strings specified as input must be persistent and cannot be temporary.  The
   input string contents are incrementally extracted and converted as necessary,
@@ -242,8 +259,9 @@ byte by byte (use a buffer as shown in other examples to improve efficiency):
 Example
 -------
 
-The following examples shows how to use reflex::Input::streambuf to create an
-unbuffered std::istream:
+The following examples shows how to use reflex::Input::streambuf to create a
+std::istream, which reads the input in blocks of reflex::Input::streambuf::SIZE
+bytes by default (the size may be specified as the second constructor argument):
 
 ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~{.cpp}
     reflex::Input input(fopen("legacy.txt", "r"), reflex::Input::file_encoding::ebcdic);
@@ -319,6 +337,16 @@ class Input {
     static const file_encoding_type koi8_ru    = 37; ///< KOI8-RU
     static const file_encoding_type custom     = 38; ///< custom code page
   };
+  /// Common utf8_validation constants type.
+  typedef unsigned short utf8_validation_type;
+  /// Common utf8_validation constants.
+  struct utf8_validation {
+    static const utf8_validation_type none   = 0; ///< no UTF-8 validation (default)
+    static const utf8_validation_type report = 1; ///< validate UTF-8 and record the offset of the first invalid UTF-8, see utf8_error()
+    static const utf8_validation_type repair = 2; ///< validate UTF-8 and replace each maximal invalid UTF-8 subsequence by U+FFFD
+  };
+  /// Offset returned by utf8_error() when no invalid UTF-8 was found.
+  static const size_t npos = static_cast<size_t>(-1);
   /// FILE* handler functor base class to handle FILE* errors and non-blocking FILE* reads
   struct Handler {
     virtual int operator()(FILE*) = 0;
@@ -335,6 +363,9 @@ class Input {
       wstring_(NULL),
       file_(NULL),
       istream_(NULL),
+      iovec_(NULL),
+      iovcnt_(0),
+      iovpos_(0),
       size_(0)
   {
     init();
@@ -346,12 +377,24 @@ class Input {
       wstring_(input.wstring_),
       file_(input.file_),
       istream_(input.istream_),
+      iovec_(input.iovec_),
+      iovcnt_(input.iovcnt_),
+      iovpos_(input.iovpos_),
       size_(input.size_),
       uidx_(input.uidx_),
       ulen_(input.ulen_),
       utfx_(input.utfx_),
       page_(input.page_),
-      handler_(input.handler_)
+      handler_(input.handler_),
+      dos_(input.dos_),
+      dcr_(input.dcr_),
+      lah_(input.lah_),
+      val_(input.val_),
+      vnum_(input.vnum_),
+      verr_(input.verr_),
+      vbuf_(input.vbuf_),
+      vpos_(input.vpos_),
+      vskp_(input.vskp_)
   {
     std::memcpy(utf8_, input.utf8_, sizeof(utf8_));
   }
@@ -364,6 +407,9 @@ class Input {
       wstring_(NULL),
       file_(NULL),
       istream_(NULL),
+      iovec_(NULL),
+      iovcnt_(0),
+      iovpos_(0),
       size_(size)
   {
     init();
@@ -375,6 +421,9 @@ class Input {
       wstring_(NULL),
       file_(NULL),
       istream_(NULL),
+      iovec_(NULL),
+      iovcnt_(0),
+      iovpos_(0),
       size_(cstring != NULL ? std::strlen(cstring) : 0)
   {
     init();
@@ -386,6 +435,9 @@ class Input {
       wstring_(NULL),
       file_(NULL),
       istream_(NULL),
+      iovec_(NULL),
+      iovcnt_(0),
+      iovpos_(0),
       size_(string.size())
   {
     init();
@@ -397,6 +449,9 @@ class Input {
       wstring_(NULL),
       file_(NULL),
       istream_(NULL),
+      iovec_(NULL),
+      iovcnt_(0),
+      iovpos_(0),
       size_(string != NULL ? string->size() : 0)
   {
     init();
@@ -408,6 +463,9 @@ class Input {
       wstring_(wstring),
       file_(NULL),
       istream_(NULL),
+      iovec_(NULL),
+      iovcnt_(0),
+      iovpos_(0),
       size_(0)
   {
     init();
@@ -419,6 +477,9 @@ class Input {
       wstring_(wstring.c_str()),
       file_(NULL),
       istream_(NULL),
+      iovec_(NULL),
+      iovcnt_(0),
+      iovpos_(0),
       size_(0)
   {
     init();
@@ -430,6 +491,9 @@ class Input {
       wstring_(wstring != NULL ? wstring->c_str() : NULL),
       file_(NULL),
       istream_(NULL),
+      iovec_(NULL),
+      iovcnt_(0),
+      iovpos_(0),
       size_(0)
   {
     init();
@@ -441,6 +505,9 @@ class Input {
       wstring_(NULL),
       file_(file),
       istream_(NULL),
+      iovec_(NULL),
+      iovcnt_(0),
+      iovpos_(0),
       size_(0)
   {
     init();
@@ -455,12 +522,33 @@ class Input {
       wstring_(NULL),
       file_(file),
       istream_(NULL),
+      iovec_(NULL),
+      iovcnt_(0),
+      iovpos_(0),
       size_(0)
   {
     init();
     if (file_encoding() == file_encoding::plain)
       file_encoding(enc, page);
   }
+  /// Construct input character sequence from an array of iovec segments, the segments are read one after the other, get() copies them to the caller's buffer and matchers scan large segments in place, see iov_segment().
+  Input(
+      const iovec *iov,    ///< array of segments
+      size_t       iovcnt) ///< number of segments
+    :
+      cstring_(NULL),
+      wstring_(NULL),
+      file_(NULL),
+      istream_(NULL),
+      iovec_(iov),
+      iovcnt_(iov != NULL ? iovcnt : 0),
+      iovpos_(0),
+      size_(0)
+  {
+    for (size_t i = 0; i < iovcnt_; ++i)
+      size_ += iov[i].iov_len;
+    init();
+  }
   /// Construct input character sequence from a std::istream.
   Input(std::istream& istream) ///< input stream
     :
@@ -468,6 +556,9 @@ class Input {
       wstring_(NULL),
       file_(NULL),
       istream_(&istream),
+      iovec_(NULL),
+      iovcnt_(0),
+      iovpos_(0),
       size_(0)
   {
     init();
@@ -479,6 +570,9 @@ class Input {
       wstring_(NULL),
       file_(NULL),
       istream_(istream),
+      iovec_(NULL),
+      iovcnt_(0),
+      iovpos_(0),
       size_(0)
   {
     init();
@@ -490,12 +584,24 @@ class Input {
     wstring_ = input.wstring_;
     file_ = input.file_;
     istream_ = input.istream_;
+    iovec_ = input.iovec_;
+    iovcnt_ = input.iovcnt_;
+    iovpos_ = input.iovpos_;
     size_ = input.size_;
     uidx_ = input.uidx_;
     ulen_ = input.ulen_;
     utfx_ = input.utfx_;
     page_ = input.page_;
     handler_ = input.handler_;
+    dos_ = input.dos_;
+    dcr_ = input.dcr_;
+    lah_ = input.lah_;
+    val_ = input.val_;
+    vnum_ = input.vnum_;
+    verr_ = input.verr_;
+    vbuf_ = input.vbuf_;
+    vpos_ = input.vpos_;
+    vskp_ = input.vskp_;
     std::memcpy(utf8_, input.utf8_, sizeof(utf8_));
     return *this;
   }
@@ -553,11 +659,41 @@ class Input {
   {
     return istream_;
   }
+  /// Get the remaining iovec segments of this Input object, returns NULL when this Input is not an array of iovec segments.
+  const iovec *iov() const
+    /// @returns pointer to the current segment or NULL
+  {
+    return iovec_;
+  }
+  /// Get the current iovec segment to scan it in place, returns NULL when this Input is not an array of iovec segments, when no segments remain, or when get() replaces CRLF or validates UTF-8.
+  char *iov_segment(
+      size_t& pos,       ///< set to the number of bytes of the segment read so far
+      size_t& len) const ///< set to the length of the segment in bytes
+    /// @returns pointer to the start of the current segment or NULL
+  {
+    if (iovcnt_ == 0 || dos_ || dcr_ || lah_ != EOF || val_ != utf8_validation::none || !vbuf_.empty())
+      return NULL;
+    pos = iovpos_;
+    len = iovec_->iov_len;
+    return static_cast<char*>(iovec_->iov_base);
+  }
+  /// Skip n bytes of the current iovec segment as if read with get(), when the segment is scanned in place.
+  void iov_skip(size_t n) ///< number of bytes to skip, at most the rest of the current segment
+  {
+    iovpos_ += n;
+    size_ -= n;
+    if (iovpos_ >= iovec_->iov_len)
+    {
+      ++iovec_;
+      --iovcnt_;
+      iovpos_ = 0;
+    }
+  }
   /// Get the size of the input character sequence in number of ASCII/UTF-8 bytes (zero if size is not determinable from a `FILE*` or `std::istream` source).
   size_t size()
     /// @returns the nonzero number of ASCII/UTF-8 bytes available to read, or zero when source is empty or if size is not determinable e.g. when reading from standard input
   {
-    if (cstring_)
+    if (cstring_ || iovec_)
       return size_;
     if (wstring_)
     {
@@ -580,7 +716,7 @@ class Input {
   bool assigned() const
     /// @returns true if this Input object was assigned (not default constructed or cleared)
   {
-    return cstring_ || wstring_ || file_ || istream_;
+    return cstring_ || wstring_ || file_ || istream_ || iovec_;
   }
   /// Clear this Input by unassigning it.
   void clear()
@@ -589,13 +725,18 @@ class Input {
     wstring_ = NULL;
     file_ = NULL;
     istream_ = NULL;
+    iovec_ = NULL;
+    iovcnt_ = 0;
+    iovpos_ = 0;
     size_ = 0;
   }
   /// Check if input is available.
   bool good() const
     /// @returns true if a non-empty sequence of characters is available to get
   {
-    if (cstring_)
+    if (dcr_ || lah_ != EOF || !vbuf_.empty())
+      return true;
+    if (cstring_ || iovec_)
       return size_ > 0;
     if (wstring_)
       return *wstring_ != L'\0';
@@ -609,7 +750,9 @@ class Input {
   bool eof() const
     /// @returns true if input is at EOF and no characters are available
   {
-    if (cstring_)
+    if (dcr_ || lah_ != EOF || !vbuf_.empty())
+      return false;
+    if (cstring_ || iovec_)
       return size_ == 0;
     if (wstring_)
       return *wstring_ == L'\0';
@@ -627,12 +770,67 @@ class Input {
       return static_cast<unsigned char>(c);
     return EOF;
   }
-  /// Copy character sequence data into buffer.
+  /// Copy character sequence data into buffer, replaces CRLF by LF when dos(true) is set and validates UTF-8 when utf8_validation() is set.
   size_t get(
       char  *s, ///< points to the string buffer to fill with input
       size_t n) ///< size of buffer pointed to by s
     /// @returns the nonzero number of (less or equal to n) 8-bit characters added to buffer s from the current input, or zero when EOF
   {
+#if WITH_TRACE
+    REFLEX_TRACE_SPAN("Input::get");
+#endif
+    if (val_ != utf8_validation::none)
+      return utf8_get(s, n);
+    if (dos_)
+      return dos_get(s, n);
+    return raw_get(s, n);
+  }
+  /// Replace CRLF pairs by LF when reading input with get(), for DOS and Windows files and other input.
+  void dos(bool flag) ///< true to replace CRLF by LF
+  {
+    dos_ = flag;
+  }
+  /// Returns true if CRLF pairs are replaced by LF when reading input with get().
+  bool dos() const
+    /// @returns true if CRLF is replaced by LF
+  {
+    return dos_;
+  }
+  /// Validate UTF-8 when reading input with get(), either to report the first invalid UTF-8 or to replace invalid UTF-8 by U+FFFD.
+  void utf8_validation(utf8_validation_type mode) ///< utf8_validation::none, utf8_validation::report or utf8_validation::repair
+  {
+    val_ = mode;
+  }
+  /// Get the UTF-8 validation mode.
+  utf8_validation_type utf8_validation() const
+    /// @returns current utf8_validation constant
+  {
+    return val_;
+  }
+  /// Get the byte offset of the first invalid UTF-8 in the input validated so far, before any replacements by U+FFFD.
+  size_t utf8_error() const
+    /// @returns byte offset of the first invalid or truncated UTF-8 sequence, or Input::npos when none was found
+  {
+    return verr_;
+  }
+  /// Set encoding for `FILE*` input.
+  void file_encoding(
+      file_encoding_type    enc,         ///< file_encoding
+      const unsigned short *page = NULL) ///< custom code page for file_encoding::custom
+    ;
+  /// Get encoding of the current `FILE*` input.
+  file_encoding_type file_encoding() const
+    /// @returns current file_encoding constant
+  {
+    return utfx_;
+  }
+ protected:
+  /// Copy character sequence data into buffer, normalized to UTF-8 but without replacing CRLF.
+  size_t raw_get(
+      char  *s, ///< points to the string buffer to fill with input
+      size_t n) ///< size of buffer pointed to by s
+    /// @returns the nonzero number of (less or equal to n) 8-bit characters added to buffer s from the current input, or zero when EOF
+  {
     if (cstring_)
     {
       size_t k = size_;
@@ -644,70 +842,9 @@ class Input {
       return k;
     }
     if (wstring_)
-    {
-      size_t k = n;
-      if (ulen_ > 0)
-      {
-        size_t l = ulen_;
-        if (l > k)
-          l = k;
-        std::memcpy(s, utf8_ + uidx_, l);
-        k -= l;
-        if (k == 0)
-        {
-          uidx_ += static_cast<unsigned short>(l);
-          ulen_ -= static_cast<unsigned short>(l);
-          if (size_ >= n)
-            size_ -= n;
-          return n;
-        }
-        s += l;
-        ulen_ = 0;
-      }
-      wchar_t c;
-      while ((c = *wstring_) != L'\0' && k > 0)
-      {
-        if (c < 0x80)
-        {
-          *s++ = static_cast<char>(c);
-          --k;
-        }
-        else
-        {
-          size_t l;
-          if (c >= 0xD800 && c < 0xE000)
-          {
-            // UTF-16 surrogate pair
-            if (c < 0xDC00 && (wstring_[1] & 0xFC00) == 0xDC00)
-              l = utf8(0x010000 - 0xDC00 + ((c - 0xD800) << 10) + *++wstring_, utf8_);
-            else
-              l = utf8(REFLEX_NONCHAR, utf8_);
-          }
-          else
-          {
-            l = utf8(c, utf8_);
-          }
-          if (k < l)
-          {
-            uidx_ = static_cast<unsigned short>(k);
-            ulen_ = static_cast<unsigned short>(l - k);
-            std::memcpy(s, utf8_, k);
-            s += k;
-            k = 0;
-          }
-          else
-          {
-            std::memcpy(s, utf8_, l);
-            s += l;
-            k -= l;
-          }
-        }
-        ++wstring_;
-      }
-      if (size_ >= n - k)
-        size_ -= n - k;
-      return n - k;
-    }
+      return wstring_get(s, n);
+    if (iovec_)
+      return iovec_get(s, n);
     if (file_)
     {
       while (true)
@@ -726,17 +863,17 @@ class Input {
     }
     return 0;
   }
-  /// Set encoding for `FILE*` input.
-  void file_encoding(
-      file_encoding_type    enc,         ///< file_encoding
-      const unsigned short *page = NULL) ///< custom code page for file_encoding::custom
-    ;
-  /// Get encoding of the current `FILE*` input.
-  file_encoding_type file_encoding() const
-    /// @returns current file_encoding constant
-  {
-    return utfx_;
-  }
+  /// Implements get() with dos(true) to replace CRLF by LF.
+  size_t dos_get(
+      char  *s, ///< points to the string buffer to fill with input
+      size_t n) ///< size of buffer pointed to by s
+      ;
+  /// Implements get() with UTF-8 validation.
+  size_t utf8_get(
+      char  *s, ///< points to the string buffer to fill with input
+      size_t n) ///< size of buffer pointed to by s
+      ;
+ public:
   /// Initialize the state after (re)setting the input source, auto-detects UTF BOM in FILE* input if the file size is known.
   void init()
   {
@@ -746,6 +883,15 @@ class Input {
     utfx_ = 0;
     page_ = NULL;
     handler_ = NULL;
+    dos_ = false;
+    dcr_ = false;
+    lah_ = EOF;
+    val_ = utf8_validation::none;
+    vnum_ = 0;
+    verr_ = npos;
+    vbuf_.clear();
+    vpos_ = 0;
+    vskp_ = 0;
     if (file_ != NULL)
       file_init();
   }
@@ -755,8 +901,30 @@ class Input {
   void wstring_size();
   /// Called by size() for a FILE*.
   void file_size();
+  /// Called by streambuf and dos_streambuf to check if the FILE* is a regular file that can be read ahead without blocking.
+  bool file_regular() const;
+  /// Called by streambuf and dos_streambuf to limit a read ahead of n bytes from a std::istream to the bytes it has available without blocking, but at least one byte.
+  size_t istream_ahead(size_t n) const
+  {
+    if (istream_ == NULL || n <= 1 || istream_->rdbuf() == NULL)
+      return n;
+    std::streamsize k = istream_->rdbuf()->in_avail();
+    if (k <= 1)
+      return 1;
+    return static_cast<size_t>(k) < n ? static_cast<size_t>(k) : n;
+  }
   /// Called by size() for a std::istream.
   void istream_size();
+  /// Implements get() on a wide string.
+  size_t wstring_get(
+      char  *s, ///< points to the string buffer to fill with input
+      size_t n) ///< size of buffer pointed to by s
+      ;
+  /// Implements get() on an array of iovec segments.
+  size_t iovec_get(
+      char  *s, ///< points to the string buffer to fill with input
+      size_t n) ///< size of buffer pointed to by s
+      ;
   /// Implements get() on a FILE*.
   size_t file_get(
       char  *s, ///< points to the string buffer to fill with input
@@ -772,6 +940,9 @@ class Input {
   const wchar_t        *wstring_; ///< NUL-terminated wide string input (when non-null)
   FILE                 *file_;    ///< FILE* input (when non-null)
   std::istream         *istream_; ///< stream input (when non-null)
+  const iovec          *iovec_;   ///< iovec segments input (when non-null), points to the current segment
+  size_t                iovcnt_;  ///< number of iovec segments remaining, including the current segment
+  size_t                iovpos_;  ///< position in the current iovec segment
   size_t                size_;    ///< size of the remaining input in bytes (size_ == 0 may indicate size is not set)
   char                  utf8_[8]; ///< UTF-8 normalization buffer, >=8 bytes
   unsigned short        uidx_;    ///< index in utf8_[]
@@ -779,128 +950,176 @@ class Input {
   file_encoding_type    utfx_;    ///< file_encoding
   const unsigned short *page_;    ///< custom code page
   Handler              *handler_; ///< to handle FILE* errors and non-blocking FILE* reads
+  bool                  dos_;     ///< true if CRLF is replaced by LF
+  bool                  dcr_;     ///< true if a CR at the end of the last block is held back with dos_
+  int                   lah_;     ///< a byte read ahead after a CR held back with dos_, or EOF
+  utf8_validation_type  val_;     ///< utf8_validation mode
+  size_t                vnum_;    ///< number of bytes validated so far
+  size_t                verr_;    ///< offset of the first invalid UTF-8 or npos
+  std::string           vbuf_;    ///< bytes held back by UTF-8 validation: an incomplete UTF-8 sequence or the rest of a block after invalid UTF-8
+  size_t                vpos_;    ///< position of the bytes held back in vbuf_
+  size_t                vskp_;    ///< number of bytes at vpos_ in vbuf_ that were already validated or replaced
 };
 
 /// Stream buffer for reflex::Input, derived from std::streambuf.
 class Input::streambuf : public std::streambuf {
  public:
-  streambuf(const reflex::Input& input)
+  /// Default size of the get area.
+  static const size_t SIZE = 16384;
+  /// Construct a stream buffer with a get area of the specified size, filled with reflex::Input::get(s, n).
+  streambuf(
+      const reflex::Input& input,    ///< input to read
+      size_t               size = 0) ///< size of the get area, or 0 to use SIZE, or 1 when input is a FILE* that is not a regular file such as stdin, a TTY or a pipe; reads from a std::istream are limited to its in_avail() bytes
     :
       input_(input),
-      ch_(input_.get())
-  { }
+      buf_(size > 0 ? size : input_.file_ != NULL && !input_.file_regular() ? 1 : SIZE)
+  {
+    setg(&buf_[0], &buf_[0], &buf_[0]);
+  }
  protected:
   virtual int_type underflow()
   {
-    return ch_ == EOF ? traits_type::eof() : traits_type::to_int_type(ch_);
-  }
-  virtual int_type uflow()
-  {
-    if (ch_ == EOF)
-      return traits_type::eof();
-    int c = ch_;
-    ch_ = input_.get();
-    return traits_type::to_int_type(c);
+    if (gptr() < egptr())
+      return traits_type::to_int_type(*gptr());
+    char *s = &buf_[0];
+    size_t n = input_.get(s, input_.istream_ahead(buf_.size()));
+    setg(s, s, s + n);
+    return n == 0 ? traits_type::eof() : traits_type::to_int_type(*s);
   }
   virtual std::streamsize xsgetn(char *s, std::streamsize n)
   {
-    if (n <= 0 || ch_ == EOF)
+    if (n <= 0)
       return 0;
-    *s++ = ch_;
-    std::streamsize k = static_cast<std::streamsize>(input_.get(s, static_cast<size_t>(n - 1)));
-    if (k < n - 1)
+    // copy the get area first, then read large requests directly into s
+    std::streamsize k = egptr() - gptr();
+    if (k > n)
+      k = n;
+    std::memcpy(s, gptr(), static_cast<size_t>(k));
+    gbump(static_cast<int>(k));
+    while (k < n)
     {
-      ch_ = EOF;
-      return k + 1;
+      if (static_cast<size_t>(n - k) < buf_.size())
+      {
+        if (traits_type::eq_int_type(underflow(), traits_type::eof()))
+          break;
+        std::streamsize m = egptr() - gptr();
+        if (m > n - k)
+          m = n - k;
+        std::memcpy(s + k, gptr(), static_cast<size_t>(m));
+        gbump(static_cast<int>(m));
+        k += m;
+      }
+      else
+      {
+        size_t m = input_.get(s + k, static_cast<size_t>(n - k));
+        if (m == 0)
+          break;
+        k += static_cast<std::streamsize>(m);
+      }
     }
-    ch_ = input_.get();
-    return n;
+    return k;
   }
   virtual std::streamsize showmanyc()
   {
-    return ch_ == EOF ? -1 : input_.size() + 1;
+    std::streamsize k = egptr() - gptr();
+    if (k == 0 && input_.eof())
+      return -1;
+    return k + static_cast<std::streamsize>(input_.size());
   }
-  Input input_;
-  int ch_;
+  Input             input_;
+  std::vector<char> buf_;
 };
 
 /// Stream buffer for reflex::Input to read DOS files, replaces CRLF by LF, derived from std::streambuf.
 class Input::dos_streambuf : public std::streambuf {
  public:
-  dos_streambuf(const reflex::Input& input)
+  /// Default size of the get area.
+  static const size_t SIZE = 16384;
+  /// Construct a stream buffer with a get area of the specified size, filled with reflex::Input::get(s, n) and with CRLF replaced by LF.
+  dos_streambuf(
+      const reflex::Input& input,    ///< input to read
+      size_t               size = 0) ///< size of the get area, at least 2 to read one byte at a time, or 0 to use SIZE, or 2 when input is a FILE* that is not a regular file such as stdin, a TTY or a pipe; reads from a std::istream are limited to its in_avail() bytes
     :
       input_(input),
-      ch1_(input_.get()),
-      ch2_(EOF)
-  { }
+      buf_(size > 1 ? size : size == 0 && (input_.file_ == NULL || input_.file_regular()) ? SIZE : 2),
+      cr_(false)
+  {
+    setg(&buf_[0], &buf_[0], &buf_[0]);
+  }
  protected:
   virtual int_type underflow()
   {
-    if (ch1_ == EOF)
-      return traits_type::eof();
-    if (ch1_ == '\r')
+    if (gptr() < egptr())
+      return traits_type::to_int_type(*gptr());
+    char *s = &buf_[0];
+    char *t = s;
+    while (t == s)
     {
-      if (ch2_ == EOF)
-        ch2_ = input_.get();
-      if (ch2_ == '\n')
+      // a CR at the end of the last block is held back until we know if LF follows
+      size_t k = 0;
+      if (cr_)
       {
-        ch1_ = ch2_;
-        ch2_ = EOF;
+        *s = '\r';
+        k = 1;
+        cr_ = false;
+      }
+      // read at most one byte less than the get area holds, to read one byte at a time with a get area of size 2
+      size_t n = input_.get(s + k, input_.istream_ahead(buf_.size() - 1));
+      if (n == 0)
+      {
+        t = s + k;
+        break;
+      }
+      const char *p = s;
+      const char *e = s + k + n;
+      while (p < e)
+      {
+        const char *q = static_cast<const char*>(std::memchr(p, '\r', e - p));
+        if (q == NULL)
+          q = e;
+        if (t < p)
+          std::memmove(t, p, q - p);
+        t += q - p;
+        p = q;
+        if (p < e)
+        {
+          if (p + 1 == e)
+          {
+            cr_ = true;
+            break;
+          }
+          if (p[1] != '\n')
+            *t++ = '\r';
+          ++p;
+        }
       }
     }
-    return traits_type::to_int_type(ch1_);
-  }
-  virtual int_type uflow()
-  {
-    int c = get();
-    return c == EOF ? traits_type::eof() : traits_type::to_int_type(c);
+    setg(s, s, t);
+    return t == s ? traits_type::eof() : traits_type::to_int_type(*s);
   }
   virtual std::streamsize xsgetn(char *s, std::streamsize n)
   {
-    if (n <= 0 || ch1_ == EOF)
-      return 0;
-    std::streamsize k = n;
-    int c;
-    while (k > 0 && (c = get()) != EOF)
+    std::streamsize k = 0;
+    while (k < n)
     {
-      *s++ = c;
-      --k;
+      if (gptr() == egptr() && traits_type::eq_int_type(underflow(), traits_type::eof()))
+        break;
+      std::streamsize m = egptr() - gptr();
+      if (m > n - k)
+        m = n - k;
+      std::memcpy(s + k, gptr(), static_cast<size_t>(m));
+      gbump(static_cast<int>(m));
+      k += m;
     }
-    return n - k;
+    return k;
   }
   virtual std::streamsize showmanyc()
   {
-    return ch1_ == EOF ? -1 : 0;
-  }
-  int get()
-  {
-    if (ch1_ == EOF)
-      return EOF;
-    int c = ch1_;
-    if (c == '\r')
-    {
-      if (ch2_ == EOF)
-        ch2_ = input_.get();
-      if (ch2_ == '\n')
-      {
-        c = ch2_;
-        ch1_ = input_.get();
-      }
-      else
-      {
-        ch1_ = ch2_;
-      }
-      ch2_ = EOF;
-    }
-    else
-    {
-      ch1_ = input_.get();
-    }
-    return c;
+    return gptr() == egptr() && !cr_ && input_.eof() ? -1 : egptr() - gptr();
   }
-  Input input_;
-  int ch1_;
-  int ch2_;
+  Input             input_;
+  std::vector<char> buf_;
+  bool              cr_; ///< true if a CR was read at the end of the last block
 };
 
 /// Buffered input.
@@ -64,7 +64,12 @@ class LineMatcher : public AbstractMatcher {
   /// Assign a matcher.
   LineMatcher& operator=(const LineMatcher& matcher) ///< matcher to copy
   {
-    AbstractMatcher::operator=(matcher);
+    scan.init(this, Const::SCAN);
+    find.init(this, Const::FIND);
+    split.init(this, Const::SPLIT);
+    in = matcher.in;
+    reset();
+    opt_ = matcher.opt_;
     inc_ = matcher.inc_;
     return *this;
   }
@@ -237,6 +237,11 @@ class Matcher : public PatternMatcher<reflex::Pattern> {
   {
     return get();
   }
+  /// FSM code SKIP.
+  inline void FSM_SKIP(int c0, int c1, int c2)
+  {
+    pos_ = skip_loop(static_cast<uint8_t>(c0), static_cast<uint8_t>(c1), static_cast<uint8_t>(c2));
+  }
   /// FSM code HALT.
   inline void FSM_HALT(int c1 = AbstractMatcher::Const::UNK)
   {
@@ -390,6 +395,27 @@ class Matcher : public PatternMatcher<reflex::Pattern> {
     bool nul;
     int  c1;
   };
+  /// DFA state of a match suspended to wait for more input, see AbstractMatcher::suspend()
+  struct Resume {
+    Resume() : pat(), method(), bol(), nul(), state(), back(), bpos(), cap(), len()
+#if WITH_STATS
+      , beg(), hit()
+#endif
+    { }
+    const Pattern *pat;    ///< pattern of the suspended match
+    Method         method; ///< method of the suspended match
+    bool           bol;    ///< match started at the begin of a line
+    bool           nul;    ///< empty match permitted
+    uint32_t       state;  ///< shuffle or table DFA state, or the opcode index of the opcode interpreter
+    Pattern::Index back;   ///< opcode index to backtrack to
+    size_t         bpos;   ///< input position to backtrack to
+    size_t         cap;    ///< capture index of the longest match so far
+    size_t         len;    ///< split text length
+#if WITH_STATS
+    size_t         beg;    ///< position of the DFA at the start of the match attempt
+    bool           hit;    ///< advance() found the match candidate
+#endif
+  };
   /// Returns true if input matched the pattern using method Const::SCAN, Const::FIND, Const::SPLIT, or Const::MATCH.
   virtual size_t match(Method method) ///< Const::SCAN, Const::FIND, Const::SPLIT, or Const::MATCH
     /// @returns nonzero if input matched the pattern
@@ -406,6 +432,14 @@ class Matcher : public PatternMatcher<reflex::Pattern> {
   bool simd_advance_avx512bw();
   /// optimized AVX2 version of advance() defined in matcher_avx2.cpp
   bool simd_advance_avx2();
+  /// Returns the buffer position of the next byte that is c0, c1 or c2 starting at pos_, or end_ when none are buffered
+  size_t skip_loop(uint8_t c0, uint8_t c1, uint8_t c2)
+    /// @returns position in buf_
+    ;
+  /// optimized AVX512BW version of skip_loop() defined in matcher_avx512bw.cpp
+  size_t simd_skip_loop_avx512bw(uint8_t c0, uint8_t c1, uint8_t c2);
+  /// optimized AVX2 version of skip_loop() defined in matcher_avx2.cpp
+  size_t simd_skip_loop_avx2(uint8_t c0, uint8_t c1, uint8_t c2);
 #if !defined(WITH_NO_INDENT)
   /// Update indentation column counter for indent() and dedent().
   inline void newline()
@@ -443,6 +477,7 @@ class Matcher : public PatternMatcher<reflex::Pattern> {
   std::vector<int>  lap_;      ///< lookahead position in input that heads a lookahead match (indexed by lookahead number)
   std::stack<Stops> stk_;      ///< stack to push/pop stops
   FSM               fsm_;      ///< local state for FSM code
+  Resume            rsm_;      ///< DFA state of the suspended match, valid when AbstractMatcher::sus_ is set
   bool              mrk_;      ///< indent \i or dedent \j in pattern found: should check and update indent stops
   bool              anc_;      ///< match is anchored, advance slowly to retry when searching
 };
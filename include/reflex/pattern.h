@@ -94,7 +94,8 @@ class Pattern {
     :
       opc_(NULL),
       nop_(0),
-      fsm_(NULL)
+      fsm_(NULL),
+      jit_(NULL)
   {
     init(NULL);
   }
@@ -105,7 +106,8 @@ class Pattern {
     :
       rex_(regex),
       opc_(NULL),
-      fsm_(NULL)
+      fsm_(NULL),
+      jit_(NULL)
   {
     init(options);
   }
@@ -116,7 +118,8 @@ class Pattern {
     :
       rex_(regex),
       opc_(NULL),
-      fsm_(NULL)
+      fsm_(NULL),
+      jit_(NULL)
   {
     init(options.c_str());
   }
@@ -127,7 +130,8 @@ class Pattern {
     :
       rex_(regex),
       opc_(NULL),
-      fsm_(NULL)
+      fsm_(NULL),
+      jit_(NULL)
   {
     init(options);
   }
@@ -138,7 +142,8 @@ class Pattern {
     :
       rex_(regex),
       opc_(NULL),
-      fsm_(NULL)
+      fsm_(NULL),
+      jit_(NULL)
   {
     init(options.c_str());
   }
@@ -148,7 +153,8 @@ class Pattern {
       const uint8_t *pred = NULL)
     :
       opc_(code),
-      fsm_(NULL)
+      fsm_(NULL),
+      jit_(NULL)
   {
     init(NULL, pred);
   }
@@ -158,12 +164,18 @@ class Pattern {
       const uint8_t *pred = NULL)
     :
       opc_(NULL),
-      fsm_(fsm)
+      fsm_(fsm),
+      jit_(NULL)
   {
     init(NULL, pred);
   }
   /// Copy constructor.
   Pattern(const Pattern& pattern) ///< pattern to copy
+    :
+      opc_(NULL),
+      nop_(0),
+      fsm_(NULL),
+      jit_(NULL)
   {
     operator=(pattern);
   }
@@ -176,11 +188,17 @@ class Pattern {
   void clear()
   {
     rex_.clear();
+    jit_free();
     if (nop_ > 0 && opc_ != NULL)
       delete[] opc_;
     opc_ = NULL;
     nop_ = 0;
     fsm_ = NULL;
+    shn_ = 0;
+    spn_ = 0;
+    tbl_.clear();
+    tac_.clear();
+    tsk_.clear();
   }
   /// Assign a (new) pattern.
   Pattern& assign(
@@ -254,6 +272,22 @@ class Pattern {
       for (size_t i = 0; i < nop_; ++i)
         code[i] = pattern.opc_[i];
       opc_ = code;
+      shn_ = pattern.shn_;
+      if (shn_ > 0)
+      {
+        memcpy(shf_, pattern.shf_, sizeof(shf_));
+        memcpy(sha_, pattern.sha_, sizeof(sha_));
+      }
+      spn_ = pattern.spn_;
+      memcpy(spc_, pattern.spc_, sizeof(spc_));
+      memcpy(spa_, pattern.spa_, sizeof(spa_));
+      tbl_ = pattern.tbl_;
+      tac_ = pattern.tac_;
+      tsk_ = pattern.tsk_;
+      ncl_ = pattern.ncl_;
+      memcpy(bcl_, pattern.bcl_, sizeof(bcl_));
+      if (pattern.jit_ != NULL)
+        jit_code();
     }
     else
     {
@@ -357,6 +391,19 @@ class Pattern {
   {
     return hno_ > 0 ? hms_ : 0.0f;
   }
+  /// Hook function type, called with the name of the compilation phase that completed, see phase_hook().
+  typedef void (*PhaseHook)(const char *phase);
+  /// Get or set the hook that is called at the end of the "parse", "nodes" (with edges), "hashing" and "words" compilation phases, for example to measure memory allocated per phase, NULL by default.
+  static PhaseHook& phase_hook()
+    /// @returns reference to the hook
+  {
+    static PhaseHook hook = NULL;
+    return hook;
+  }
+  /// Explain the search strategy selected for find(), the needles and their frequency scores, the estimated false positive rate of the prefilter, the DFA size and execution, and the expected scan speed class.
+  std::string explain() const
+    /// @returns multi-line report with one `name: value` line per item
+    ;
   /// Returns true when match is predicted, based on s[0..3..e-1] (e >= s + 4).
   static inline bool predict_match(const Pred pmh[], const char *s, size_t n)
   {
@@ -670,6 +717,7 @@ class Pattern {
           first(0),
           index(0),
           accept(0),
+          skip(0),
           redo(false)
       { }
 #ifndef WITH_TREE_DFA
@@ -697,6 +745,7 @@ class Pattern {
       Index       first;  ///< index of this state in the opcode table, determined by the first assembly pass
       Index       index;  ///< index of this state in the opcode table
       Accept      accept; ///< nonzero if final state, the index of an accepted/captured subpattern
+      Opcode      skip;   ///< nonzero SKIP opcode when this state loops back to itself on all but one to three bytes
       Lookaheads  heads;  ///< lookahead head set
       Lookaheads  tails;  ///< lookahead tail set
       bool        redo;   ///< true if this is a final state of a negative pattern
@@ -805,12 +854,13 @@ class Pattern {
   };
   /// Global modifier modes, syntax flags, and compiler options.
   struct Option {
-    Option() : b(), h(), e(), f(), i(), m(), n(), o(), p(), q(), r(), s(), w(), x(), z() { }
+    Option() : b(), h(), e(), f(), i(), j(), m(), n(), o(), p(), q(), r(), s(), w(), x(), z() { }
     bool                     b; ///< disable escapes in bracket lists
     bool                     h; ///< construct indexing hash finite state automaton
     Char                     e; ///< escape character, or > 255 for none, a backslash by default
     std::vector<std::string> f; ///< output the patterns and/or DFA to files(s)
     bool                     i; ///< case insensitive mode, also `(?i:X)`
+    bool                     j; ///< JIT compile the FSM to native x86-64 code when supported
     bool                     m; ///< multi-line mode, also `(?m:X)`
     std::string              n; ///< pattern name (for use in generated code)
     bool                     o; ///< generate optimized FSM code for option f
@@ -939,7 +989,14 @@ class Pattern {
       Chars& chars) const;
   void flip(Chars& chars) const;
   void assemble(DFA::State *start);
+  void phase(const char *name) const
+  {
+    if (phase_hook() != NULL)
+      phase_hook()(name);
+  }
+  void order_dfa(DFA::State *start);
   void compact_dfa(DFA::State *start);
+  void skip_dfa(DFA::State *start);
   void encode_dfa(DFA::State *start);
   void gencode_dfa(const DFA::State *start) const;
   void check_dfa_closure(
@@ -954,6 +1011,11 @@ class Pattern {
       bool              peek) const;
   void graph_dfa(const DFA::State *start) const;
   void export_code() const;
+  bool decode_state(const Opcode *pc, Accept& accept, Opcode& skip, Index next[256], Index& words) const;
+  void table_code();
+  void jit_code();
+  void jit_free();
+  static void jit_rethrow();
   void predict_match_dfa(const DFA::State *start);
   void gen_predict_match(const DFA::State *state);
   void gen_predict_match_start(const DFA::State *state, std::map<const DFA::State*,ORanges<Hash> >& states);
@@ -1063,6 +1125,13 @@ class Pattern {
   {
     return 0xFB000000 | (index & 0xFFFFFF); // index <= Const::LMAX (0xFAFFFF max)
   }
+  static inline Opcode opcode_skip(
+      Char c0,
+      Char c1,
+      Char c2)
+  {
+    return 0xFA000000 | (c0 << 16) | (c1 << 8) | c2; // c0 <= c1 <= c2 and c0 < 0xFA
+  }
   static inline Opcode opcode_goto(
       Char  lo,
       Char  hi,
@@ -1094,6 +1163,10 @@ class Pattern {
   {
     return (opcode & 0xFF000000) == 0xFB000000;
   }
+  static inline bool is_opcode_skip(Opcode opcode)
+  {
+    return (opcode & 0xFF000000) == 0xFA000000 && (opcode & 0x00FF0000) < 0x00FA0000;
+  }
   static inline bool is_opcode_halt(Opcode opcode)
   {
     return opcode == 0x00FFFFFF;
@@ -1173,6 +1246,19 @@ class Pattern {
   const Opcode         *opc_; ///< points to the table with compiled finite state machine opcodes
   Index                 nop_; ///< number of opcodes generated
   FSM                   fsm_; ///< function pointer to FSM code
+  void                 *jit_; ///< executable memory with JIT compiled FSM code, fsm_ points to it
+  size_t                jsz_; ///< size of the executable memory jit_
+  size_t                shn_; ///< number of shuffle DFA states including the dead state 0, or 0 when the DFA has more than 16 states
+  uint8_t               shf_[256][16]; ///< shuffle DFA next states indexed by byte and state, flagged with 0x10 accept, 0x20 dead or start, and 0x40 halt or skip
+  Accept                sha_[16]; ///< shuffle DFA state accept indices or 0
+  size_t                spn_; ///< number of split delimiter bytes in spc_[] when the pattern matches one of one to three single bytes, or 0
+  uint8_t               spc_[3]; ///< split delimiter bytes, padded by repeating the first byte
+  Accept                spa_[3]; ///< split delimiter accept indices
+  std::vector<uint16_t> tbl_; ///< compact DFA 16 bit next states indexed by state * ncl_ + bcl_[byte], flagged with 0x1000 accept, 0x2000 dead or start, and 0x4000 halt or skip
+  std::vector<Accept>   tac_; ///< compact DFA state accept indices or 0
+  std::vector<Opcode>   tsk_; ///< shuffle and compact DFA SKIP opcodes of the states flagged halt or skip, 0 to halt
+  size_t                ncl_; ///< number of byte classes of the compact DFA
+  uint8_t               bcl_[256]; ///< byte classes of the compact DFA
   size_t                len_; ///< length of chr_[], less or equal to 255
   size_t                min_; ///< patterns after the prefix are at least this long but no more than 8
   size_t                pin_; ///< number of needles
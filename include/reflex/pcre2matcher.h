@@ -38,8 +38,21 @@
 #define REFLEX_PCRE2MATCHER_H
 
 #include <reflex/absmatcher.h>
+#include <reflex/matcher.h>
+#include <reflex/pcre2prefilter.h>
 #define PCRE2_CODE_UNIT_WIDTH 8
 #include <pcre2.h>
+#include <atomic>
+
+/// PCRE2 JIT stack start size of a PCRE2Matcher, may be changed with PCRE2Matcher::jit_stack()
+#ifndef PCRE2MATCHER_JIT_STACK_START
+# define PCRE2MATCHER_JIT_STACK_START (32*1024)
+#endif
+
+/// PCRE2 JIT stack max size of a PCRE2Matcher, may be changed with PCRE2Matcher::jit_stack()
+#ifndef PCRE2MATCHER_JIT_STACK_MAX
+# define PCRE2MATCHER_JIT_STACK_MAX (512*1024)
+#endif
 
 namespace reflex {
 
@@ -59,7 +72,11 @@ class PCRE2Matcher : public PatternMatcher<std::string> {
       opc_(NULL),
       dat_(NULL),
       ctx_(NULL),
-      stk_(NULL)
+      stk_(NULL),
+      cod_(NULL),
+      pfm_(NULL),
+      sts_(PCRE2MATCHER_JIT_STACK_START),
+      stm_(PCRE2MATCHER_JIT_STACK_MAX)
   {
     reset();
   }
@@ -76,7 +93,11 @@ class PCRE2Matcher : public PatternMatcher<std::string> {
       opc_(NULL),
       dat_(NULL),
       ctx_(NULL),
-      stk_(NULL)
+      stk_(NULL),
+      cod_(NULL),
+      pfm_(NULL),
+      sts_(PCRE2MATCHER_JIT_STACK_START),
+      stm_(PCRE2MATCHER_JIT_STACK_MAX)
   {
     reset();
     compile();
@@ -94,7 +115,11 @@ class PCRE2Matcher : public PatternMatcher<std::string> {
       opc_(NULL),
       dat_(NULL),
       ctx_(NULL),
-      stk_(NULL)
+      stk_(NULL),
+      cod_(NULL),
+      pfm_(NULL),
+      sts_(PCRE2MATCHER_JIT_STACK_START),
+      stm_(PCRE2MATCHER_JIT_STACK_MAX)
   {
     reset();
     compile();
@@ -108,18 +133,16 @@ class PCRE2Matcher : public PatternMatcher<std::string> {
       opc_(NULL),
       dat_(NULL),
       ctx_(NULL),
-      stk_(NULL)
+      stk_(NULL),
+      cod_(NULL),
+      pfm_(NULL),
+      sts_(matcher.sts_),
+      stm_(matcher.stm_)
   {
     reset();
     cop_ = matcher.cop_;
     flg_ = matcher.flg_;
-#ifdef pcre2_code_copy_with_tables
-    opc_ = pcre2_code_copy_with_tables(matcher.opc_);
-    dat_ = pcre2_match_data_create_from_pattern(opc_, NULL);
-    jit_ = pcre2_jit_compile(opc_, PCRE2_JIT_COMPLETE | PCRE2_JIT_PARTIAL_HARD) == 0 && pcre2_pattern_info(opc_, PCRE2_INFO_JITSIZE, NULL) != 0;
-#else
-    compile();
-#endif
+    share(matcher.cod_);
   }
   /// Delete matcher.
   virtual ~PCRE2Matcher()
@@ -128,10 +151,7 @@ class PCRE2Matcher : public PatternMatcher<std::string> {
       pcre2_jit_stack_free(stk_);
     if (ctx_ != NULL)
       pcre2_match_context_free(ctx_);
-    if (dat_ != NULL)
-      pcre2_match_data_free(dat_);
-    if (opc_ != NULL)
-      pcre2_code_free(opc_);
+    release();
   }
   /// Assign a matcher.
   PCRE2Matcher& operator=(const PCRE2Matcher& matcher) ///< matcher to copy
@@ -156,7 +176,25 @@ class PCRE2Matcher : public PatternMatcher<std::string> {
       ctx_ = pcre2_match_context_create(NULL);
     if (ctx_ != NULL && stk_ == NULL)
     {
-      stk_ = pcre2_jit_stack_create(32*1024, 512*1024, NULL);
+      stk_ = pcre2_jit_stack_create(sts_, stm_, NULL);
+      pcre2_jit_stack_assign(ctx_, NULL, stk_);
+    }
+  }
+  /// Set the PCRE2 JIT stack start and max sizes of this matcher, the JIT stack is not shared by copies of this matcher.
+  void jit_stack(
+      size_t start, ///< JIT stack start size in bytes
+      size_t max)   ///< JIT stack max size in bytes
+  {
+    sts_ = start;
+    stm_ = max;
+    if (stk_ != NULL)
+    {
+      pcre2_jit_stack_free(stk_);
+      stk_ = NULL;
+    }
+    if (ctx_ != NULL)
+    {
+      stk_ = pcre2_jit_stack_create(sts_, stm_, NULL);
       pcre2_jit_stack_assign(ctx_, NULL, stk_);
     }
   }
@@ -168,23 +206,8 @@ class PCRE2Matcher : public PatternMatcher<std::string> {
     PatternMatcher<std::string>::pattern(matcher);
     cop_ = matcher.cop_;
     flg_ = matcher.flg_;
-#ifdef pcre2_code_copy_with_tables
-    if (dat_ != NULL)
-    {
-      pcre2_match_data_free(dat_);
-      dat_ = NULL;
-    }
-    if (opc_ != NULL)
-    {
-      pcre2_code_free(opc_);
-      opc_ = NULL;
-    }
-    opc_ = pcre2_code_copy_with_tables(matcher.opc_);
-    dat_ = pcre2_match_data_create_from_pattern(opc_, NULL);
-    jit_ = pcre2_jit_compile(opc_, PCRE2_JIT_COMPLETE | PCRE2_JIT_PARTIAL_HARD) == 0 && pcre2_pattern_info(opc_, PCRE2_INFO_JITSIZE, NULL) != 0;
-#else
-    compile();
-#endif
+    if (cod_ != matcher.cod_)
+      share(matcher.cod_);
     return *this;
   }
   /// Set the pattern regex string to use with this matcher (the given pattern is shared and must be persistent).
@@ -254,6 +277,59 @@ class PCRE2Matcher : public PatternMatcher<std::string> {
     return id();
   }
  protected:
+  /// Reference-counted PCRE2 compiled code shared by copies of a matcher, PCRE2 code is immutable and safe to match with concurrently.
+  struct Code {
+    Code(pcre2_code *opc, bool jit, reflex::Pattern *pre, size_t max)
+      :
+        opc(opc),
+        jit(jit),
+        pre(pre),
+        max(max),
+        ref(1)
+    { }
+    ~Code()
+    {
+      pcre2_code_free(opc);
+      delete pre;
+    }
+    pcre2_code         *opc; ///< PCRE2 compiled code
+    bool                jit; ///< true if jit-compiled PCRE2 code
+    reflex::Pattern    *pre; ///< DFA prefilter to find candidate matches or NULL
+    size_t              max; ///< max length of a DFA prefilter match
+    std::atomic<size_t> ref; ///< number of matchers sharing this code
+  };
+  /// Share the compiled code of another matcher and allocate match data for it.
+  void share(Code *code) ///< shared code or NULL
+  {
+    release();
+    if (code != NULL)
+    {
+      ++code->ref;
+      cod_ = code;
+      opc_ = code->opc;
+      jit_ = code->jit;
+      dat_ = pcre2_match_data_create_from_pattern(opc_, NULL);
+    }
+  }
+  /// Release the shared compiled code and the match data, delete the code when no longer shared.
+  void release()
+  {
+    if (dat_ != NULL)
+    {
+      pcre2_match_data_free(dat_);
+      dat_ = NULL;
+    }
+    if (pfm_ != NULL)
+    {
+      delete pfm_;
+      pfm_ = NULL;
+    }
+    if (cod_ != NULL && --cod_->ref == 0)
+      delete cod_;
+    cod_ = NULL;
+    opc_ = NULL;
+    jit_ = false;
+  }
   /// Translate group capture index to id pair (index,name)
   std::pair<size_t,const char*> id()
   {
@@ -279,16 +355,7 @@ class PCRE2Matcher : public PatternMatcher<std::string> {
   void compile()
   {
     DBGLOG("BEGIN PCRE2Matcher::compile()");
-    if (dat_ != NULL)
-    {
-      pcre2_match_data_free(dat_);
-      dat_ = NULL;
-    }
-    if (opc_ != NULL)
-    {
-      pcre2_code_free(opc_);
-      opc_ = NULL;
-    }
+    release();
     int err;
     PCRE2_SIZE pos;
     ASSERT(pat_ != NULL);
@@ -296,15 +363,39 @@ class PCRE2Matcher : public PatternMatcher<std::string> {
     if (cop_ & PCRE2_UTF)
       cop_ |= PCRE2_MATCH_INVALID_UTF; // recommended in the PCRE2 docs when using UTF-8
 #endif
-    opc_ = pcre2_compile(reinterpret_cast<PCRE2_SPTR>(pat_->c_str()), static_cast<PCRE2_SIZE>(pat_->size()), cop_, &err, &pos, NULL);
-    if (opc_ == NULL)
+    // a regex with backreferences, lookarounds or recursion gets a DFA prefilter to skip to candidate matches
+    PCRE2Prefilter filter(*pat_, (cop_ & PCRE2_UTF) != 0, (cop_ & PCRE2_UCP) != 0, (cop_ & PCRE2_CASELESS) != 0, (cop_ & PCRE2_EXTENDED) != 0);
+    bool usable = (cop_ & (PCRE2_ANCHORED | PCRE2_FIRSTLINE | PCRE2_LITERAL | PCRE2_ALT_BSUX)) == 0 && filter.usable();
+    uint32_t opt = cop_;
+#ifdef PCRE2_USE_OFFSET_LIMIT
+    if (usable)
+      opt |= PCRE2_USE_OFFSET_LIMIT; // to limit PCRE2 matching to the candidate matches found with the DFA prefilter
+#endif
+    pcre2_code *opc = pcre2_compile(reinterpret_cast<PCRE2_SPTR>(pat_->c_str()), static_cast<PCRE2_SIZE>(pat_->size()), opt, &err, &pos, NULL);
+    if (opc == NULL)
     {
       PCRE2_UCHAR message[120];
       pcre2_get_error_message(err, message, sizeof(message));
       throw regex_error(reinterpret_cast<char*>(message), *pat_, pos);
     }
-    jit_ = pcre2_jit_compile(opc_, PCRE2_JIT_COMPLETE | PCRE2_JIT_PARTIAL_HARD) == 0 && pcre2_pattern_info(opc_, PCRE2_INFO_JITSIZE, NULL) != 0;
-    dat_ = pcre2_match_data_create_from_pattern(opc_, NULL);
+    bool jit = pcre2_jit_compile(opc, PCRE2_JIT_COMPLETE | PCRE2_JIT_PARTIAL_HARD) == 0 && pcre2_pattern_info(opc, PCRE2_INFO_JITSIZE, NULL) != 0;
+    reflex::Pattern *pre = NULL;
+    if (usable)
+    {
+      try
+      {
+        pre = new reflex::Pattern(filter.regex());
+      }
+      catch (const regex_error&)
+      {
+        pre = NULL;
+      }
+    }
+    DBGLOGN("prefilter=%s", pre != NULL ? filter.regex().c_str() : "");
+    // the compiled and JIT'd code is shared by copies of this matcher
+    Code *code = new Code(opc, jit, pre, filter.max());
+    share(code);
+    --code->ref;
     DBGLOGN("jit=%d", jit_);
   }
   /// The match method Const::SCAN, Const::FIND, Const::SPLIT, or Const::MATCH, implemented with PCRE2.
@@ -363,6 +454,82 @@ class PCRE2Matcher : public PatternMatcher<std::string> {
     DBGLOG("END PCRE2Matcher::match()");
     return cap_;
   }
+  /// Skip ahead to the next candidate match in the buffer found with the DFA prefilter, returns true if PCRE2 should only match at this candidate.
+  bool prefilter_skip()
+    /// @returns true if a candidate match was found at pos_
+  {
+    if (pos_ >= end_ || end_ >= max_)
+      return false;
+    if (pfm_ == NULL)
+      pfm_ = new reflex::Matcher(*cod_->pre);
+    char c = buf_[end_];
+    buf_[end_] = '\0';
+    pfm_->buffer(buf_ + pos_, end_ - pos_ + 1);
+    bool cut = pfm_->find();
+    size_t loc = cut ? pos_ + pfm_->first() : end_;
+    buf_[end_] = c;
+    // a match that starts close to the end of the buffered input may extend beyond it, where the DFA prefilter cannot see it
+    if (!eof_ && cod_->max > end_ - loc)
+    {
+      loc = end_ > cod_->max ? end_ - cod_->max : 0;
+      cut = false;
+    }
+    DBGLOGN("prefilter skip %zu to %zu", pos_, loc);
+    if (loc > pos_)
+      pos_ = loc;
+    return cut;
+  }
+  /// Limit PCRE2 matching to start at pos_ when cut is true, returns PCRE2_ANCHORED to do so when the PCRE2 offset limit is not available.
+  uint32_t prefilter_limit(bool cut) ///< true to limit matching to start at pos_
+    /// @returns PCRE2_ANCHORED or 0
+  {
+#ifdef PCRE2_USE_OFFSET_LIMIT
+    if (ctx_ != NULL)
+    {
+      pcre2_set_offset_limit(ctx_, cut ? static_cast<PCRE2_SIZE>(pos_) : PCRE2_UNSET);
+      return 0;
+    }
+#endif
+    return cut ? PCRE2_ANCHORED : 0;
+  }
+  /// Invoke PCRE2 to match at pos_.
+  int exec_match(uint32_t flg) ///< PCRE2 match flags
+    /// @returns PCRE2 return code
+  {
+#ifdef PCRE2_MATCH_INVALID_UTF
+    if (jit_ && !(flg & PCRE2_ANCHORED))
+      return pcre2_jit_match(opc_, reinterpret_cast<PCRE2_SPTR>(buf_), end_, pos_, flg, dat_, ctx_);
+#endif
+    return pcre2_match(opc_, reinterpret_cast<PCRE2_SPTR>(buf_), end_, pos_, flg, dat_, ctx_);
+  }
+  /// Invoke PCRE2 to match at pos_, spending the work budget of backtracking steps in units of the PCRE2 match limit.
+  int budget_match(uint32_t flg) ///< PCRE2 match flags
+    /// @returns PCRE2 return code, PCRE2_ERROR_MATCHLIMIT when the budget is exhausted
+  {
+    if (ctx_ == NULL || stp_ == Const::UNLIMITED)
+      return exec_match(flg);
+    // PCRE2 does not report the steps taken: retry with a doubling match limit, spend the limits of the failed attempts
+    // and the limit of the previous attempt for the last attempt, which took more steps than that
+    size_t limit = 16;
+    size_t cost = 1;
+    while (true)
+    {
+      if (limit > stp_)
+        limit = stp_;
+      pcre2_set_match_limit(ctx_, static_cast<uint32_t>(std::min<size_t>(limit, 0xFFFFFFFF)));
+      int rc = exec_match(flg);
+      if (rc != PCRE2_ERROR_MATCHLIMIT)
+      {
+        stp_ -= std::min(stp_, cost);
+        return rc;
+      }
+      stp_ -= limit;
+      if (stp_ == 0)
+        return rc;
+      cost = limit;
+      limit *= 2;
+    }
+  }
   /// Perform next PCRE2 match, return true if a match is found.
   bool next_match(Method method) ///< match method Const::SCAN, Const::FIND, Const::SPLIT, or Const::MATCH
     /// @returns true when PCRE2 match found
@@ -378,16 +545,25 @@ class PCRE2Matcher : public PatternMatcher<std::string> {
       flg |= PCRE2_NOTEMPTY;
     else if (method == Const::FIND || method == Const::SPLIT)
       flg_ &= ~(PCRE2_NOTEMPTY_ATSTART | PCRE2_ANCHORED);
+    if (ctx_ != NULL && stp_ == Const::UNLIMITED)
+    {
+      uint32_t limit;
+      (void)pcre2_config(PCRE2_CONFIG_MATCHLIMIT, &limit);
+      pcre2_set_match_limit(ctx_, limit);
+    }
     while (true)
     {
+      // with a DFA prefilter, PCRE2 only matches at the next candidate match
+      bool cut = false;
+      uint32_t opt = flg;
+      if (cod_->pre != NULL)
+      {
+        if (method == Const::FIND && (flg & PCRE2_ANCHORED) == 0)
+          cut = prefilter_skip();
+        opt |= prefilter_limit(cut);
+      }
       DBGLOGN("pcre2_match() pos = %zu end = %zu", pos_, end_);
-      int rc;
-#ifdef PCRE2_MATCH_INVALID_UTF
-      if (jit_ && !(flg & PCRE2_ANCHORED))
-        rc = pcre2_jit_match(opc_, reinterpret_cast<PCRE2_SPTR>(buf_), end_, pos_, flg, dat_, ctx_);
-      else
-#endif
-        rc = pcre2_match(opc_, reinterpret_cast<PCRE2_SPTR>(buf_), end_, pos_, flg, dat_, ctx_);
+      int rc = budget_match(opt);
       if (rc > 0)
       {
         PCRE2_SIZE *ovector = pcre2_get_ovector_pointer(dat_);
@@ -416,6 +592,13 @@ class PCRE2Matcher : public PatternMatcher<std::string> {
       }
       else if (rc == PCRE2_ERROR_NOMATCH && (method == Const::FIND || method == Const::SPLIT))
       {
+        if (cut)
+        {
+          // no match at the candidate, find the next candidate with the DFA prefilter
+          ++pos_;
+          txt_ = buf_ + pos_;
+          continue;
+        }
         if ((flg & PCRE2_NOTEMPTY_ATSTART) != 0)
         {
           if (at_end())
@@ -430,6 +613,13 @@ class PCRE2Matcher : public PatternMatcher<std::string> {
         if (peek_more() == EOF) // read more text into the buffer after end_
           return false;
       }
+      else if (rc == PCRE2_ERROR_MATCHLIMIT && stp_ != Const::UNLIMITED)
+      {
+        // the work budget of backtracking steps is exhausted
+        stp_ = 0;
+        interrupt();
+        return false;
+      }
       else
       {
 #if defined(DEBUG)
@@ -451,6 +641,10 @@ class PCRE2Matcher : public PatternMatcher<std::string> {
   pcre2_jit_stack     *stk_; ///< PCRE2 jit match stack
   PCRE2_SIZE           grp_; ///< last index for group_next_id()
   bool                 jit_; ///< true if jit-compiled PCRE2 code
+  Code                *cod_; ///< shared reference-counted PCRE2 code
+  reflex::Matcher     *pfm_; ///< DFA prefilter matcher or NULL
+  size_t               sts_; ///< PCRE2 JIT stack start size
+  size_t               stm_; ///< PCRE2 JIT stack max size
 };
 
 /// PCRE2 JIT-optimized native PCRE2_UTF+PCRE2_UCP matcher engine class, extends PCRE2Matcher.
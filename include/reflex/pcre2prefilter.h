@@ -0,0 +1,138 @@
+/******************************************************************************\
+* Copyright (c) 2016, Robert van Engelen, Genivia Inc. All rights reserved.    *
+*                                                                              *
+* Redistribution and use in source and binary forms, with or without           *
+* modification, are permitted provided that the following conditions are met:  *
+*                                                                              *
+*   (1) Redistributions of source code must retain the above copyright notice, *
+*       this list of conditions and the following disclaimer.                  *
+*                                                                              *
+*   (2) Redistributions in binary form must reproduce the above copyright      *
+*       notice, this list of conditions and the following disclaimer in the    *
+*       documentation and/or other materials provided with the distribution.   *
+*                                                                              *
+*   (3) The name of the author may not be used to endorse or promote products  *
+*       derived from this software without specific prior written permission.  *
+*                                                                              *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF         *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO   *
+* EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,       *
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, *
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;  *
+* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,     *
+* WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR      *
+* OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF       *
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                                   *
+\******************************************************************************/
+
+/**
+@file      pcre2prefilter.h
+@brief     DFA prefilter regex for PCRE2 regex
+@author    Robert van Engelen - engelen@genivia.com
+@copyright (c) 2016-2020, Robert van Engelen, Genivia Inc. All rights reserved.
+@copyright (c) BSD-3 License - see LICENSE.txt
+*/
+
+#ifndef REFLEX_PCRE2PREFILTER_H
+#define REFLEX_PCRE2PREFILTER_H
+
+#include <cstddef>
+#include <string>
+
+namespace reflex {
+
+/// Over-approximation of a PCRE2 regex by a reflex::Pattern regex that matches a prefix of every PCRE2 match, to find candidate match positions with a DFA.
+class PCRE2Prefilter {
+ public:
+  /// Convert a PCRE2 regex to a DFA regex, backreferences and recursion cut the regex short, lookarounds and anchors are dropped.
+  PCRE2Prefilter(
+      const std::string& regex, ///< PCRE2 regex
+      bool               utf,   ///< PCRE2_UTF mode
+      bool               ucp,   ///< PCRE2_UCP mode
+      bool               icase, ///< PCRE2_CASELESS mode
+      bool               ext);  ///< PCRE2_EXTENDED mode
+  /// Returns true if the DFA regex is a useful prefilter for a regex that requires PCRE2 (backreferences, lookarounds, recursion).
+  bool usable() const
+    /// @returns true if usable
+  {
+    return !bad_ && hyb_ && !top_.nul && !top_.str.empty();
+  }
+  /// Returns the DFA regex.
+  const std::string& regex() const
+    /// @returns DFA regex string
+  {
+    return top_.str;
+  }
+  /// Returns the maximum length of a DFA regex match in bytes.
+  size_t max() const
+    /// @returns max length
+  {
+    return top_.max;
+  }
+ protected:
+  /// Maximum number of repeats of a bounded repeat to keep in the DFA regex.
+  static const size_t MAXREP = 16;
+  /// DFA regex part with its properties.
+  struct Item {
+    Item() : nul(true), cut(false), max(0) { }
+    std::string str; ///< DFA regex
+    bool        nul; ///< true if nullable
+    bool        cut; ///< true if the regex is cut short, the rest of the enclosing sequence is dropped
+    size_t      max; ///< max length of a match
+  };
+  /// Parse an alternation up to a closing `)` or the end of the regex.
+  void alternation(Item& item, bool icase, bool ext);
+  /// Parse a sequence of quantified atoms up to a `|`, a closing `)`, or the end of the regex.
+  void sequence(Item& seq, bool& icase, bool& ext);
+  /// Skip white space and comments in extended mode.
+  void space(bool ext);
+  /// Parse a quantifier and apply it to the item.
+  void quantifier(Item& item);
+  /// Parse a `{n}`, `{n,}` or `{n,m}` repeat, returns false if not a repeat, leaves loc_ at the closing brace.
+  bool repeat(size_t& min, size_t& max, bool& inf);
+  /// Parse a decimal number.
+  size_t number(size_t& k);
+  /// Parse an atom.
+  void atom(Item& item, bool& icase, bool& ext);
+  /// Parse a group.
+  void group(Item& item, bool& icase, bool& ext);
+  /// Parse a bracket list, exact for ASCII lists, otherwise approximated by any character.
+  void bracket(Item& item, bool icase);
+  /// Parse an escape outside of a bracket list.
+  void escape(Item& item, bool icase);
+  /// Parse a character escape at loc_, returns the character code, -2 for a character class escape, or -1 when not supported.
+  int code();
+  /// Parse a literal character.
+  void literal(Item& item, bool icase);
+  /// Translate a character code to the DFA regex.
+  void character(Item& item, int c, bool icase);
+  /// Any single character, a UTF-8 encoded character in UTF mode.
+  void any(Item& item);
+  /// A backreference cuts the regex short.
+  void backreference(Item& item);
+  /// Returns true if ASCII character c is in PCRE2 class \d, \w or \s.
+  static bool shorthand(char e, int c);
+  /// Returns the value of a hex digit or -1.
+  static int digit(char c);
+  /// Append \xHH to the DFA regex.
+  static void hex(std::string& str, int c);
+  /// Append a decimal number to the DFA regex.
+  static void dec(std::string& str, size_t n);
+  /// Saturating addition of lengths.
+  static size_t add(size_t a, size_t b);
+  /// Saturating multiplication of lengths.
+  static size_t mul(size_t a, size_t b);
+  const std::string& rex_; ///< PCRE2 regex
+  size_t             loc_; ///< current location in the PCRE2 regex
+  bool               utf_; ///< PCRE2_UTF mode
+  bool               ucp_; ///< PCRE2_UCP mode
+  bool               bad_; ///< true if the regex cannot be approximated
+  bool               hyb_; ///< true if the regex requires PCRE2
+  bool               quo_; ///< true when parsing \\Q...\\E quoted characters
+  Item               top_; ///< DFA regex
+};
+
+} // namespace reflex
+
+#endif
@@ -138,6 +138,9 @@ extern size_t simd_nlcount_sse2(const char*& b, const char *e);
 extern size_t simd_nlcount_avx2(const char*& b, const char *e);
 extern size_t simd_nlcount_avx512bw(const char*& b, const char *e);
 
+// Returns the end of the valid UTF-8 prefix of string b up to e checked in blocks of 32 bytes, stops at the start of the UTF-8 sequence that is invalid or incomplete in the block
+extern const char *simd_utf8_avx2(const char *b, const char *e);
+
 } // namespace reflex
 
 #endif
@@ -0,0 +1,258 @@
+/******************************************************************************\
+* Copyright (c) 2016, Robert van Engelen, Genivia Inc. All rights reserved.    *
+*                                                                              *
+* Redistribution and use in source and binary forms, with or without           *
+* modification, are permitted provided that the following conditions are met:  *
+*                                                                              *
+*   (1) Redistributions of source code must retain the above copyright notice, *
+*       this list of conditions and the following disclaimer.                  *
+*                                                                              *
+*   (2) Redistributions in binary form must reproduce the above copyright      *
+*       notice, this list of conditions and the following disclaimer in the    *
+*       documentation and/or other materials provided with the distribution.   *
+*                                                                              *
+*   (3) The name of the author may not be used to endorse or promote products  *
+*       derived from this software without specific prior written permission.  *
+*                                                                              *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF         *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO   *
+* EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,       *
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, *
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;  *
+* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,     *
+* WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR      *
+* OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF       *
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                                   *
+\******************************************************************************/
+
+/**
+@file      trace.h
+@brief     Tracing of nanosecond timed spans exported as Chrome trace JSON
+@author    Robert van Engelen - engelen@genivia.com
+@copyright (c) 2016-2024, Robert van Engelen, Genivia Inc. All rights reserved.
+@copyright (c) BSD-3 License - see LICENSE.txt
+
+Tracing is disabled by default.  Compile the RE/flex library and the
+application with `-DWITH_TRACE=1` to record spans of pattern compilation, input
+buffer growth, Input::get(), Matcher::advance() and scanner rule actions that
+are generated with reflex option `--trace`.  Without WITH_TRACE only the
+REFLEX_TRACE_SPAN macro is defined, which expands to nothing.
+*/
+
+#ifndef REFLEX_TRACE_H
+#define REFLEX_TRACE_H
+
+#ifndef WITH_TRACE
+#define WITH_TRACE 0
+#endif
+
+#if WITH_TRACE
+#define REFLEX_TRACE_CONCAT(a, b) a ## b
+#define REFLEX_TRACE_SPAN_NAME(line) REFLEX_TRACE_CONCAT(reflex_trace_span_, line)
+/// Record a span named by a string literal from here to the end of the enclosing scope, when compiled with WITH_TRACE enabled.
+#define REFLEX_TRACE_SPAN(name) reflex::Trace::Span REFLEX_TRACE_SPAN_NAME(__LINE__)(name)
+#else
+#define REFLEX_TRACE_SPAN(name) (void)0
+#endif
+
+#if WITH_TRACE
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <ostream>
+#include <vector>
+#include <stdint.h>
+
+namespace reflex {
+
+/// Tracing of spans with a monotonic nanosecond clock, recorded in thread-local ring buffers and exported as Chrome/Perfetto trace event JSON.
+/**
+Spans are recorded with the REFLEX_TRACE_SPAN(name) macro, which records the
+time from the macro to the end of the enclosing scope when compiled with
+WITH_TRACE enabled and expands to nothing otherwise.  Each thread records its
+spans in its own ring buffer of capacity() events without locking, the oldest
+events are overwritten when the ring buffer is full.
+
+The recorded spans are exported with export_json() as Chrome trace event JSON
+that can be loaded in chrome://tracing and https://ui.perfetto.dev.  Export
+and clear() the spans when the traced threads are idle or finished:
+
+```{.cpp}
+    reflex::Trace::capacity() = 1000000; // before any span is recorded
+    ... // scan input
+    reflex::Trace::export_json("trace.json");
+```
+*/
+class Trace {
+ public:
+  /// A span recorded with its name, start time and duration in nanoseconds.
+  struct Event {
+    const char *name;  ///< name of the span, a string literal
+    uint64_t    start; ///< start time in ns
+    uint64_t    dur;   ///< duration in ns
+  };
+  /// Ring buffer of the spans recorded by a thread.
+  struct Ring {
+    Ring(
+        size_t   size, ///< capacity
+        uint32_t tid)  ///< thread number
+      :
+        events(size > 0 ? size : 1),
+        count(0),
+        tid(tid)
+    { }
+    std::vector<Event> events; ///< the last events.size() spans recorded
+    size_t             count;  ///< number of spans recorded
+    uint32_t           tid;    ///< thread number, starting at 1
+  };
+  /// Scoped span that is recorded when destroyed.
+  class Span {
+   public:
+    /// Start a span.
+    Span(const char *name) ///< name of the span, a string literal
+      :
+        name_(name),
+        start_(now())
+    { }
+    /// Record the span.
+    ~Span()
+    {
+      record(name_, start_, now() - start_);
+    }
+   private:
+    const char *name_;  ///< name of the span
+    uint64_t    start_; ///< start time in ns
+  };
+  /// Returns the time of a monotonic clock in nanoseconds.
+  static uint64_t now()
+    /// @returns time in ns
+  {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+  }
+  /// Get or set the capacity of the ring buffers of threads that record their first span after it is set, 65536 by default.
+  static size_t& capacity()
+    /// @returns reference to the capacity
+  {
+    static size_t size = 65536;
+    return size;
+  }
+  /// Record a span in the ring buffer of this thread.
+  static void record(
+      const char *name,  ///< name of the span, a string literal
+      uint64_t    start, ///< start time in ns
+      uint64_t    dur)   ///< duration in ns
+  {
+    Ring& r = ring();
+    Event& event = r.events[r.count++ % r.events.size()];
+    event.name = name;
+    event.start = start;
+    event.dur = dur;
+  }
+  /// Returns the number of spans recorded and kept in the ring buffers of all threads.
+  static size_t size()
+    /// @returns number of spans
+  {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    size_t n = 0;
+    for (std::vector<Ring*>::const_iterator i = reg.rings.begin(); i != reg.rings.end(); ++i)
+      n += (*i)->count < (*i)->events.size() ? (*i)->count : (*i)->events.size();
+    return n;
+  }
+  /// Discard the spans recorded by all threads.
+  static void clear()
+  {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    for (std::vector<Ring*>::iterator i = reg.rings.begin(); i != reg.rings.end(); ++i)
+      (*i)->count = 0;
+  }
+  /// Export the spans recorded by all threads as Chrome trace event JSON.
+  static void export_json(std::ostream& os) ///< output stream
+  {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    const char *sep = "\n";
+    char buf[128];
+    os << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    for (std::vector<Ring*>::const_iterator i = reg.rings.begin(); i != reg.rings.end(); ++i)
+    {
+      const Ring& r = **i;
+      size_t size = r.events.size();
+      size_t from = r.count > size ? r.count - size : 0;
+      for (size_t k = from; k < r.count; ++k)
+      {
+        const Event& event = r.events[k % size];
+        os << sep << "{\"name\":\"";
+        for (const char *s = event.name; *s != '\0'; ++s)
+        {
+          if (*s == '"' || *s == '\\')
+            os << '\\' << *s;
+          else if (static_cast<unsigned char>(*s) >= 0x20)
+            os << *s;
+        }
+        // timestamps and durations are in microseconds with nanosecond precision
+        snprintf(buf, sizeof(buf), "\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%llu.%03u,\"dur\":%llu.%03u}",
+            r.tid,
+            static_cast<unsigned long long>(event.start / 1000),
+            static_cast<unsigned>(event.start % 1000),
+            static_cast<unsigned long long>(event.dur / 1000),
+            static_cast<unsigned>(event.dur % 1000));
+        os << buf;
+        sep = ",\n";
+      }
+    }
+    os << "\n]}\n";
+  }
+  /// Export the spans recorded by all threads as Chrome trace event JSON to a file.
+  static bool export_json(const char *filename) ///< name of the file to write
+    /// @returns true if successful
+  {
+    std::ofstream ofs(filename);
+    if (!ofs.is_open())
+      return false;
+    export_json(ofs);
+    return ofs.good();
+  }
+ private:
+  /// The ring buffers of all threads that recorded spans.
+  struct Registry {
+    ~Registry()
+    {
+      for (std::vector<Ring*>::iterator i = rings.begin(); i != rings.end(); ++i)
+        delete *i;
+    }
+    std::mutex         mutex; ///< protects rings
+    std::vector<Ring*> rings; ///< ring buffers, owned
+  };
+  /// Returns the registry.
+  static Registry& registry()
+    /// @returns reference to the registry
+  {
+    static Registry reg;
+    return reg;
+  }
+  /// Returns the ring buffer of this thread, adds a new ring buffer to the registry when this thread records its first span.
+  static Ring& ring()
+    /// @returns reference to the ring buffer
+  {
+    static thread_local Ring *r = NULL;
+    if (r == NULL)
+    {
+      Registry& reg = registry();
+      std::lock_guard<std::mutex> lock(reg.mutex);
+      r = new Ring(capacity(), static_cast<uint32_t>(reg.rings.size() + 1));
+      reg.rings.push_back(r);
+    }
+    return *r;
+  }
+};
+
+} // namespace reflex
+
+#endif
+
+#endif
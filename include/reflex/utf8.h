@@ -217,45 +217,12 @@ inline int utf8(
   return c;
 }
 
-/// Convert UTF-8 string to wide string.
-inline std::wstring wcs(
+/// Convert UTF-8 string to wide string, ASCII is converted in blocks with SIMD when available.
+std::wstring wcs(
     const char *s, ///< string with UTF-8 to convert
     size_t      n) ///< length of the string to convert
   /// @returns wide string
-{
-  std::wstring ws;
-  const char *e = s + n;
-  if (sizeof(wchar_t) == 2)
-  {
-    // sizeof(wchar_t) == 2 bytes: store wide string in std::wstring encoded in UTF-16
-    while (s < e)
-    {
-      int wc = utf8(s, &s);
-      if (wc > 0xFFFF)
-      {
-        if (wc <= 0x10FFFF)
-        {
-          ws.push_back(0xD800 | (wc - 0x010000) >> 10); // first half of UTF-16 surrogate pair
-          ws.push_back(0xDC00 | (wc & 0x03FF));         // second half of UTF-16 surrogate pair
-        }
-        else
-        {
-          ws.push_back(0xFFFD);
-        }
-      }
-      else
-      {
-        ws.push_back(wc);
-      }
-    }
-  }
-  else
-  {
-    while (s < e)
-      ws.push_back(utf8(s, &s));
-  }
-  return ws;
-}
+  ;
 
 /// Convert UTF-8 string to wide string.
 inline std::wstring wcs(const std::string& s) ///< string with UTF-8 to convert
@@ -35,7 +35,9 @@
 */
 
 #include <reflex/input.h>
+#include <reflex/simd.h>
 #include <stdio.h>
+#include <wchar.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 
@@ -747,6 +749,459 @@ void Input::file_init()
   }
 }
 
+size_t Input::dos_get(char *s, size_t n)
+{
+  while (n > 0)
+  {
+    size_t k = 0;
+    if (lah_ != EOF)
+    {
+      // a byte read ahead after a CR that was held back
+      s[k++] = static_cast<char>(lah_);
+      lah_ = EOF;
+    }
+    else if (dcr_)
+    {
+      // a CR held back at the end of the last block is kept unless LF follows
+      dcr_ = false;
+      if (n == 1)
+      {
+        char c;
+        if (raw_get(&c, 1) == 0)
+        {
+          *s = '\r';
+          return 1;
+        }
+        if (c == '\n')
+        {
+          *s = '\n';
+          return 1;
+        }
+        if (c == '\r')
+          dcr_ = true;
+        else
+          lah_ = static_cast<unsigned char>(c);
+        *s = '\r';
+        return 1;
+      }
+      s[k++] = '\r';
+    }
+    size_t m = k < n ? raw_get(s + k, n - k) : 0;
+    if (m == 0)
+      return k;
+    k += m;
+    // replace CRLF by LF in place, skip quickly to the first CR
+    const char *p = static_cast<const char*>(std::memchr(s, '\r', k));
+    if (p == NULL)
+      return k;
+    char *t = s + (p - s);
+    const char *e = s + k;
+#if defined(HAVE_AVX512BW) || defined(HAVE_AVX2) || defined(HAVE_SSE2)
+    // compact 16 byte blocks, the stores to t <= p never overwrite bytes that are not yet loaded
+    __m128i vcr = _mm_set1_epi8('\r');
+    __m128i vlf = _mm_set1_epi8('\n');
+    while (p + 16 < e)
+    {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+      __m128i w = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 1));
+      uint32_t mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(v, vcr), _mm_cmpeq_epi8(w, vlf)));
+      if (mask == 0)
+      {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(t), v);
+        t += 16;
+      }
+      else
+      {
+        for (int i = 0; i < 16; ++i, mask >>= 1)
+          if ((mask & 1) == 0)
+            *t++ = p[i];
+      }
+      p += 16;
+    }
+#endif
+    while (p < e)
+    {
+      if (*p == '\r')
+      {
+        if (p + 1 == e)
+        {
+          dcr_ = true;
+          break;
+        }
+        if (p[1] == '\n')
+        {
+          ++p;
+          continue;
+        }
+      }
+      *t++ = *p++;
+    }
+    k = t - s;
+    if (k > 0)
+      return k;
+    // the block was just a CR that is held back, read more
+  }
+  return 0;
+}
+
+// length of the valid UTF-8 sequence at p before e, or zero when the sequence is invalid or incomplete
+static size_t utf8_valid_length(const char *p, const char *e)
+{
+  int c = static_cast<unsigned char>(*p);
+  if (c < 0x80)
+    return 1;
+  if (c < 0xC2 || c > 0xF4)
+    return 0;
+  size_t l = 2 + (c >= 0xE0) + (c >= 0xF0);
+  if (static_cast<size_t>(e - p) < l)
+    return 0;
+  // the second byte range excludes overlong forms, surrogates and code points beyond U+10FFFF
+  int c1 = static_cast<unsigned char>(p[1]);
+  if (c1 < (c == 0xE0 ? 0xA0 : c == 0xF0 ? 0x90 : 0x80) || c1 > (c == 0xED ? 0x9F : c == 0xF4 ? 0x8F : 0xBF))
+    return 0;
+  for (size_t i = 2; i < l; ++i)
+    if ((p[i] & 0xC0) != 0x80)
+      return 0;
+  return l;
+}
+
+// length of the maximal subpart of the invalid UTF-8 sequence at p before e, sets incomplete when the subpart is a valid prefix cut off by e
+static size_t utf8_invalid_length(const char *p, const char *e, bool& incomplete)
+{
+  incomplete = false;
+  int c = static_cast<unsigned char>(*p);
+  if (c < 0xC2 || c > 0xF4)
+    return 1;
+  size_t l = 2 + (c >= 0xE0) + (c >= 0xF0);
+  size_t i;
+  for (i = 1; i < l; ++i)
+  {
+    if (p + i >= e)
+    {
+      incomplete = true;
+      break;
+    }
+    int ci = static_cast<unsigned char>(p[i]);
+    if (i == 1 ? ci < (c == 0xE0 ? 0xA0 : c == 0xF0 ? 0x90 : 0x80) || ci > (c == 0xED ? 0x9F : c == 0xF4 ? 0x8F : 0xBF) : (ci & 0xC0) != 0x80)
+      break;
+  }
+  return i;
+}
+
+// the end of the valid UTF-8 prefix of [p,e), which is the start of the first invalid UTF-8 sequence or of an incomplete sequence at the end
+static const char *utf8_scan(const char *p, const char *e)
+{
+  while (p < e)
+  {
+#if defined(HAVE_AVX512BW) || defined(HAVE_AVX2)
+    if (have_HW_AVX2())
+      p = simd_utf8_avx2(p, e);
+#endif
+#if defined(HAVE_AVX512BW) || defined(HAVE_AVX2) || defined(HAVE_SSE2)
+    // skip blocks of ASCII
+    while (e - p >= 16 && _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))) == 0)
+      p += 16;
+#endif
+    // check up to 64 bytes one UTF-8 sequence at a time before trying blocks again
+    const char *q = e - p > 64 ? p + 64 : e;
+    while (p < q)
+    {
+      if (static_cast<unsigned char>(*p) < 0x80)
+      {
+        ++p;
+        continue;
+      }
+      size_t l = utf8_valid_length(p, e);
+      if (l == 0)
+        return p;
+      p += l;
+    }
+  }
+  return p;
+}
+
+size_t Input::utf8_get(char *s, size_t n)
+{
+  size_t k = 0;
+  while (k < n)
+  {
+    if (vskp_ > 0)
+    {
+      // pass on the held back bytes that were validated or replaced
+      size_t l = vskp_ < n - k ? vskp_ : n - k;
+      std::memcpy(s + k, vbuf_.data() + vpos_, l);
+      k += l;
+      vpos_ += l;
+      vskp_ -= l;
+      if (vpos_ >= vbuf_.size())
+      {
+        vbuf_.clear();
+        vpos_ = 0;
+      }
+      continue;
+    }
+    size_t r = vbuf_.size() - vpos_;
+    if (r < n - k && (r == 0 || k == 0))
+    {
+      // read a block after the bytes held back and validate it in place
+      std::memcpy(s + k, vbuf_.data() + vpos_, r);
+      vbuf_.clear();
+      vpos_ = 0;
+      size_t m = dos_ ? dos_get(s + k + r, n - k - r) : raw_get(s + k + r, n - k - r);
+      if (m == 0 && r == 0)
+        break;
+      const char *p = s + k;
+      const char *e = p + r + m;
+      const char *q;
+      size_t l = 0;
+      bool incomplete = false;
+      while (true)
+      {
+        q = utf8_scan(p, e);
+        vnum_ += q - p;
+        if (q >= e)
+          break;
+        l = utf8_invalid_length(q, e, incomplete);
+        if (incomplete && m > 0)
+          break;
+        // invalid UTF-8, or a truncated UTF-8 sequence at the end of the input
+        if (verr_ == npos)
+          verr_ = vnum_;
+        if (val_ == utf8_validation::repair)
+          break;
+        vnum_ += l;
+        p = q + l;
+      }
+      if (q >= e || (val_ != utf8_validation::repair && !incomplete))
+      {
+        // report mode passes on invalid UTF-8
+        k = e - s;
+        break;
+      }
+      k = q - s;
+      if (incomplete && m > 0)
+      {
+        // hold back the incomplete sequence until the next block is read
+        vbuf_.assign(q, e - q);
+        if (k > 0)
+          break;
+        continue;
+      }
+      // replace the invalid subsequence by U+FFFD and hold back the rest of the block
+      vnum_ += l;
+      vbuf_.assign(q + l, e - q - l);
+      if (n - k >= 3)
+      {
+        std::memcpy(s + k, "\xEF\xBF\xBD", 3);
+        k += 3;
+      }
+      else
+      {
+        vbuf_.insert(0, "\xEF\xBF\xBD", 3);
+        vskp_ = 3;
+      }
+      continue;
+    }
+    // validate the bytes held back
+    const char *p = vbuf_.data() + vpos_;
+    const char *e = vbuf_.data() + vbuf_.size();
+    const char *q = utf8_scan(p, e);
+    if (q > p)
+    {
+      vnum_ += q - p;
+      vskp_ = q - p;
+      continue;
+    }
+    bool incomplete;
+    size_t l = utf8_invalid_length(p, e, incomplete);
+    if (incomplete)
+    {
+      if (k > 0)
+        break;
+      // not enough room in s to read ahead, append a few bytes to complete the sequence
+      char buf[4];
+      size_t m = dos_ ? dos_get(buf, sizeof(buf)) : raw_get(buf, sizeof(buf));
+      if (m > 0)
+      {
+        vbuf_.append(buf, m);
+        continue;
+      }
+    }
+    // invalid UTF-8, or a truncated UTF-8 sequence at the end of the input
+    if (verr_ == npos)
+      verr_ = vnum_;
+    vnum_ += l;
+    if (val_ == utf8_validation::repair)
+    {
+      vbuf_.replace(vpos_, l, "\xEF\xBF\xBD", 3);
+      vskp_ = 3;
+    }
+    else
+    {
+      vskp_ = l;
+    }
+  }
+  return k;
+}
+
+// length of the UTF-8 sequence that utf8() stores for a UCS-4 character
+static inline size_t utf8_size(int c)
+{
+  if (c < 0x80)
+    return 1;
+#ifndef WITH_UTF8_UNRESTRICTED
+  if (c > 0x10FFFF)
+    return sizeof(REFLEX_NONCHAR_UTF8) - 1; // REFLEX_NONCHAR_UTF8 is a literal string, not a pointer
+  return 2 + (c >= 0x0800) + (c >= 0x010000);
+#else
+  return 2 + (c >= 0x0800) + (c >= 0x010000) + (c >= 0x200000) + (c >= 0x04000000);
+#endif
+}
+
+// number of leading wide characters in [s,s+n) that are ASCII in blocks of 16, converted to 8-bit characters stored in t
+static size_t wcs_ascii(const wchar_t *s, size_t n, char *t)
+{
+  size_t k = 0;
+#if defined(HAVE_AVX512BW) || defined(HAVE_AVX2) || defined(HAVE_SSE2)
+  if (sizeof(wchar_t) == 2)
+  {
+    const __m128i vff80 = _mm_set1_epi16(static_cast<short>(0xFF80));
+    for (; k + 16 <= n; k += 16)
+    {
+      __m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + k));
+      __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + k + 8));
+      if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(_mm_or_si128(v0, v1), vff80), _mm_setzero_si128())) != 0xFFFF)
+        break;
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(t + k), _mm_packus_epi16(v0, v1));
+    }
+  }
+  else if (sizeof(wchar_t) == 4)
+  {
+    const __m128i vff80 = _mm_set1_epi32(static_cast<int>(0xFFFFFF80));
+    for (; k + 16 <= n; k += 16)
+    {
+      __m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + k));
+      __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + k + 4));
+      __m128i v2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + k + 8));
+      __m128i v3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + k + 12));
+      __m128i vor = _mm_or_si128(_mm_or_si128(v0, v1), _mm_or_si128(v2, v3));
+      if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(vor, vff80), _mm_setzero_si128())) != 0xFFFF)
+        break;
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(t + k), _mm_packus_epi16(_mm_packs_epi32(v0, v1), _mm_packs_epi32(v2, v3)));
+    }
+  }
+#else
+  (void)s;
+  (void)n;
+  (void)t;
+#endif
+  return k;
+}
+
+size_t Input::iovec_get(char *s, size_t n)
+{
+  size_t k = 0;
+  while (k < n && iovcnt_ > 0)
+  {
+    size_t l = iovec_->iov_len - iovpos_;
+    if (l > n - k)
+      l = n - k;
+    std::memcpy(s + k, static_cast<const char*>(iovec_->iov_base) + iovpos_, l);
+    k += l;
+    iovpos_ += l;
+    if (iovpos_ >= iovec_->iov_len)
+    {
+      ++iovec_;
+      --iovcnt_;
+      iovpos_ = 0;
+    }
+  }
+  size_ -= k;
+  return k;
+}
+
+size_t Input::wstring_get(char *s, size_t n)
+{
+  char *t = s;
+  if (ulen_ > 0)
+  {
+    size_t l = ulen_;
+    if (l > n)
+      l = n;
+    std::memcpy(t, utf8_ + uidx_, l);
+    t += l;
+    if (l == n)
+    {
+      uidx_ += static_cast<unsigned short>(l);
+      ulen_ -= static_cast<unsigned short>(l);
+      if (size_ >= n)
+        size_ -= n;
+      return n;
+    }
+    ulen_ = 0;
+  }
+  // each wide character produces at least one byte, get the length of the part of the wide string to convert
+  const char *e = s + n;
+  const wchar_t *w = wstring_;
+  const wchar_t *x = w + wcsnlen(w, e - t);
+  const wchar_t *r = w;
+  while (w < x)
+  {
+    if (w >= r)
+    {
+      // convert ASCII runs in bulk, when there is no ASCII block then retry after 16 more wide characters
+      size_t k = wcs_ascii(w, x - w, t);
+      w += k;
+      t += k;
+      r = w + 16;
+      if (w >= x)
+        break;
+    }
+    unsigned int c = static_cast<unsigned int>(*w);
+    if (c < 0x80)
+    {
+      *t++ = static_cast<char>(c);
+      ++w;
+      continue;
+    }
+    size_t l;
+    if (c >= 0xD800 && c < 0xE000)
+    {
+      // UTF-16 surrogate pair
+      if (c < 0xDC00 && (w[1] & 0xFC00) == 0xDC00)
+        l = utf8(0x010000 - 0xDC00 + ((c - 0xD800) << 10) + *++w, utf8_);
+      else
+        l = utf8(REFLEX_NONCHAR, utf8_);
+    }
+    else
+    {
+      l = utf8(static_cast<int>(c), utf8_);
+    }
+    ++w;
+    if (static_cast<size_t>(e - t) < l)
+    {
+      size_t m = e - t;
+      std::memcpy(t, utf8_, m);
+      uidx_ = static_cast<unsigned short>(m);
+      ulen_ = static_cast<unsigned short>(l - m);
+      t += m;
+      break;
+    }
+    std::memcpy(t, utf8_, l);
+    t += l;
+    if (t >= e)
+      break;
+    // make sure the remaining wide characters fit
+    if (x > w + (e - t))
+      x = w + (e - t);
+  }
+  wstring_ = w;
+  size_t k = t - s;
+  if (size_ >= k)
+    size_ -= k;
+  return k;
+}
+
 size_t Input::file_get(char *s, size_t n)
 {
   char *t = s;
@@ -793,7 +1248,7 @@ size_t Input::file_get(char *s, size_t n)
           {
             std::memcpy(t, utf8_, n);
             uidx_ = static_cast<unsigned short>(n);
-            ulen_ = static_cast<unsigned short>(l);
+            ulen_ = static_cast<unsigned short>(l - n);
             t += n;
             n = 0;
           }
@@ -832,7 +1287,7 @@ size_t Input::file_get(char *s, size_t n)
           {
             std::memcpy(t, utf8_, n);
             uidx_ = static_cast<unsigned short>(n);
-            ulen_ = static_cast<unsigned short>(l);
+            ulen_ = static_cast<unsigned short>(l - n);
             t += n;
             n = 0;
           }
@@ -863,7 +1318,7 @@ size_t Input::file_get(char *s, size_t n)
           {
             std::memcpy(t, utf8_, n);
             uidx_ = static_cast<unsigned short>(n);
-            ulen_ = static_cast<unsigned short>(l);
+            ulen_ = static_cast<unsigned short>(l - n);
             t += n;
             n = 0;
           }
@@ -894,7 +1349,7 @@ size_t Input::file_get(char *s, size_t n)
           {
             std::memcpy(t, utf8_, n);
             uidx_ = static_cast<unsigned short>(n);
-            ulen_ = static_cast<unsigned short>(l);
+            ulen_ = static_cast<unsigned short>(l - n);
             t += n;
             n = 0;
           }
@@ -931,7 +1386,7 @@ size_t Input::file_get(char *s, size_t n)
           else
           {
             uidx_ = 1;
-            ulen_ = 2;
+            ulen_ = 1;
           }
         }
       }
@@ -985,7 +1440,7 @@ size_t Input::file_get(char *s, size_t n)
           {
             std::memcpy(t, utf8_, n);
             uidx_ = static_cast<unsigned short>(n);
-            ulen_ = static_cast<unsigned short>(l);
+            ulen_ = static_cast<unsigned short>(l - n);
             t += n;
             n = 0;
           }
@@ -1008,153 +1463,250 @@ size_t Input::file_get(char *s, size_t n)
   }
 }
 
+#if defined(HAVE_AVX512BW) || defined(HAVE_AVX2) || defined(HAVE_SSE2)
+
+// sum of the four 32 bit lanes
+static inline uint32_t hsum_epi32(__m128i v)
+{
+  v = _mm_add_epi32(v, _mm_shuffle_epi32(v, 0x4E));
+  v = _mm_add_epi32(v, _mm_shuffle_epi32(v, 0xB1));
+  return static_cast<uint32_t>(_mm_cvtsi128_si32(v));
+}
+
+// number of UTF-8 bytes of the UTF-16 units in [*p,e) counted 8 units at a time, stops at the first block with a surrogate
+static size_t utf16_blocks_size(const unsigned char *& p, const unsigned char *e, bool be)
+{
+  const __m128i vff80 = _mm_set1_epi16(static_cast<short>(0xFF80));
+  const __m128i vf800 = _mm_set1_epi16(static_cast<short>(0xF800));
+  const __m128i vd800 = _mm_set1_epi16(static_cast<short>(0xD800));
+  const __m128i vzero = _mm_setzero_si128();
+  const __m128i vone = _mm_set1_epi16(1);
+  size_t size = 0;
+  while (e - p >= 16)
+  {
+    // 3 bytes per unit, minus one for each unit < 0x800 and minus one more for each unit < 0x80, summed in 32 bit lanes per chunk
+    size_t m = (e - p) / 16;
+    if (m > 65536)
+      m = 65536;
+    __m128i vsum = vzero;
+    size_t i;
+    for (i = 0; i < m; ++i)
+    {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+      if (be)
+        v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+      __m128i vhi = _mm_and_si128(v, vf800);
+      if (_mm_movemask_epi8(_mm_cmpeq_epi16(vhi, vd800)) != 0)
+        break;
+      __m128i vlt = _mm_add_epi16(_mm_cmpeq_epi16(_mm_and_si128(v, vff80), vzero), _mm_cmpeq_epi16(vhi, vzero));
+      vsum = _mm_sub_epi32(vsum, _mm_madd_epi16(vlt, vone));
+      p += 16;
+    }
+    size += 24 * i - hsum_epi32(vsum);
+    if (i < m)
+      break;
+  }
+  return size;
+}
+
+#endif
+
 void Input::wstring_size()
 {
-  unsigned int c;
-  for (const wchar_t *s = wstring_; (c = *s) != L'\0'; ++s)
+  const wchar_t *s = wstring_;
+  const wchar_t *e = s + wcslen(s);
+  size_t size = ulen_;
+  while (s < e)
   {
-    if (c >= 0xD800 && c < 0xE000)
+#if defined(HAVE_AVX512BW) || defined(HAVE_AVX2) || defined(HAVE_SSE2)
+    // count the UTF-8 bytes of 8 (UTF-16) or 4 (UCS-4) wide characters at a time while there are no surrogates or invalid code points
+    if (sizeof(wchar_t) == 2)
     {
-      if (c < 0xDC00 && (s[1] & 0xFC00) == 0xDC00)
+      const unsigned char *p = reinterpret_cast<const unsigned char*>(s);
+      size += utf16_blocks_size(p, reinterpret_cast<const unsigned char*>(e), false);
+      s = reinterpret_cast<const wchar_t*>(p);
+    }
+    else if (sizeof(wchar_t) == 4)
+    {
+      const __m128i v007f = _mm_set1_epi32(0x7F);
+      const __m128i v07ff = _mm_set1_epi32(0x07FF);
+      const __m128i vffff = _mm_set1_epi32(0xFFFF);
+      const __m128i vmax = _mm_set1_epi32(0x10FFFF);
+      const __m128i vf800 = _mm_set1_epi32(static_cast<int>(0xFFFFF800));
+      const __m128i vd800 = _mm_set1_epi32(0xD800);
+      const __m128i vzero = _mm_setzero_si128();
+      while (e - s >= 4)
       {
-        ++s;
-        size_ += 4;
+        // 1 byte per wide character, plus one for each > 0x7F, > 0x7FF and > 0xFFFF, summed in 32 bit lanes per chunk
+        size_t m = (e - s) / 4;
+        if (m > 65536)
+          m = 65536;
+        __m128i vsum = vzero;
+        size_t i;
+        for (i = 0; i < m; ++i)
+        {
+          __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+          // negative, > U+10FFFF or a surrogate
+          __m128i vbad = _mm_or_si128(_mm_or_si128(_mm_cmplt_epi32(v, vzero), _mm_cmpgt_epi32(v, vmax)), _mm_cmpeq_epi32(_mm_and_si128(v, vf800), vd800));
+          if (_mm_movemask_epi8(vbad) != 0)
+            break;
+          vsum = _mm_sub_epi32(vsum, _mm_add_epi32(_mm_cmpgt_epi32(v, v007f), _mm_add_epi32(_mm_cmpgt_epi32(v, v07ff), _mm_cmpgt_epi32(v, vffff))));
+          s += 4;
+        }
+        size += 4 * i + hsum_epi32(vsum);
+        if (i < m)
+          break;
       }
+    }
+    if (s >= e)
+      break;
+#endif
+    // count one wide character in the same way as wstring_get() converts it
+    unsigned int c = static_cast<unsigned int>(*s++);
+    if (c >= 0xD800 && c < 0xE000)
+    {
+      if (c < 0xDC00 && (*s & 0xFC00) == 0xDC00)
+        size += utf8_size(static_cast<int>(0x010000 - 0xDC00 + ((c - 0xD800) << 10) + *s++));
       else
-      {
-        size_ += sizeof(REFLEX_NONCHAR_UTF8) - 1; // REFLEX_NONCHAR_UTF8 is a literal string, not a pointer
-      }
+        size += utf8_size(REFLEX_NONCHAR);
     }
     else
     {
-#ifndef WITH_UTF8_UNRESTRICTED
-      size_ += 1 + (c >= 0x80) + (c >= 0x0800) + (c >= 0x010000);
-#else
-      size_ += 1 + (c >= 0x80) + (c >= 0x0800) + (c >= 0x010000) + (c >= 0x200000) + (c >= 0x04000000);
-#endif
+      size += utf8_size(static_cast<int>(c));
     }
   }
+  size_ = size;
 }
 
-void Input::file_size()
+// number of UTF-8 bytes of the UTF-16 units in [*p,e), consumes units in the same way as file_get(), stops before a high surrogate at e unless eof
+static size_t utf16_size(const unsigned char *& p, const unsigned char *e, bool be, bool eof)
 {
-  off_t k = ftello(file_);
-  if (k >= 0)
+  size_t size = 0;
+#if defined(HAVE_AVX512BW) || defined(HAVE_AVX2) || defined(HAVE_SSE2)
+  size += utf16_blocks_size(p, e, be);
+#endif
+  while (p + 2 <= e)
   {
-    unsigned char buf[4];
-    switch (utfx_)
+    int c = be ? p[0] << 8 | p[1] : p[0] | p[1] << 8;
+    if (c >= 0xD800 && c < 0xE000)
     {
-      case file_encoding::latin:
-        while (::fread(buf, 1, 1, file_) == 1)
-          size_ += 1 + (buf[0] >= 0x80);
-        break;
-      case file_encoding::cp437:
-      case file_encoding::cp850:
-      case file_encoding::cp858:
-      case file_encoding::ebcdic:
-      case file_encoding::cp1250:
-      case file_encoding::cp1251:
-      case file_encoding::cp1252:
-      case file_encoding::cp1253:
-      case file_encoding::cp1254:
-      case file_encoding::cp1255:
-      case file_encoding::cp1256:
-      case file_encoding::cp1257:
-      case file_encoding::cp1258:
-      case file_encoding::iso8859_2:
-      case file_encoding::iso8859_3:
-      case file_encoding::iso8859_4:
-      case file_encoding::iso8859_5:
-      case file_encoding::iso8859_6:
-      case file_encoding::iso8859_7:
-      case file_encoding::iso8859_8:
-      case file_encoding::iso8859_9:
-      case file_encoding::iso8859_10:
-      case file_encoding::iso8859_11:
-      case file_encoding::iso8859_13:
-      case file_encoding::iso8859_14:
-      case file_encoding::iso8859_15:
-      case file_encoding::iso8859_16:
-      case file_encoding::macroman:
-      case file_encoding::koi8_r:
-      case file_encoding::koi8_u:
-      case file_encoding::koi8_ru:
-      case file_encoding::custom:
-        while (::fread(buf, 1, 1, file_) == 1)
-        {
-          int c = page_[buf[0]];
-          size_ += 1 + (c >= 0x80) + (c >= 0x0800); // + (c >= 0x010000); NOTE: page_[] value range < Unicode range
-        }
-        break;
-      case file_encoding::utf16be:
-        while (::fread(buf, 2, 1, file_) == 1)
+      // UTF-16 surrogate pair
+      if (c < 0xDC00)
+      {
+        if (p + 4 > e)
         {
-          int c = buf[0] << 8 | buf[1];
-          if (c >= 0xD800 && c < 0xE000)
-          {
-            // UTF-16 surrogate pair
-            if (c < 0xDC00 && ::fread(buf + 2, 2, 1, file_) == 1 && (buf[2] & 0xFC) == 0xDC)
-              c = 0x010000 - 0xDC00 + ((c - 0xD800) << 10) + (buf[2] << 8 | buf[3]);
-            else
-              c = REFLEX_NONCHAR;
-          }
-#ifndef WITH_UTF8_UNRESTRICTED
-          else if (c > 0x10FFFF)
-          {
-            c = REFLEX_NONCHAR;
-          }
-#endif
-          size_ += 1 + (c >= 0x80) + (c >= 0x0800) + (c >= 0x010000) + (c >= 0x200000);
+          if (!eof)
+            break;
+          // a lone high surrogate at the end, file_get() attempts to read the next unit
+          p = e;
+          size += utf8_size(REFLEX_NONCHAR);
+          break;
         }
-        break;
-      case file_encoding::utf16le:
-        while (::fread(buf, 2, 1, file_) == 1)
-        {
-          int c = buf[0] | buf[1] << 8;
-          if (c >= 0xD800 && c < 0xE000)
-          {
-            // UTF-16 surrogate pair
-            if (c < 0xDC00 && ::fread(buf + 2, 2, 1, file_) == 1 && (buf[2] & 0xFC) == 0xDC)
-              c = 0x010000 - 0xDC00 + ((c - 0xD800) << 10) + (buf[2] << 8 | buf[3]);
-            else
-              c = REFLEX_NONCHAR;
-          }
-#ifndef WITH_UTF8_UNRESTRICTED
-          else if (c > 0x10FFFF)
-          {
-            c = REFLEX_NONCHAR;
-          }
+        int d = be ? p[2] << 8 | p[3] : p[2] | p[3] << 8;
+        p += 4;
+        size += (d & 0xFC00) == 0xDC00 ? 4 : utf8_size(REFLEX_NONCHAR);
+        continue;
+      }
+      c = REFLEX_NONCHAR;
+    }
+    size += utf8_size(c);
+    p += 2;
+  }
+  return size;
+}
+
+bool Input::file_regular() const
+{
+#if !defined(HAVE_CONFIG_H) || defined(HAVE_FSTAT)
+#if (defined(__WIN32__) || defined(_WIN32) || defined(WIN32) || defined(_WIN64) || defined(__BORLANDC__)) && !defined(__CYGWIN__) && !defined(__MINGW32__) && !defined(__MINGW64__)
+  struct _stat st;
+  return _fstat(_fileno(file_), &st) == 0 && (st.st_mode & S_IFMT) == S_IFREG;
+#else
+  struct stat st;
+  return ::fstat(::fileno(file_), &st) == 0 && S_ISREG(st.st_mode);
 #endif
-          size_ += 1 + (c >= 0x80) + (c >= 0x0800) + (c >= 0x010000) + (c >= 0x200000);
-        }
-        break;
-      case file_encoding::utf32be:
-        while (::fread(buf, 4, 1, file_) == 1)
-        {
-          int c = buf[0] << 24 | buf[1] << 16 | buf[2] << 8 | buf[3];
-#ifndef WITH_UTF8_UNRESTRICTED
-          if (c > 0x10FFFF)
-            c = REFLEX_NONCHAR;
+#else
+  // without fstat() we cannot tell, assume the file may block when read ahead
+  return false;
 #endif
-          size_ += 1 + (c >= 0x80) + (c >= 0x0800) + (c >= 0x010000) + (c >= 0x200000);
-        }
-        break;
-      case file_encoding::utf32le:
-        while (::fread(buf, 4, 1, file_) == 1)
+}
+
+void Input::file_size()
+{
+  off_t k = ftello(file_);
+  if (k >= 0)
+  {
+    if (utfx_ == file_encoding::plain || utfx_ == file_encoding::utf8)
+    {
+      fseeko(file_, 0, SEEK_END);
+      off_t n = ftello(file_);
+      if (n >= k)
+        size_ = static_cast<size_t>(n - k) + ulen_;
+    }
+    else
+    {
+      // count the UTF-8 size of the converted input in blocks, the same as file_get() converts it
+      unsigned char buf[16384];
+      unsigned char len[256];
+      if (utfx_ == file_encoding::latin)
+        for (int i = 0; i < 256; ++i)
+          len[i] = 1 + (i >= 0x80);
+      else if (page_ != NULL)
+        for (int i = 0; i < 256; ++i)
+          len[i] = static_cast<unsigned char>(utf8_size(page_[i]));
+      size_t size = ulen_;
+      size_t r = 0;
+      while (true)
+      {
+        size_t m = ::fread(buf + r, 1, sizeof(buf) - r, file_);
+        bool eof = m < sizeof(buf) - r;
+        const unsigned char *p = buf;
+        const unsigned char *e = buf + r + m;
+        switch (utfx_)
         {
-          int c = buf[0] | buf[1] << 8 | buf[2] << 16 | buf[3] << 24;
-#ifndef WITH_UTF8_UNRESTRICTED
-          if (c > 0x10FFFF)
-            c = REFLEX_NONCHAR;
+          case file_encoding::utf16be:
+            size += utf16_size(p, e, true, eof);
+            break;
+          case file_encoding::utf16le:
+            size += utf16_size(p, e, false, eof);
+            break;
+          case file_encoding::utf32be:
+            for (; p + 4 <= e; p += 4)
+              size += utf8_size(p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3]);
+            break;
+          case file_encoding::utf32le:
+            for (; p + 4 <= e; p += 4)
+              size += utf8_size(p[0] | p[1] << 8 | p[2] << 16 | p[3] << 24);
+            break;
+          case file_encoding::latin:
+#if defined(HAVE_AVX512BW) || defined(HAVE_AVX2) || defined(HAVE_SSE2)
+            // one byte plus one more for each byte >= 0x80
+            {
+              const __m128i vone = _mm_set1_epi8(1);
+              __m128i vsum = _mm_setzero_si128();
+              for (; e - p >= 16; p += 16)
+              {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+                vsum = _mm_add_epi64(vsum, _mm_sad_epu8(_mm_and_si128(_mm_srli_epi16(v, 7), vone), _mm_setzero_si128()));
+                size += 16;
+              }
+              size += static_cast<size_t>(_mm_cvtsi128_si32(vsum)) + static_cast<size_t>(_mm_cvtsi128_si32(_mm_unpackhi_epi64(vsum, vsum)));
+            }
 #endif
-          size_ += 1 + (c >= 0x80) + (c >= 0x0800) + (c >= 0x010000) + (c >= 0x200000);
+            // fall through
+          default:
+            if (page_ == NULL && utfx_ != file_encoding::latin)
+              break;
+            for (; p < e; ++p)
+              size += len[*p];
         }
-        break;
-      default:
-        fseeko(file_, k, SEEK_END);
-        off_t n = ftello(file_);
-        if (n >= k)
-          size_ = static_cast<size_t>(n - k);
+        if (eof)
+          break;
+        // move the remaining partial unit to the front of the buffer
+        r = e - p;
+        std::memmove(buf, p, r);
+      }
+      size_ = size;
     }
     ::clearerr(file_);
     fseeko(file_, k, SEEK_SET);
@@ -0,0 +1,492 @@
+/******************************************************************************\
+* Copyright (c) 2016, Robert van Engelen, Genivia Inc. All rights reserved.    *
+*                                                                              *
+* Redistribution and use in source and binary forms, with or without           *
+* modification, are permitted provided that the following conditions are met:  *
+*                                                                              *
+*   (1) Redistributions of source code must retain the above copyright notice, *
+*       this list of conditions and the following disclaimer.                  *
+*                                                                              *
+*   (2) Redistributions in binary form must reproduce the above copyright      *
+*       notice, this list of conditions and the following disclaimer in the    *
+*       documentation and/or other materials provided with the distribution.   *
+*                                                                              *
+*   (3) The name of the author may not be used to endorse or promote products  *
+*       derived from this software without specific prior written permission.  *
+*                                                                              *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF         *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO   *
+* EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,       *
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, *
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;  *
+* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,     *
+* WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR      *
+* OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF       *
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                                   *
+\******************************************************************************/
+
+/**
+@file      jit.cpp
+@brief     RE/flex x86-64 JIT compiler of pattern opcode tables to FSM code
+@author    Robert van Engelen - engelen@genivia.com
+@copyright (c) 2016-2022, Robert van Engelen, Genivia Inc. All rights reserved.
+@copyright (c) BSD-3 License - see LICENSE.txt
+
+   Pattern::jit_code() translates the opcode table of a pattern to native
+   x86-64 code that behaves like the FSM code generated with reflex --fast,
+   such that Matcher::match() runs the JIT code with pat_->fsm_.
+
+   The DFA transitions are inlined: the JIT code keeps the input position and
+   the end of the buffered input in registers, reads the next byte from the
+   matcher's buffer and selects the next state with a binary search over the
+   byte ranges of the state.  The JIT code only calls out to the matcher to
+   buffer more input and for the FSM_* operations FIND, SKIP, HEAD, TAIL and
+   HALT, after storing the input position in the matcher.
+
+   The JIT code has no unwind info, therefore the functions called by the JIT
+   code catch exceptions, which are rethrown by jit_rethrow() when the JIT code
+   returned to Matcher::match().
+
+   The machine code is written to a private anonymous mmap'd region that is
+   made executable and read-only with mprotect() after the code is written.
+
+   When not compiled for x86-64 with the System V AMD64 calling convention,
+   or when the opcodes contain META opcodes (anchors, word boundaries and
+   indents) that require the opcode interpreter, jit_code() does nothing and
+   the Matcher falls back to the opcode interpreter.
+*/
+
+#include <reflex/matcher.h>
+#include <exception>
+
+#if defined(__x86_64__) && (defined(__unix__) || defined(__APPLE__)) && !defined(__CYGWIN__)
+# define REFLEX_JIT_X64
+# include <sys/mman.h>
+# include <unistd.h>
+#endif
+
+namespace reflex {
+
+#if defined(REFLEX_JIT_X64)
+
+// exception thrown by a matcher method called from JIT code, rethrown by jit_rethrow()
+static thread_local std::exception_ptr jit_exception;
+
+// FSM callbacks invoked by JIT code with the Matcher pointer passed in the first argument register
+static int jit_char(Matcher *m)
+{
+  if (jit_exception)
+    return EOF;
+  try
+  {
+    return m->FSM_CHAR();
+  }
+  catch (...)
+  {
+    jit_exception = std::current_exception();
+  }
+  return EOF;
+}
+
+static void jit_find(Matcher *m)
+{
+  m->FSM_FIND();
+}
+
+static void jit_skip(Matcher *m, int c0, int c1, int c2)
+{
+  try
+  {
+    m->FSM_SKIP(c0, c1, c2);
+  }
+  catch (...)
+  {
+    jit_exception = std::current_exception();
+  }
+}
+
+static void jit_head(Matcher *m, uint32_t la)
+{
+  try
+  {
+    m->FSM_HEAD(static_cast<uint16_t>(la));
+  }
+  catch (...)
+  {
+    jit_exception = std::current_exception();
+  }
+}
+
+static void jit_tail(Matcher *m, uint32_t la)
+{
+  m->FSM_TAIL(static_cast<uint16_t>(la));
+}
+
+static void jit_halt(Matcher *m, int c1)
+{
+  m->FSM_HALT(c1);
+}
+
+// byte offsets of the matcher members that the JIT code reads and writes
+struct JITMatcher : public Matcher {
+  JITMatcher()
+    :
+      buf(offset(&buf_)),
+      cap(offset(&cap_)),
+      cur(offset(&cur_)),
+      pos(offset(&pos_)),
+      end(offset(&end_))
+  { }
+  uint32_t offset(const void *member) const
+  {
+    return static_cast<uint32_t>(static_cast<const char*>(member) - reinterpret_cast<const char*>(static_cast<const Matcher*>(this)));
+  }
+  uint32_t buf;
+  uint32_t cap;
+  uint32_t cur;
+  uint32_t pos;
+  uint32_t end;
+};
+
+// x86-64 machine code buffer with forward jump fixups, the JIT code keeps the matcher in rbx, the last char in r12d, and the buffer pointers buf_ + pos_ in r13 and buf_ + end_ in r14
+struct JIT {
+  // emit a byte
+  void byte(uint8_t b)
+  {
+    code.push_back(b);
+  }
+  // emit a 32 bit immediate
+  void imm32(uint32_t n)
+  {
+    for (int i = 0; i < 32; i += 8)
+      byte(static_cast<uint8_t>(n >> i));
+  }
+  // mov rdi, rbx ; pass the matcher as the first argument
+  void arg_matcher()
+  {
+    byte(0x48); byte(0x89); byte(0xDF);
+  }
+  // mov esi, n ; pass n as the second argument
+  void arg_esi(uint32_t n)
+  {
+    byte(0xBE); imm32(n);
+  }
+  // mov rax, fn ; call rax
+  void call(const void *fn)
+  {
+    uint64_t n = reinterpret_cast<uint64_t>(fn);
+    byte(0x48); byte(0xB8);
+    imm32(static_cast<uint32_t>(n));
+    imm32(static_cast<uint32_t>(n >> 32));
+    byte(0xFF); byte(0xD0);
+  }
+  // mov rax, r13 ; sub rax, [rbx + buf_] ; the current position pos_ in rax
+  void position(const JITMatcher& m)
+  {
+    byte(0x4C); byte(0x89); byte(0xE8);
+    byte(0x48); byte(0x2B); byte(0x83); imm32(m.buf);
+  }
+  // mov [rbx + pos_], rax ; store the current position in the matcher before calling out
+  void store(const JITMatcher& m)
+  {
+    position(m);
+    byte(0x48); byte(0x89); byte(0x83); imm32(m.pos);
+  }
+  // mov r13, [rbx + buf_] ; add r13, [rbx + pos_] ; mov r14, [rbx + buf_] ; add r14, [rbx + end_] ; load the buffer pointers after calling out
+  void load(const JITMatcher& m)
+  {
+    byte(0x4C); byte(0x8B); byte(0xAB); imm32(m.buf);
+    byte(0x4C); byte(0x03); byte(0xAB); imm32(m.pos);
+    byte(0x4C); byte(0x8B); byte(0xB3); imm32(m.buf);
+    byte(0x4C); byte(0x03); byte(0xB3); imm32(m.end);
+  }
+  // mov qword [rbx + cap_], cap ; mov [rbx + cur_], rax ; FSM_TAKE(cap) inlined
+  void take(const JITMatcher& m, uint32_t cap)
+  {
+    byte(0x48); byte(0xC7); byte(0x83); imm32(m.cap); imm32(cap);
+    position(m);
+    byte(0x48); byte(0x89); byte(0x83); imm32(m.cur);
+  }
+  // jcc rel32 with condition code cc or jmp rel32 when cc is 0, returns position of rel32 to fix up
+  size_t jump(uint8_t cc)
+  {
+    if (cc == 0)
+    {
+      byte(0xE9);
+    }
+    else
+    {
+      byte(0x0F); byte(cc);
+    }
+    imm32(0);
+    return code.size() - 4;
+  }
+  // fix up rel32 at position at to jump to position to
+  void patch(size_t at, size_t to)
+  {
+    uint32_t rel = static_cast<uint32_t>(static_cast<int32_t>(to - (at + 4)));
+    for (int i = 0; i < 4; ++i)
+      code[at + i] = static_cast<uint8_t>(rel >> (8 * i));
+  }
+  std::vector<uint8_t> code;
+};
+
+// a range of chars lo..hi with the same next state
+struct JITRange {
+  uint16_t lo;
+  uint16_t hi;
+  uint32_t next;
+};
+
+#endif
+
+void Pattern::jit_code()
+{
+  jit_free();
+#if defined(REFLEX_JIT_X64)
+  if (opc_ == NULL)
+    return;
+  static const uint8_t JB  = 0x82;
+  static const uint8_t JAE = 0x83;
+  static const uint8_t JMP = 0x00;
+  const JITMatcher offsets;
+  JIT jit;
+  std::map<Index,size_t> label;                     // state opcode index -> code position
+  std::vector<std::pair<size_t,Index> > fixups;     // rel32 positions to fix up with the code position of a state
+  std::vector<size_t> halts;                        // rel32 positions to fix up with the code position of HALT
+  std::vector<size_t> exits;                        // rel32 positions to fix up with the code position of RET
+  std::vector<Index> states;                        // states to compile
+  // push rbx ; push r12 ; push r13 ; push r14 ; sub rsp, 8 ; mov rbx, rdi
+  jit.byte(0x53);
+  jit.byte(0x41); jit.byte(0x54);
+  jit.byte(0x41); jit.byte(0x55);
+  jit.byte(0x41); jit.byte(0x56);
+  jit.byte(0x48); jit.byte(0x83); jit.byte(0xEC); jit.byte(0x08);
+  jit.byte(0x48); jit.byte(0x89); jit.byte(0xFB);
+  jit.load(offsets);
+  states.push_back(0);
+  label[0] = 0;
+  for (size_t k = 0; k < states.size(); ++k)
+  {
+    Index index = states[k];
+    label[index] = jit.code.size();
+    const Opcode *pc = opc_ + index;
+    if (index == 0)
+    {
+      jit.store(offsets);
+      jit.arg_matcher();
+      jit.call(reinterpret_cast<const void*>(&jit_find));
+    }
+    while (!is_opcode_goto(*pc))
+    {
+      Opcode opcode = *pc++;
+      switch (opcode >> 24)
+      {
+        case 0xFE: // TAKE
+          jit.take(offsets, long_index_of(opcode));
+          break;
+        case 0xFD: // REDO
+          jit.take(offsets, static_cast<uint32_t>(AbstractMatcher::Const::REDO));
+          break;
+        case 0xFC: // TAIL
+          jit.store(offsets);
+          jit.arg_matcher();
+          jit.arg_esi(lookahead_of(opcode));
+          jit.call(reinterpret_cast<const void*>(&jit_tail));
+          break;
+        case 0xFB: // HEAD
+          jit.store(offsets);
+          jit.arg_matcher();
+          jit.arg_esi(lookahead_of(opcode));
+          jit.call(reinterpret_cast<const void*>(&jit_head));
+          break;
+        case 0xFA: // SKIP
+          jit.store(offsets);
+          jit.arg_matcher();
+          jit.arg_esi((opcode >> 16) & 0xFF);
+          jit.byte(0xBA); jit.imm32((opcode >> 8) & 0xFF); // mov edx, c1
+          jit.byte(0xB9); jit.imm32(opcode & 0xFF);        // mov ecx, c2
+          jit.call(reinterpret_cast<const void*>(&jit_skip));
+          jit.load(offsets);
+          break;
+        default: // META opcodes require the opcode interpreter
+          DBGLOG("JIT fallback to opcodes: code[%u] = 0x%08X", index, opcode);
+          return;
+      }
+    }
+    // the next state of each char, the first GOTO that covers a char takes precedence
+    Index next[256];
+    bool covered[256] = { false };
+    int count = 0;
+    bool read = false;
+    while (count < 256)
+    {
+      Opcode opcode = *pc;
+      if (!is_opcode_goto(opcode))
+        return;
+      Index jump = index_of(opcode);
+      if (jump == Const::LONG)
+        jump = long_index_of(*++pc);
+      ++pc;
+      Char lo = opcode >> 24;
+      Char hi = (opcode >> 16) & 0xFF;
+      for (Char c = lo; c <= hi; ++c)
+      {
+        if (!covered[c])
+        {
+          covered[c] = true;
+          next[c] = jump;
+          ++count;
+          read = read || jump != Const::HALT;
+        }
+      }
+    }
+    if (!read)
+    {
+      // HALT without reading a char: mov esi, UNK ; call halt ; jmp ret
+      jit.store(offsets);
+      jit.arg_matcher();
+      jit.arg_esi(AbstractMatcher::Const::UNK);
+      jit.call(reinterpret_cast<const void*>(&jit_halt));
+      exits.push_back(jit.jump(JMP));
+      continue;
+    }
+    // cmp r13, r14 ; jae more ; movzx r12d, byte [r13] ; inc r13
+    jit.byte(0x4D); jit.byte(0x39); jit.byte(0xF5);
+    size_t more = jit.jump(JAE);
+    jit.byte(0x45); jit.byte(0x0F); jit.byte(0xB6); jit.byte(0x65); jit.byte(0x00);
+    jit.byte(0x49); jit.byte(0xFF); jit.byte(0xC5);
+    size_t dispatch = jit.code.size();
+    // binary search the ranges of chars with the same next state
+    std::vector<JITRange> ranges;
+    for (Char c = 0; c < 256; ++c)
+    {
+      if (ranges.empty() || ranges.back().next != next[c])
+      {
+        JITRange range = { c, c, next[c] };
+        ranges.push_back(range);
+      }
+      else
+      {
+        ranges.back().hi = c;
+      }
+    }
+    std::vector<std::pair<size_t,size_t> > spans(1, std::pair<size_t,size_t>(0, ranges.size()));
+    std::vector<size_t> lefts; // rel32 positions of jb to the left span, in the order of the left spans to emit
+    std::vector<std::pair<size_t,size_t> > pending;
+    while (!spans.empty())
+    {
+      std::pair<size_t,size_t> span = spans.back();
+      spans.pop_back();
+      if (span.second - span.first == 1)
+      {
+        size_t at = jit.jump(JMP);
+        if (ranges[span.first].next == Const::HALT)
+        {
+          halts.push_back(at);
+        }
+        else
+        {
+          fixups.push_back(std::pair<size_t,Index>(at, ranges[span.first].next));
+          if (label.find(ranges[span.first].next) == label.end())
+          {
+            label[ranges[span.first].next] = 0;
+            states.push_back(ranges[span.first].next);
+          }
+        }
+      }
+      else
+      {
+        // cmp r12d, lo ; jb left ; fall through to the right
+        size_t mid = (span.first + span.second) / 2;
+        jit.byte(0x41); jit.byte(0x81); jit.byte(0xFC); jit.imm32(ranges[mid].lo);
+        size_t at = jit.jump(JB);
+        spans.push_back(std::pair<size_t,size_t>(span.first, mid));
+        pending.push_back(std::pair<size_t,size_t>(at, spans.size()));
+        spans.push_back(std::pair<size_t,size_t>(mid, span.second));
+      }
+      // patch jb to the left span when the left span is next to emit
+      while (!pending.empty() && pending.back().second == spans.size())
+      {
+        jit.patch(pending.back().first, jit.code.size());
+        pending.pop_back();
+      }
+    }
+    // more: mov [rbx + pos_], rax ; call char ; load ; mov r12d, eax ; test eax, eax ; jns dispatch ; jmp halt
+    jit.patch(more, jit.code.size());
+    jit.store(offsets);
+    jit.arg_matcher();
+    jit.call(reinterpret_cast<const void*>(&jit_char));
+    jit.load(offsets);
+    jit.byte(0x41); jit.byte(0x89); jit.byte(0xC4);
+    jit.byte(0x85); jit.byte(0xC0);
+    jit.patch(jit.jump(0x89), dispatch);
+    halts.push_back(jit.jump(JMP));
+  }
+  // HALT: store ; mov rdi, rbx ; mov esi, r12d ; call halt
+  size_t halt = jit.code.size();
+  jit.store(offsets);
+  jit.arg_matcher();
+  jit.byte(0x44); jit.byte(0x89); jit.byte(0xE6);
+  jit.call(reinterpret_cast<const void*>(&jit_halt));
+  // RET: add rsp, 8 ; pop r14 ; pop r13 ; pop r12 ; pop rbx ; ret
+  size_t ret = jit.code.size();
+  jit.byte(0x48); jit.byte(0x83); jit.byte(0xC4); jit.byte(0x08);
+  jit.byte(0x41); jit.byte(0x5E);
+  jit.byte(0x41); jit.byte(0x5D);
+  jit.byte(0x41); jit.byte(0x5C);
+  jit.byte(0x5B);
+  jit.byte(0xC3);
+  for (std::vector<std::pair<size_t,Index> >::const_iterator i = fixups.begin(); i != fixups.end(); ++i)
+    jit.patch(i->first, label[i->second]);
+  for (std::vector<size_t>::const_iterator i = halts.begin(); i != halts.end(); ++i)
+    jit.patch(*i, halt);
+  for (std::vector<size_t>::const_iterator i = exits.begin(); i != exits.end(); ++i)
+    jit.patch(*i, ret);
+  // W^X: write the code to a writable region, then make it executable and read-only
+  size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  size_t size = (jit.code.size() + page - 1) / page * page;
+  void *mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mem == MAP_FAILED)
+    return;
+  memcpy(mem, &jit.code[0], jit.code.size());
+  if (mprotect(mem, size, PROT_READ | PROT_EXEC) != 0)
+  {
+    munmap(mem, size);
+    return;
+  }
+  jit_ = mem;
+  jsz_ = size;
+  fsm_ = reinterpret_cast<FSM>(reinterpret_cast<uintptr_t>(mem));
+  DBGLOG("JIT code %p with %zu bytes for %zu states", mem, jit.code.size(), states.size());
+#endif
+}
+
+void Pattern::jit_free()
+{
+  if (jit_ != NULL)
+  {
+#if defined(REFLEX_JIT_X64)
+    munmap(jit_, jsz_);
+#endif
+    if (fsm_ == reinterpret_cast<FSM>(reinterpret_cast<uintptr_t>(jit_)))
+      fsm_ = NULL;
+    jit_ = NULL;
+    jsz_ = 0;
+  }
+}
+
+void Pattern::jit_rethrow()
+{
+#if defined(REFLEX_JIT_X64)
+  if (jit_exception)
+  {
+    std::exception_ptr exception = jit_exception;
+    jit_exception = NULL;
+    std::rethrow_exception(exception);
+  }
+#endif
+}
+
+} // namespace reflex
@@ -89,7 +89,96 @@ size_t Matcher::match(Method method)
     return simd_match_avx2(method);
 #endif
 #endif
+  bool rsm = false; // true to resume the match suspended to wait for more input
+  if (sus_)
+  {
+    if (method == rsm_.method && pat_ == rsm_.pat)
+      rsm = true;
+    else
+      roll_back();
+    sus_ = false;
+  }
+  if (method == Const::SPLIT && pat_->spn_ > 0)
+  {
+    // split on one of one to three delimiter bytes: search ahead for the next delimiter instead of running the DFA at each position
+    reset_text();
+    if (!rsm)
+    {
+      txt_ = buf_ + cur_;
+      pos_ = cur_;
+    }
+    uint8_t c0 = pat_->spc_[0];
+    uint8_t c1 = pat_->spc_[1];
+    uint8_t c2 = pat_->spc_[2];
+    while (true)
+    {
+      pos_ =
+#if defined(COMPILE_AVX512BW)
+        simd_skip_loop_avx512bw(c0, c1, c2);
+#elif defined(COMPILE_AVX2)
+        simd_skip_loop_avx2(c0, c1, c2);
+#else
+        skip_loop(c0, c1, c2);
+#endif
+      if (pos_ < end_)
+      {
+        uint8_t c = static_cast<uint8_t>(buf_[pos_]);
+        cap_ = pat_->spa_[c == c0 ? 0 : c == c1 ? 1 : 2];
+        len_ = pos_ - (txt_ - buf_);
+        set_current(pos_ + 1);
+        DBGLOG("Split delimiter: txt = '%s' len = %zu", std::string(txt_, len_).c_str(), len_);
+        DBGLOG("END Matcher::match()");
+        return cap_;
+      }
+      if (peek_more() == EOF)
+      {
+        if (wat_)
+        {
+          // suspend to wait for more input, the next match() continues the search for a delimiter at pos_
+          DBGLOG("Suspend split at pos %zu", pos_);
+          rsm_.method = method;
+          rsm_.pat = pat_;
+          sus_ = true;
+          len_ = 0;
+          return 0;
+        }
+        break;
+      }
+    }
+    len_ = end_ - (txt_ - buf_);
+    if (got_ != Const::EOB)
+      cap_ = Const::EMPTY;
+    else
+      cap_ = 0;
+    set_current(end_);
+    got_ = Const::EOB;
+    DBGLOG("Split at eof: cap = %zu txt = '%s' len = %zu", cap_, std::string(txt_, len_).c_str(), len_);
+    DBGLOG("END Matcher::match()");
+    return cap_;
+  }
   reset_text();
+#if WITH_STATS
+  bool hit = false; // true if advance() found a match candidate
+  size_t beg = 0;   // position of the DFA at the start of the match attempt
+#endif
+  int c1;
+  bool bol;
+  bool nul;
+  if (rsm)
+  {
+    // resume the suspended match with the saved DFA state, c1 is not EOF to read the next byte
+    DBGLOG("Resume at pos %zu", pos_);
+    c1 = 0;
+    bol = rsm_.bol;
+    nul = rsm_.nul;
+    cap_ = rsm_.cap;
+    len_ = rsm_.len;
+#if WITH_STATS
+    beg = rsm_.beg;
+    hit = rsm_.hit;
+#endif
+    goto resume;
+  }
   len_ = 0;     // split text length starts with 0
   anc_ = false; // no word boundary anchor found and applied
 scan:
@@ -100,8 +189,8 @@ scan:
   col_ = 0; // count columns for indent matching
 #endif
 find:
-  int c1 = got_;
-  bool bol = at_bol(); // at begin of line?
+  c1 = got_;
+  bol = at_bol(); // at begin of line?
 #if !defined(WITH_NO_CODEGEN)
   if (pat_->fsm_ != NULL)
     fsm_.c1 = c1;
@@ -111,7 +200,11 @@ redo:
 #endif
   lap_.resize(0);
   cap_ = 0;
-  bool nul = method == Const::MATCH;
+  nul = method == Const::MATCH;
+#if WITH_STATS
+  beg = num_ + pos_;
+#endif
+resume:
 #if !defined(WITH_NO_CODEGEN)
   if (pat_->fsm_ != NULL)
   {
@@ -119,16 +212,209 @@ redo:
     fsm_.bol = bol;
     fsm_.nul = nul;
     pat_->fsm_(*this);
+    if (pat_->jit_ != NULL)
+      Pattern::jit_rethrow();
     nul = fsm_.nul;
     c1 = fsm_.c1;
   }
   else
 #endif
-  if (pat_->opc_ != NULL)
+  if (pat_->shn_ > 0)
+  {
+    // small DFA: transition with one shuffle table lookup per byte instead of checking the GOTO ranges of a state
+    uint32_t state = 0x21;
+    if (rsm)
+    {
+      state = rsm_.state;
+      rsm = false;
+    }
+    else if (pat_->sha_[1] > 0)
+    {
+      state |= 0x10;
+      cap_ = pat_->sha_[1];
+      cur_ = pos_;
+      DBGLOG("Take: cap = %zu", cap_);
+    }
+#if defined(COMPILE_AVX512BW) || defined(COMPILE_AVX2)
+    __m128i vstate = _mm_set1_epi8(static_cast<char>(state));
+#endif
+    while (c1 != EOF)
+    {
+      const char *s = buf_ + pos_;
+      const char *e = buf_ + end_;
+      while (s < e)
+      {
+#if defined(COMPILE_AVX512BW) || defined(COMPILE_AVX2)
+        // pshufb selects the next state of the current state in all 16 lanes of vstate
+        vstate = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pat_->shf_[static_cast<uint8_t>(*s++)])), vstate);
+        state = _mm_cvtsi128_si32(vstate) & 0xFF;
+#else
+        state = pat_->shf_[static_cast<uint8_t>(*s++)][state & 0x0F];
+#endif
+        if ((state & 0x70) != 0)
+        {
+          if ((state & 0x40) != 0)
+          {
+            Pattern::Opcode opcode = pat_->tsk_[state & 0x0F];
+            if (opcode != 0)
+            {
+              // skip ahead to the next byte that exits this self-looping state
+              pos_ = s - buf_;
+              pos_ =
+#if defined(COMPILE_AVX512BW)
+                simd_skip_loop_avx512bw(
+#elif defined(COMPILE_AVX2)
+                simd_skip_loop_avx2(
+#else
+                skip_loop(
+#endif
+                    static_cast<uint8_t>(opcode >> 16),
+                    static_cast<uint8_t>(opcode >> 8),
+                    static_cast<uint8_t>(opcode));
+              DBGLOG("Skip: pos = %zu", pos_);
+              s = buf_ + pos_;
+            }
+          }
+          if ((state & 0x10) != 0)
+          {
+            cap_ = pat_->sha_[state & 0x0F];
+            cur_ = s - buf_;
+            DBGLOG("Take: cap = %zu", cap_);
+          }
+          if ((state & 0x40) != 0 && pat_->tsk_[state & 0x0F] == 0)
+            break;
+          if ((state & 0x20) != 0)
+          {
+            if ((state & 0x0F) == 0)
+              break;
+            // loop back to start state w/o full match: advance to avoid backtracking
+            size_t pos = s - buf_;
+            if (cap_ == 0 && pos > cur_ && method == Const::FIND)
+            {
+              // use bit_[] to check each char in buf_[cur_+1..pos-1] if it is a starting char, if not then increase cur_
+              while (++cur_ < pos && (pat_->bit_[static_cast<uint8_t>(buf_[cur_])] & 1))
+                continue;
+            }
+          }
+        }
+      }
+      pos_ = s - buf_;
+      if (state == 0x20 || ((state & 0x40) != 0 && pat_->tsk_[state & 0x0F] == 0))
+        break;
+      // buffer more input and continue with the next byte, or suspend when interrupted here to wait for more input
+      bool more = !eof_;
+      c1 = get();
+      DBGLOG("Get: c1 = %d (0x%x) at pos %zu", c1, c1, pos_ - 1);
+      if (c1 != EOF)
+        --pos_;
+      else if (more && wat_)
+      {
+        rsm_.state = state;
+        goto suspend;
+      }
+    }
+  }
+  else if (!pat_->tbl_.empty())
+  {
+    // compact DFA: transition with one 16 bit table lookup per byte class instead of checking the GOTO ranges of a state
+    const uint16_t *tbl = &pat_->tbl_[0];
+    const uint8_t *bcl = pat_->bcl_;
+    size_t ncl = pat_->ncl_;
+    uint32_t state = 0x2001;
+    if (rsm)
+    {
+      state = rsm_.state;
+      rsm = false;
+    }
+    else if (pat_->tac_[1] > 0)
+    {
+      state |= 0x1000;
+      cap_ = pat_->tac_[1];
+      cur_ = pos_;
+      DBGLOG("Take: cap = %zu", cap_);
+    }
+    while (c1 != EOF)
+    {
+      const char *s = buf_ + pos_;
+      const char *e = buf_ + end_;
+      while (s < e)
+      {
+        state = tbl[(state & 0x0FFF) * ncl + bcl[static_cast<uint8_t>(*s++)]];
+        if ((state & 0x7000) != 0)
+        {
+          if ((state & 0x4000) != 0)
+          {
+            Pattern::Opcode opcode = pat_->tsk_[state & 0x0FFF];
+            if (opcode != 0)
+            {
+              // skip ahead to the next byte that exits this self-looping state
+              pos_ = s - buf_;
+              pos_ =
+#if defined(COMPILE_AVX512BW)
+                simd_skip_loop_avx512bw(
+#elif defined(COMPILE_AVX2)
+                simd_skip_loop_avx2(
+#else
+                skip_loop(
+#endif
+                    static_cast<uint8_t>(opcode >> 16),
+                    static_cast<uint8_t>(opcode >> 8),
+                    static_cast<uint8_t>(opcode));
+              DBGLOG("Skip: pos = %zu", pos_);
+              s = buf_ + pos_;
+            }
+          }
+          if ((state & 0x1000) != 0)
+          {
+            cap_ = pat_->tac_[state & 0x0FFF];
+            cur_ = s - buf_;
+            DBGLOG("Take: cap = %zu", cap_);
+          }
+          if ((state & 0x4000) != 0 && pat_->tsk_[state & 0x0FFF] == 0)
+            break;
+          if ((state & 0x2000) != 0)
+          {
+            if ((state & 0x0FFF) == 0)
+              break;
+            // loop back to start state w/o full match: advance to avoid backtracking
+            size_t pos = s - buf_;
+            if (cap_ == 0 && pos > cur_ && method == Const::FIND)
+            {
+              // use bit_[] to check each char in buf_[cur_+1..pos-1] if it is a starting char, if not then increase cur_
+              while (++cur_ < pos && (pat_->bit_[static_cast<uint8_t>(buf_[cur_])] & 1))
+                continue;
+            }
+          }
+        }
+      }
+      pos_ = s - buf_;
+      if (state == 0x2000 || ((state & 0x4000) != 0 && pat_->tsk_[state & 0x0FFF] == 0))
+        break;
+      // buffer more input and continue with the next byte, or suspend when interrupted here to wait for more input
+      bool more = !eof_;
+      c1 = get();
+      DBGLOG("Get: c1 = %d (0x%x) at pos %zu", c1, c1, pos_ - 1);
+      if (c1 != EOF)
+        --pos_;
+      else if (more && wat_)
+      {
+        rsm_.state = state;
+        goto suspend;
+      }
+    }
+  }
+  else if (pat_->opc_ != NULL)
   {
     const Pattern::Opcode *pc = pat_->opc_;
     Pattern::Index back = Pattern::Const::IMAX; // where to jump back to
     size_t bpos = 0; // backtrack position in the input
+    if (rsm)
+    {
+      pc = pat_->opc_ + rsm_.state;
+      back = rsm_.back;
+      bpos = rsm_.bpos;
+      rsm = false;
+    }
     while (true)
     {
       Pattern::Index jump;
@@ -169,6 +455,21 @@ redo:
               ++pc;
               continue;
             }
+          case 0xFA: // SKIP
+            pos_ =
+#if defined(COMPILE_AVX512BW)
+              simd_skip_loop_avx512bw(
+#elif defined(COMPILE_AVX2)
+              simd_skip_loop_avx2(
+#else
+              skip_loop(
+#endif
+                  static_cast<uint8_t>(opcode >> 16),
+                  static_cast<uint8_t>(opcode >> 8),
+                  static_cast<uint8_t>(opcode));
+            DBGLOG("Skip: pos = %zu", pos_);
+            ++pc;
+            continue;
 #if !defined(WITH_NO_INDENT)
           case Pattern::META_DED - Pattern::META_MIN:
             if (ded_ > 0)
@@ -225,6 +526,7 @@ redo:
                     continue;
                   }
                 case 0xFB: // HEAD
+                case 0xFA: // SKIP
                   opcode = *++pc;
                   continue;
 #if !defined(WITH_NO_INDENT)
@@ -431,10 +733,21 @@ redo:
         }
         if (c1 == EOF)
           break;
+        bool more = !eof_;
         c1 = get();
         DBGLOG("Get: c1 = %d (0x%x) at pos %zu", c1, c1, pos_ - 1);
         if (c1 == EOF)
+        {
+          // suspend when interrupted here to wait for more input
+          if (more && wat_)
+          {
+            rsm_.state = static_cast<uint32_t>(pc - pat_->opc_);
+            rsm_.back = back;
+            rsm_.bpos = bpos;
+            goto suspend;
+          }
           break;
+        }
       }
       Pattern::Opcode lo = c1 << 24;
       Pattern::Opcode hi = lo | 0x00FFFFFF;
@@ -502,6 +815,16 @@ unrolled:
       pc = pat_->opc_ + jump;
     }
   }
+#if WITH_STATS
+  ++cnt_.attempts;
+  cnt_.scanned += num_ + pos_ - beg;
+  if (hit)
+  {
+    if (cap_ == 0)
+      ++cnt_.misses;
+    hit = false;
+  }
+#endif
 #if !defined(WITH_NO_INDENT)
   if (mrk_ && cap_ != Const::REDO)
   {
@@ -588,6 +911,10 @@ unrolled:
         }
         if (pos_ > cur_) // if we didn't fail on META alone
         {
+#if WITH_STATS
+          size_t loc = num_ + cur_;
+          ++cnt_.advances;
+#endif
           if (
 #if defined(COMPILE_AVX512BW)
               simd_advance_avx512bw()
@@ -598,6 +925,11 @@ unrolled:
 #endif
               )
           {
+#if WITH_STATS
+            cnt_.skipped += num_ + cur_ - loc;
+            ++cnt_.hits;
+            hit = true;
+#endif
             if (!pat_->one_)
               goto scan;
             txt_ = buf_ + cur_;
@@ -605,6 +937,9 @@ unrolled:
             set_current(cur_ + len_);
             return cap_ = 1;
           }
+#if WITH_STATS
+          cnt_.skipped += num_ + cur_ - loc;
+#endif
         }
         txt_ = buf_ + cur_;
       }
@@ -635,6 +970,10 @@ unrolled:
         // if we found an empty match, we keep looking for non-empty matches when "N" is off
         if (cap_ != 0)
         {
+#if WITH_STATS
+          size_t loc = num_ + cur_;
+          ++cnt_.advances;
+#endif
           if (
 #if defined(COMPILE_AVX512BW)
               simd_advance_avx512bw()
@@ -645,8 +984,16 @@ unrolled:
 #endif
              )
           {
+#if WITH_STATS
+            cnt_.skipped += num_ + cur_ - loc;
+            ++cnt_.hits;
+            hit = true;
+#endif
             goto scan;
           }
+#if WITH_STATS
+          cnt_.skipped += num_ + cur_ - loc;
+#endif
           set_current(++cur_);
           // at end of input, no matches remain
           cap_ = 0;
@@ -693,6 +1040,103 @@ unrolled:
   DBGLOG("Return: cap = %zu txt = '%s' len = %zu pos = %zu got = %d", cap_, std::string(txt_, len_).c_str(), len_, pos_, got_);
   DBGLOG("END match()");
   return cap_;
+suspend:
+  // suspend the match to wait for more input, the next match() resumes the DFA at pos_ with the saved state
+  DBGLOG("Suspend at pos %zu", pos_);
+  rsm_.pat = pat_;
+  rsm_.method = method;
+  rsm_.bol = bol;
+  rsm_.nul = nul;
+  rsm_.cap = cap_;
+  rsm_.len = len_;
+#if WITH_STATS
+  rsm_.beg = beg;
+  rsm_.hit = hit;
+#endif
+  sus_ = true;
+  len_ = 0;
+  return 0;
+}
+
+#if defined(COMPILE_AVX512BW)
+/// Compile an optimized AVX512BW version defined in matcher_avx512bw.cpp
+size_t Matcher::simd_skip_loop_avx512bw(uint8_t c0, uint8_t c1, uint8_t c2)
+{
+#elif defined(COMPILE_AVX2)
+/// Compile an optimized AVX2 version defined in matcher_avx2.cpp
+size_t Matcher::simd_skip_loop_avx2(uint8_t c0, uint8_t c1, uint8_t c2)
+{
+#else
+/// Returns the buffer position of the next byte that is c0, c1 or c2 starting at pos_, or end_ when none are buffered
+size_t Matcher::skip_loop(uint8_t c0, uint8_t c1, uint8_t c2)
+{
+#if defined(HAVE_AVX512BW) && (!defined(_MSC_VER) || defined(_WIN64))
+  if (have_HW_AVX512BW())
+    return simd_skip_loop_avx512bw(c0, c1, c2);
+  if (have_HW_AVX2())
+    return simd_skip_loop_avx2(c0, c1, c2);
+#elif defined(HAVE_AVX2)
+  if (have_HW_AVX2())
+    return simd_skip_loop_avx2(c0, c1, c2);
+#endif
+#endif
+  const char *s = buf_ + pos_;
+  const char *e = buf_ + end_;
+#if defined(COMPILE_AVX512BW)
+  __m512i v0 = _mm512_set1_epi8(c0);
+  __m512i v1 = _mm512_set1_epi8(c1);
+  __m512i v2 = _mm512_set1_epi8(c2);
+  while (s <= e - 64)
+  {
+    __m512i vstr = _mm512_loadu_si512(reinterpret_cast<const __m512i*>(s));
+    uint64_t mask = _mm512_cmpeq_epi8_mask(v0, vstr) | _mm512_cmpeq_epi8_mask(v1, vstr) | _mm512_cmpeq_epi8_mask(v2, vstr);
+    if (mask != 0)
+      return s - buf_ + ctzl(mask);
+    s += 64;
+  }
+#elif defined(COMPILE_AVX2)
+  __m256i v0 = _mm256_set1_epi8(c0);
+  __m256i v1 = _mm256_set1_epi8(c1);
+  __m256i v2 = _mm256_set1_epi8(c2);
+  while (s <= e - 32)
+  {
+    __m256i vstr = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s));
+    __m256i veq = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v0, vstr), _mm256_cmpeq_epi8(v1, vstr)), _mm256_cmpeq_epi8(v2, vstr));
+    uint32_t mask = _mm256_movemask_epi8(veq);
+    if (mask != 0)
+      return s - buf_ + ctz(mask);
+    s += 32;
+  }
+#elif defined(HAVE_AVX512BW) || defined(HAVE_AVX2) || defined(HAVE_SSE2)
+  __m128i v0 = _mm_set1_epi8(c0);
+  __m128i v1 = _mm_set1_epi8(c1);
+  __m128i v2 = _mm_set1_epi8(c2);
+  while (s <= e - 16)
+  {
+    __m128i vstr = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+    __m128i veq = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v0, vstr), _mm_cmpeq_epi8(v1, vstr)), _mm_cmpeq_epi8(v2, vstr));
+    uint32_t mask = _mm_movemask_epi8(veq);
+    if (mask != 0)
+      return s - buf_ + ctz(mask);
+    s += 16;
+  }
+#elif defined(HAVE_NEON)
+  uint8x16_t v0 = vdupq_n_u8(c0);
+  uint8x16_t v1 = vdupq_n_u8(c1);
+  uint8x16_t v2 = vdupq_n_u8(c2);
+  while (s <= e - 16)
+  {
+    uint8x16_t vstr = vld1q_u8(reinterpret_cast<const uint8_t*>(s));
+    uint8x16_t veq = vorrq_u8(vorrq_u8(vceqq_u8(v0, vstr), vceqq_u8(v1, vstr)), vceqq_u8(v2, vstr));
+    uint64x2_t vmask64 = vreinterpretq_u64_u8(veq);
+    if ((vgetq_lane_u64(vmask64, 0) | vgetq_lane_u64(vmask64, 1)) != 0)
+      break;
+    s += 16;
+  }
+#endif
+  while (s < e && static_cast<uint8_t>(*s) != c0 && static_cast<uint8_t>(*s) != c1 && static_cast<uint8_t>(*s) != c2)
+    ++s;
+  return s - buf_;
 }
 
 #if defined(COMPILE_AVX512BW)
@@ -707,6 +1151,9 @@ bool Matcher::simd_advance_avx2()
 /// advance input cursor position after mismatch to align input for the next match
 bool Matcher::advance()
 {
+#endif
+#if WITH_TRACE
+  REFLEX_TRACE_SPAN("Matcher::advance");
 #endif
   size_t loc = cur_ + 1;
   size_t min = pat_->min_;
@@ -37,6 +37,9 @@
 #include <reflex/pattern.h>
 #include <reflex/simd.h>
 #include <reflex/timer.h>
+#if WITH_TRACE
+#include <reflex/trace.h>
+#endif
 #include <algorithm>
 #include <cstdlib>
 #include <cerrno>
@@ -107,6 +110,31 @@ static void print_char(FILE *file, int c, bool h = false)
 }
 #endif
 
+// append a printable character or its hex code to a Pattern::explain() report
+static void explain_char(std::string& s, uint8_t c)
+{
+  char buf[16];
+  if (c > 0x20 && c < 0x7f && c != '\'' && c != '\\')
+    snprintf(buf, sizeof(buf), "'%c'", c);
+  else
+    snprintf(buf, sizeof(buf), "0x%02x", c);
+  s.append(buf);
+}
+
+// estimated probability that a byte of the input is in the set of bytes, weighed by Pattern::frequency()
+static double explain_rate(const bool set[256])
+{
+  double sum = 0, total = 0;
+  for (int i = 0; i < 256; ++i)
+  {
+    double f = Pattern::frequency(static_cast<uint8_t>(i)) + 1.0;
+    total += f;
+    if (set[i])
+      sum += f;
+  }
+  return sum / total;
+}
+
 #ifndef WITH_NO_CODEGEN
 static const char *meta_label[] = {
   NULL,
@@ -169,6 +197,9 @@ void Pattern::error(regex_error_type code, size_t pos) const
 
 void Pattern::init(const char *options, const uint8_t *pred)
 {
+#if WITH_TRACE
+  REFLEX_TRACE_SPAN("Pattern::init");
+#endif
   init_options(options);
   nop_ = 0;
   len_ = 0;
@@ -222,6 +253,7 @@ void Pattern::init(const char *options, const uint8_t *pred)
     Map       lookahead;
     // parse the regex pattern to construct the followpos NFA without epsilon transitions
     parse(startpos, followpos, modifiers, lookahead);
+    phase("parse");
     // start state = startpos = firstpost of the followpos NFA, also merge the tree DFA root when non-NULL
 #ifdef WITH_TREE_DFA
     DFA::State *start;
@@ -261,6 +293,7 @@ void Pattern::init(const char *options, const uint8_t *pred)
     // compile the NFA into a DFA
     compile(start, followpos, modifiers, lookahead);
 #endif
+    phase("nodes");
     // assemble DFA opcode tables or direct code
     assemble(start);
     // delete the DFA
@@ -268,6 +301,11 @@ void Pattern::init(const char *options, const uint8_t *pred)
     // delete the tree DFA
     tfa_.clear();
   }
+  // construct the shuffle DFA tables or the compact DFA table when the opcode table has no more than 15 or 4095 states
+  table_code();
+  // JIT compile the opcode table to native code with option j
+  if (opt_.j)
+    jit_code();
   // clean up bitap and compute bitap entropy
   if (len_ == 0)
   {
@@ -462,6 +500,7 @@ void Pattern::init_options(const char *options)
   opt_.b = false;
   opt_.h = false;
   opt_.i = false;
+  opt_.j = false;
   opt_.m = false;
   opt_.o = false;
   opt_.p = false;
@@ -490,6 +529,9 @@ void Pattern::init_options(const char *options)
         case 'i':
           opt_.i = true;
           break;
+        case 'j':
+          opt_.j = true;
+          break;
         case 'm':
           opt_.m = true;
           break;
@@ -550,6 +592,181 @@ void Pattern::init_options(const char *options)
   }
 }
 
+std::string Pattern::explain() const
+{
+  std::string s;
+  char buf[128];
+  bool set[256];
+  double rate = 1.0;
+  int speed = 3; // 0 = very fast, 1 = fast, 2 = moderate, 3 = slow
+  if (len_ == 0)
+  {
+    if (min_ == 0)
+    {
+      s.append("strategy:    none, the pattern matches the empty string\n");
+    }
+    else
+    {
+      // Matcher::advance() searches one needle in any build, up to 8 needles with SSE2 or NEON and 16 needles with AVX2, otherwise it falls back to bitap or predict-match
+      bool needle = pin_ == 1;
+#if defined(HAVE_AVX512BW) || defined(HAVE_AVX2) || defined(HAVE_SSE2)
+#if defined(HAVE_AVX512BW) && (!defined(_MSC_VER) || defined(_WIN64))
+      bool avx2 = have_HW_AVX512BW() || have_HW_AVX2();
+#elif defined(HAVE_AVX2)
+      bool avx2 = have_HW_AVX2();
+#else
+      bool avx2 = false;
+#endif
+      needle = pin_ > 0 && (pin_ <= 8 || (pin_ == 16 && avx2));
+#elif defined(HAVE_NEON)
+      needle = pin_ > 0 && pin_ <= 8;
+#endif
+      if (needle)
+      {
+        snprintf(buf, sizeof(buf), "strategy:    needle search for %zu needle%s\n", pin_, pin_ > 1 ? "s" : "");
+        s.append(buf);
+        speed = 0;
+      }
+      else if (min_ >= 4 || npy_ < 16 || (min_ >= 2 && npy_ >= 56))
+      {
+        snprintf(buf, sizeof(buf), "strategy:    bitap over %zu positions with %zu bytes per position\n", min_, npy_);
+        s.append(buf);
+        speed = 1;
+      }
+      else
+      {
+        s.append("strategy:    predict-match\n");
+      }
+      // needles at positions lcp_ and lcs_ for needle search, or the bytes at each bitap position
+      size_t n = needle ? (lcp_ == lcs_ ? 1 : 2) : min_;
+      for (size_t k = 0; k < n; ++k)
+      {
+        size_t pos = needle ? (k == 0 ? lcp_ : lcs_) : k;
+        Pred mask = 1 << pos;
+        size_t count = 0;
+        for (int i = 0; i < 256; ++i)
+          count += (set[i] = (bit_[i] & mask) == 0);
+        rate *= explain_rate(set);
+        snprintf(buf, sizeof(buf), "needles:     at %zu:", pos);
+        s.append(buf);
+        if (count == 0)
+        {
+          s.append(" none");
+        }
+        else if (count > 16)
+        {
+          snprintf(buf, sizeof(buf), " %zu bytes", count);
+          s.append(buf);
+        }
+        else
+        {
+          for (int i = 0; i < 256; ++i)
+          {
+            if (set[i])
+            {
+              s.push_back(' ');
+              explain_char(s, static_cast<uint8_t>(i));
+              snprintf(buf, sizeof(buf), "(%u)", frequency(static_cast<uint8_t>(i)));
+              s.append(buf);
+            }
+          }
+        }
+        s.push_back('\n');
+      }
+      snprintf(buf, sizeof(buf), "verify:      %s over %zu byte%s, then the DFA\n", min_ >= 4 ? "predict-match hashing" : "predict-match", min_, min_ > 1 ? "s" : "");
+      s.append(buf);
+    }
+  }
+  else
+  {
+    if (len_ == 1)
+      s.append("strategy:    memchr\n");
+    else if (bmd_ > 0)
+      s.append("strategy:    Boyer-Moore\n");
+    else
+      s.append("strategy:    string search on two characters\n");
+    s.append("prefix:      \"");
+    for (size_t i = 0; i < len_; ++i)
+    {
+      uint8_t c = static_cast<uint8_t>(chr_[i]);
+      if (c >= 0x20 && c < 0x7f && c != '"' && c != '\\')
+      {
+        s.push_back(static_cast<char>(c));
+      }
+      else
+      {
+        snprintf(buf, sizeof(buf), "\\x%02x", c);
+        s.append(buf);
+      }
+    }
+    snprintf(buf, sizeof(buf), "\" (%zu byte%s)\n", len_, len_ > 1 ? "s" : "");
+    s.append(buf);
+    // Boyer-Moore checks the last character, the other strategies check the characters at lcp_ and lcs_
+    size_t n = len_ == 1 || bmd_ > 0 ? 1 : 2;
+    for (size_t k = 0; k < n; ++k)
+    {
+      size_t pos = bmd_ > 0 ? len_ - 1 : k == 0 ? lcp_ : lcs_;
+      uint8_t c = static_cast<uint8_t>(chr_[pos]);
+      std::memset(set, 0, sizeof(set));
+      set[c] = true;
+      rate *= explain_rate(set);
+      snprintf(buf, sizeof(buf), "needles:     at %zu: ", pos);
+      s.append(buf);
+      explain_char(s, c);
+      snprintf(buf, sizeof(buf), "(%u)\n", frequency(c));
+      s.append(buf);
+    }
+    if (one_)
+      s.append("verify:      none, the pattern is this string\n");
+    else if (min_ > 0)
+      s.append("verify:      predict-match after the prefix, then the DFA\n");
+    else
+      s.append("verify:      the DFA\n");
+    speed = bmd_ > 0 ? 1 : 0;
+  }
+  // downgrade the speed class when the prefilter passes too many positions to the verifier
+  if (speed < 3)
+  {
+    if (rate > 0.1)
+      speed = 3;
+    else if (rate > 0.01 && speed < 2)
+      speed = 2;
+    else if (rate > 0.001 && speed < 1)
+      speed = 1;
+  }
+  snprintf(buf, sizeof(buf), "prefilter:   %.3g%% estimated false positive rate\n", 100.0 * rate);
+  s.append(buf);
+  if (nop_ > 0)
+  {
+    snprintf(buf, sizeof(buf), "dfa:         %zu nodes, %zu edges, %zu words, %zu hashes\n", vno_, eno_, static_cast<size_t>(nop_), hno_);
+    s.append(buf);
+  }
+  if (fsm_ != NULL)
+  {
+    if (jit_ != NULL)
+      snprintf(buf, sizeof(buf), "execution:   JIT compiled native code (%zu bytes)\n", jsz_);
+    else
+      snprintf(buf, sizeof(buf), "execution:   direct code\n");
+  }
+  else if (shn_ > 0)
+  {
+    snprintf(buf, sizeof(buf), "execution:   shuffle DFA (%zu states)\n", shn_);
+  }
+  else if (!tbl_.empty())
+  {
+    snprintf(buf, sizeof(buf), "execution:   compact DFA table (%zu states, %zu byte classes)\n", tbl_.size() / ncl_, ncl_);
+  }
+  else
+  {
+    snprintf(buf, sizeof(buf), "execution:   opcode table (%zu words)\n", static_cast<size_t>(nop_));
+  }
+  s.append(buf);
+  static const char *speeds[] = { "very fast", "fast", "moderate", "slow" };
+  snprintf(buf, sizeof(buf), "speed:       %s\n", speeds[speed]);
+  s.append(buf);
+  return s;
+}
+
 void Pattern::parse(
     Positions& startpos,
     Follow&    followpos,
@@ -557,6 +774,9 @@ void Pattern::parse(
     Map&       lookahead)
 {
   DBGLOG("BEGIN parse()");
+#if WITH_TRACE
+  REFLEX_TRACE_SPAN("Pattern::parse");
+#endif
   if (rex_.size() > Position::MAXLOC)
     throw regex_error(regex_error::exceeds_length, rex_, Position::MAXLOC);
   Location   len = static_cast<Location>(rex_.size());
@@ -1570,6 +1790,9 @@ void Pattern::compile(
     const Map&  lookahead)
 {
   DBGLOG("BEGIN compile()");
+#if WITH_TRACE
+  REFLEX_TRACE_SPAN("Pattern::compile");
+#endif
   // init timers
   timer_type vt, et;
   timer_start(vt);
@@ -2730,16 +2953,23 @@ void Pattern::flip(Chars& chars) const
 void Pattern::assemble(DFA::State *start)
 {
   DBGLOG("BEGIN assemble()");
+#if WITH_TRACE
+  REFLEX_TRACE_SPAN("Pattern::assemble");
+#endif
   timer_type t;
   timer_start(t);
   if (opt_.h)
     gen_match_hfa(start);
   hms_ = timer_elapsed(t);
+  phase("hashing");
   graph_dfa(start);
   predict_match_dfa(start);
   compact_dfa(start);
+  order_dfa(start);
+  skip_dfa(start);
   encode_dfa(start);
   wms_ = timer_elapsed(t);
+  phase("words");
   if (!opt_.f.empty())
   {
     if (opt_.o)
@@ -2750,6 +2980,32 @@ void Pattern::assemble(DFA::State *start)
   DBGLOG("END assemble()");
 }
 
+void Pattern::order_dfa(DFA::State *start)
+{
+  // relink the states breadth-first from the start state in the order of the GOTO opcodes, placing the states that are
+  // reached with fewer transitions closer to the start state in the opcode table to improve cache locality
+  std::vector<DFA::State*> states;
+  std::set<const DFA::State*> visited;
+  states.push_back(start);
+  visited.insert(start);
+  for (size_t k = 0; k < states.size(); ++k)
+  {
+    for (DFA::State::Edges::const_reverse_iterator i = states[k]->edges.rbegin(); i != states[k]->edges.rend(); ++i)
+    {
+      DFA::State *target = i->second.second;
+      if (target != NULL && visited.insert(target).second)
+        states.push_back(target);
+    }
+  }
+  // states that are not reachable from the start state, if any, remain at the end
+  for (DFA::State *state = start->next; state != NULL; state = state->next)
+    if (visited.find(state) == visited.end())
+      states.push_back(state);
+  for (size_t k = 1; k < states.size(); ++k)
+    states[k - 1]->next = states[k];
+  states.back()->next = NULL;
+}
+
 void Pattern::compact_dfa(DFA::State *start)
 {
 #if WITH_COMPACT_DFA == -1
@@ -2809,6 +3065,63 @@ void Pattern::compact_dfa(DFA::State *start)
 #endif
 }
 
+void Pattern::skip_dfa(DFA::State *start)
+{
+  // mark states that loop back to themselves on all but one to three exit bytes, to skip ahead with a (SIMD) scan
+  for (DFA::State *state = start->next; state; state = state->next)
+  {
+    if (!state->heads.empty() || !state->tails.empty())
+      continue;
+    // compacted edges may overlap, the first edge in opcode order that contains a byte takes it
+    bool take[256] = { false };
+    bool loop[256] = { false };
+    bool meta = false;
+#if WITH_COMPACT_DFA == -1
+    for (DFA::State::Edges::const_reverse_iterator i = state->edges.rbegin(); i != state->edges.rend() && !meta; ++i)
+    {
+      Char lo = i->first;
+      Char hi = i->second.first;
+#else
+    for (DFA::State::Edges::const_iterator i = state->edges.begin(); i != state->edges.end() && !meta; ++i)
+    {
+      Char hi = i->first;
+      Char lo = i->second.first;
+#endif
+      meta = is_meta(lo);
+      for (Char c = lo; c <= hi && !meta; ++c)
+      {
+        if (!take[c])
+        {
+          take[c] = true;
+          loop[c] = i->second.second == state;
+        }
+      }
+    }
+    if (meta)
+      continue;
+    Char exit[3];
+    int n = 0;
+    for (Char c = 0; c < 256 && n <= 3; ++c)
+    {
+      if (!loop[c])
+      {
+        if (n < 3)
+          exit[n] = c;
+        ++n;
+      }
+    }
+    // the first exit byte must be less than 0xFA to keep the SKIP opcode distinct from GOTO opcodes
+    if (n == 0 || n > 3 || exit[0] >= 0xFA)
+      continue;
+    while (n < 3)
+    {
+      exit[n] = exit[n - 1];
+      ++n;
+    }
+    state->skip = opcode_skip(exit[0], exit[1], exit[2]);
+  }
+}
+
 void Pattern::encode_dfa(DFA::State *start)
 {
   nop_ = 0;
@@ -2859,7 +3172,7 @@ void Pattern::encode_dfa(DFA::State *start)
       ++nop_;
     }
 #endif
-    nop_ += static_cast<Index>(state->heads.size() + state->tails.size() + (state->accept > 0 || state->redo));
+    nop_ += static_cast<Index>(state->heads.size() + state->tails.size() + (state->accept > 0 || state->redo) + (state->skip != 0));
     if (!valid_goto_index(nop_))
       throw regex_error(regex_error::exceeds_limits, rex_, rex_.size());
   }
@@ -2921,7 +3234,7 @@ void Pattern::encode_dfa(DFA::State *start)
         }
       }
 #endif
-      nop_ += static_cast<Index>(state->heads.size() + state->tails.size() + (state->accept > 0 || state->redo));
+      nop_ += static_cast<Index>(state->heads.size() + state->tails.size() + (state->accept > 0 || state->redo) + (state->skip != 0));
       if (!valid_goto_index(nop_))
         throw regex_error(regex_error::exceeds_limits, rex_, rex_.size());
     }
@@ -2931,6 +3244,9 @@ void Pattern::encode_dfa(DFA::State *start)
   Index pc = 0;
   for (const DFA::State *state = start; state; state = state->next)
   {
+    // SKIP comes first, so TAKE and REDO that follow take the position after skipping
+    if (state->skip != 0)
+      opcode[pc++] = state->skip;
     if (state->redo)
     {
       opcode[pc++] = opcode_redo();
@@ -3098,6 +3414,16 @@ void Pattern::gencode_dfa(const DFA::State *start) const
         ::fprintf(file, "\nS%u:\n", state->index);
         if (state == start)
           ::fprintf(file, "  m.FSM_FIND();\n");
+        if (state->skip != 0)
+        {
+          ::fprintf(file, "  m.FSM_SKIP(");
+          print_char(file, (state->skip >> 16) & 0xFF);
+          ::fprintf(file, ", ");
+          print_char(file, (state->skip >> 8) & 0xFF);
+          ::fprintf(file, ", ");
+          print_char(file, state->skip & 0xFF);
+          ::fprintf(file, ");\n");
+        }
         if (state->redo)
           ::fprintf(file, "  m.FSM_REDO();\n");
         else if (state->accept > 0)
@@ -3757,6 +4083,16 @@ void Pattern::export_code() const
           {
             ::fprintf(file, "HEAD %u\n", long_index_of(opcode));
           }
+          else if (is_opcode_skip(opcode))
+          {
+            ::fprintf(file, "SKIP TO ");
+            print_char(file, (opcode >> 16) & 0xFF, true);
+            ::fprintf(file, " ");
+            print_char(file, (opcode >> 8) & 0xFF, true);
+            ::fprintf(file, " ");
+            print_char(file, opcode & 0xFF, true);
+            ::fprintf(file, "\n");
+          }
           else if (is_opcode_halt(opcode))
           {
             ::fprintf(file, "HALT\n");
@@ -3809,6 +4145,202 @@ void Pattern::export_code() const
 #endif
 }
 
+bool Pattern::decode_state(const Opcode *pc, Accept& accept, Opcode& skip, Index next[256], Index& words) const
+{
+  const Opcode *first = pc;
+  accept = 0;
+  skip = 0;
+  while (!is_opcode_goto(*pc))
+  {
+    switch (*pc >> 24)
+    {
+      case 0xFE: // TAKE
+        accept = long_index_of(*pc);
+        break;
+      case 0xFA: // SKIP
+        skip = *pc;
+        break;
+      default: // REDO, TAIL, HEAD, and META opcodes require the opcode matcher
+        return false;
+    }
+    ++pc;
+  }
+  // the first GOTO with a range that includes a char is taken, the last GOTO or HALT of a state covers all remaining chars
+  bool covered[256] = { false };
+  int count = 0;
+  while (count < 256)
+  {
+    Opcode opcode = *pc++;
+    if (!is_opcode_goto(opcode))
+      return false;
+    Index jump = index_of(opcode);
+    if (jump == Const::LONG)
+      jump = long_index_of(*pc++);
+    for (Opcode c = opcode >> 24; c <= ((opcode >> 16) & 0xFF); ++c)
+    {
+      if (!covered[c])
+      {
+        covered[c] = true;
+        next[c] = jump;
+        ++count;
+      }
+    }
+  }
+  words += static_cast<Index>(pc - first);
+  return true;
+}
+
+void Pattern::table_code()
+{
+  shn_ = 0;
+  spn_ = 0;
+  tbl_.clear();
+  tac_.clear();
+  tsk_.clear();
+  ncl_ = 0;
+  if (opc_ == NULL)
+    return;
+  // decode the states breadth-first from the start state at opcode index 0, state 0 is the dead state and state 1 is the start state
+  std::vector<Index> index(2, 0);
+  std::map<Index,uint16_t> state_of;
+  std::vector<Accept> accept(2, 0);
+  std::vector<Opcode> skip(2, 0);
+  std::vector<uint16_t> next(512, 0);
+  state_of[0] = 1;
+  Index words = 0;
+  for (size_t state = 1; state < index.size(); ++state)
+  {
+    Index target[256];
+    if (!decode_state(opc_ + index[state], accept[state], skip[state], target, words))
+      return;
+    for (size_t c = 0; c < 256; ++c)
+    {
+      uint16_t id = 0;
+      if (target[c] == Const::LONG)
+        return;
+      if (target[c] != Const::HALT)
+      {
+        std::map<Index,uint16_t>::const_iterator i = state_of.find(target[c]);
+        if (i != state_of.end())
+        {
+          id = i->second;
+        }
+        else
+        {
+          // no more than 4095 states and the dead state fit the 12 bit state ids of the compact table
+          if (index.size() >= 4096)
+            return;
+          id = static_cast<uint16_t>(index.size());
+          state_of[target[c]] = id;
+          index.push_back(target[c]);
+          accept.push_back(0);
+          skip.push_back(0);
+          next.resize(next.size() + 256, 0);
+        }
+      }
+      next[256 * state + c] = id;
+    }
+  }
+  size_t n = index.size();
+  // final states without transitions halt the table matchers without reading the next byte, like HALT in the opcode matcher,
+  // states with a SKIP opcode skip ahead like the opcode matcher, both are flagged to look up their SKIP opcode or 0 in tsk_
+  std::vector<bool> halt(n, false);
+  for (size_t state = 1; state < n; ++state)
+  {
+    size_t c = 0;
+    while (c < 256 && next[256 * state + c] == 0)
+      ++c;
+    halt[state] = c == 256;
+  }
+  // the start state must read a byte to loop back to itself
+  if (halt[1])
+    return;
+  if (n <= 16)
+  {
+    // shuffle DFA, flag next states with 0x10 accept, 0x20 dead or start, and 0x40 halt or skip
+    for (size_t state = 0; state < 16; ++state)
+      sha_[state] = state < n ? accept[state] : 0;
+    for (size_t c = 0; c < 256; ++c)
+    {
+      for (size_t state = 0; state < 16; ++state)
+      {
+        uint8_t id = state < n ? static_cast<uint8_t>(next[256 * state + c]) : 0;
+        shf_[c][state] = id | (sha_[id] > 0 ? 0x10 : 0x00) | (id <= 1 ? 0x20 : 0x00) | (halt[id] || skip[id] != 0 ? 0x40 : 0x00);
+      }
+    }
+    shn_ = n;
+    tsk_.swap(skip);
+    DBGLOG("Shuffle DFA with %zu states", shn_);
+    // a pattern that matches one of one to three single bytes is a delimiter that split() searches for without the DFA
+    if (accept[1] == 0)
+    {
+      size_t k = 0;
+      for (size_t c = 0; c < 256; ++c)
+      {
+        uint16_t id = next[256 + c];
+        if (id == 0)
+          continue;
+        bool leaf = id > 1 && accept[id] > 0;
+        for (size_t d = 0; leaf && d < 256; ++d)
+          leaf = next[256 * id + d] == 0;
+        if (!leaf || k == 3)
+        {
+          k = 4;
+          break;
+        }
+        spc_[k] = static_cast<uint8_t>(c);
+        spa_[k] = accept[id];
+        ++k;
+      }
+      if (k >= 1 && k <= 3)
+      {
+        for (spn_ = k; k < 3; ++k)
+        {
+          spc_[k] = spc_[0];
+          spa_[k] = spa_[0];
+        }
+        DBGLOG("Split delimiter with %zu bytes", spn_);
+      }
+    }
+    return;
+  }
+  // compact DFA: byte classes of bytes with the same transitions in all states
+  std::map<std::vector<uint16_t>,uint8_t> classes;
+  std::vector<uint16_t> column(n);
+  size_t ncl = 0;
+  for (size_t c = 0; c < 256; ++c)
+  {
+    for (size_t state = 0; state < n; ++state)
+      column[state] = next[256 * state + c];
+    std::map<std::vector<uint16_t>,uint8_t>::const_iterator i = classes.find(column);
+    if (i != classes.end())
+    {
+      bcl_[c] = i->second;
+    }
+    else
+    {
+      bcl_[c] = static_cast<uint8_t>(ncl);
+      classes[column] = static_cast<uint8_t>(ncl++);
+    }
+  }
+  // use the compact DFA only when its 16 bit table fits in 16KB of L1 cache or is not larger than the 32 bit opcode table
+  if (n * ncl > 8192 && n * ncl > 2 * static_cast<size_t>(words))
+    return;
+  tbl_.resize(n * ncl);
+  for (size_t state = 0; state < n; ++state)
+  {
+    for (size_t c = 0; c < 256; ++c)
+    {
+      uint16_t id = next[256 * state + c];
+      tbl_[state * ncl + bcl_[c]] = id | (accept[id] > 0 ? 0x1000 : 0x0000) | (id <= 1 ? 0x2000 : 0x0000) | (halt[id] || skip[id] != 0 ? 0x4000 : 0x0000);
+    }
+  }
+  tac_.swap(accept);
+  tsk_.swap(skip);
+  ncl_ = ncl;
+  DBGLOG("Compact DFA with %zu states and %zu byte classes", n, ncl_);
+}
+
 void Pattern::predict_match_dfa(const DFA::State *start)
 {
   DBGLOG("BEGIN Pattern::predict_match_dfa()");
@@ -0,0 +1,931 @@
+/******************************************************************************\
+* Copyright (c) 2016, Robert van Engelen, Genivia Inc. All rights reserved.    *
+*                                                                              *
+* Redistribution and use in source and binary forms, with or without           *
+* modification, are permitted provided that the following conditions are met:  *
+*                                                                              *
+*   (1) Redistributions of source code must retain the above copyright notice, *
+*       this list of conditions and the following disclaimer.                  *
+*                                                                              *
+*   (2) Redistributions in binary form must reproduce the above copyright      *
+*       notice, this list of conditions and the following disclaimer in the    *
+*       documentation and/or other materials provided with the distribution.   *
+*                                                                              *
+*   (3) The name of the author may not be used to endorse or promote products  *
+*       derived from this software without specific prior written permission.  *
+*                                                                              *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF         *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO   *
+* EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,       *
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, *
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;  *
+* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,     *
+* WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR      *
+* OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF       *
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                                   *
+\******************************************************************************/
+
+/**
+@file      pcre2prefilter.cpp
+@brief     DFA prefilter regex for PCRE2 regex
+@author    Robert van Engelen - engelen@genivia.com
+@copyright (c) 2016-2020, Robert van Engelen, Genivia Inc. All rights reserved.
+@copyright (c) BSD-3 License - see LICENSE.txt
+*/
+
+#include <reflex/pcre2prefilter.h>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+namespace reflex {
+
+PCRE2Prefilter::PCRE2Prefilter(
+    const std::string& regex,
+    bool               utf,
+    bool               ucp,
+    bool               icase,
+    bool               ext)
+  :
+    rex_(regex),
+    loc_(0),
+    utf_(utf),
+    ucp_(ucp),
+    bad_(false),
+    hyb_(false),
+    quo_(false)
+{
+  alternation(top_, icase, ext);
+  if (loc_ < rex_.size())
+    bad_ = true;
+}
+
+void PCRE2Prefilter::alternation(Item& item, bool icase, bool ext)
+{
+  bool empty = false;
+  item = Item();
+  item.nul = false;
+  while (true)
+  {
+    Item seq;
+    sequence(seq, icase, ext);
+    if (seq.str.empty())
+    {
+      empty = true;
+    }
+    else
+    {
+      if (!item.str.empty())
+        item.str.push_back('|');
+      item.str.append(seq.str);
+    }
+    item.nul = item.nul || seq.nul;
+    item.cut = item.cut || seq.cut;
+    item.max = std::max(item.max, seq.max);
+    if (bad_ || loc_ >= rex_.size() || rex_[loc_] != '|')
+      break;
+    ++loc_;
+  }
+  if (empty && !item.str.empty())
+    item.str.insert(0, "(?:").append(")?");
+  if (empty)
+    item.nul = true;
+}
+
+void PCRE2Prefilter::sequence(Item& seq, bool& icase, bool& ext)
+{
+  while (!bad_)
+  {
+    if (!quo_)
+      space(ext);
+    if (loc_ >= rex_.size() || (!quo_ && (rex_[loc_] == '|' || rex_[loc_] == ')')))
+      break;
+    Item item;
+    atom(item, icase, ext);
+    if (!quo_)
+    {
+      space(ext);
+      quantifier(item);
+    }
+    if (seq.cut)
+      continue;
+    seq.str.append(item.str);
+    seq.nul = seq.nul && item.nul;
+    seq.cut = item.cut;
+    seq.max = add(seq.max, item.max);
+  }
+}
+
+void PCRE2Prefilter::space(bool ext)
+{
+  while (ext && loc_ < rex_.size())
+  {
+    if (std::isspace(static_cast<unsigned char>(rex_[loc_])))
+    {
+      ++loc_;
+    }
+    else if (rex_[loc_] == '#')
+    {
+      while (loc_ < rex_.size() && rex_[loc_] != '\n')
+        ++loc_;
+    }
+    else
+    {
+      break;
+    }
+  }
+}
+
+void PCRE2Prefilter::quantifier(Item& item)
+{
+  if (loc_ >= rex_.size())
+    return;
+  size_t min = 0;
+  size_t max = 0;
+  bool inf = false;
+  char c = rex_[loc_];
+  if (c == '*')
+  {
+    inf = true;
+  }
+  else if (c == '+')
+  {
+    min = 1;
+    inf = true;
+  }
+  else if (c == '?')
+  {
+    max = 1;
+  }
+  else if (c != '{' || !repeat(min, max, inf))
+  {
+    // PCRE2 10.43 and later also accept {,m} and spacing in repeats
+    size_t k = loc_ + 1;
+    while (c == '{' && k < rex_.size() && rex_[k] == ' ')
+      ++k;
+    if (c == '{' && k < rex_.size() && (rex_[k] == ',' || (k > loc_ + 1 && std::isdigit(static_cast<unsigned char>(rex_[k])))))
+      bad_ = true;
+    return;
+  }
+  ++loc_;
+  if (loc_ < rex_.size() && (rex_[loc_] == '?' || rex_[loc_] == '+'))
+    ++loc_; // lazy and possessive repeats are approximated by greedy repeats
+  if (item.str.empty())
+  {
+    item.nul = item.nul || min == 0;
+    return;
+  }
+  if (item.cut)
+  {
+    if (min == 0)
+    {
+      item.str.insert(0, "(?:").append(")?");
+      item.nul = true;
+    }
+    return;
+  }
+  if (inf || max > MAXREP)
+  {
+    // keep at most MAXREP repeats as a prefix and cut the sequence short, bounding the DFA match length
+    if (min > MAXREP)
+      min = MAXREP;
+    if (min == 0)
+    {
+      item.str.clear();
+      item.nul = true;
+      item.max = 0;
+    }
+    else if (min > 1)
+    {
+      item.str.insert(0, "(?:").append("){");
+      dec(item.str, min);
+      item.str.push_back('}');
+      item.max = mul(item.max, min);
+    }
+    item.cut = true;
+    return;
+  }
+  if (min != 1 || max != 1)
+  {
+    item.str.insert(0, "(?:").append("){");
+    dec(item.str, min);
+    item.str.push_back(',');
+    dec(item.str, max);
+    item.str.push_back('}');
+    item.nul = item.nul || min == 0;
+    item.max = mul(item.max, max);
+  }
+}
+
+bool PCRE2Prefilter::repeat(size_t& min, size_t& max, bool& inf)
+{
+  size_t k = loc_ + 1;
+  if (k >= rex_.size() || !std::isdigit(static_cast<unsigned char>(rex_[k])))
+    return false;
+  min = number(k);
+  max = min;
+  if (k < rex_.size() && rex_[k] == ',')
+  {
+    ++k;
+    if (k < rex_.size() && std::isdigit(static_cast<unsigned char>(rex_[k])))
+      max = number(k);
+    else
+      inf = true;
+  }
+  if (k >= rex_.size() || rex_[k] != '}')
+    return false;
+  loc_ = k;
+  return true;
+}
+
+size_t PCRE2Prefilter::number(size_t& k)
+{
+  size_t n = 0;
+  while (k < rex_.size() && std::isdigit(static_cast<unsigned char>(rex_[k])))
+    n = std::min<size_t>(10 * n + (rex_[k++] - '0'), 0xFFFFFF);
+  return n;
+}
+
+void PCRE2Prefilter::atom(Item& item, bool& icase, bool& ext)
+{
+  if (quo_)
+  {
+    if (rex_[loc_] == '\\' && loc_ + 1 < rex_.size() && rex_[loc_ + 1] == 'E')
+    {
+      quo_ = false;
+      escape(item, icase);
+    }
+    else
+    {
+      literal(item, icase);
+    }
+    return;
+  }
+  unsigned char c = static_cast<unsigned char>(rex_[loc_]);
+  switch (c)
+  {
+    case '(':
+      group(item, icase, ext);
+      break;
+    case '[':
+      bracket(item, icase);
+      break;
+    case '.':
+      ++loc_;
+      any(item);
+      break;
+    case '^':
+    case '$':
+      ++loc_;
+      break;
+    case '\\':
+      escape(item, icase);
+      break;
+    case '*':
+    case '+':
+    case '?':
+      bad_ = true;
+      break;
+    default:
+      literal(item, icase);
+  }
+}
+
+void PCRE2Prefilter::group(Item& item, bool& icase, bool& ext)
+{
+  bool icase_group = icase;
+  bool ext_group = ext;
+  bool drop = false;
+  ++loc_;
+  if (loc_ < rex_.size() && rex_[loc_] == '*')
+  {
+    bad_ = true; // verbs and alpha assertions
+    return;
+  }
+  if (loc_ < rex_.size() && rex_[loc_] == '?')
+  {
+    ++loc_;
+    char c = loc_ < rex_.size() ? rex_[loc_] : '\0';
+    if (c == '#')
+    {
+      loc_ = rex_.find(')', loc_);
+      if (loc_ == std::string::npos)
+        bad_ = true;
+      else
+        ++loc_;
+      return;
+    }
+    if (c == ':' || c == '|' || c == '>')
+    {
+      ++loc_;
+    }
+    else if (c == '=' || c == '!')
+    {
+      ++loc_;
+      drop = true;
+    }
+    else if (c == '<' && loc_ + 1 < rex_.size() && (rex_[loc_ + 1] == '=' || rex_[loc_ + 1] == '!'))
+    {
+      loc_ += 2;
+      drop = true;
+    }
+    else if (c == '<' || c == '\'' || (c == 'P' && loc_ + 1 < rex_.size() && rex_[loc_ + 1] == '<'))
+    {
+      if (c == 'P')
+        ++loc_;
+      loc_ = rex_.find(c == '\'' ? '\'' : '>', loc_ + 1);
+      if (loc_ == std::string::npos)
+      {
+        bad_ = true;
+        return;
+      }
+      ++loc_;
+    }
+    else if (c == 'R' || c == '&' || c == 'P' || c == '+' || (c == '-' && loc_ + 1 < rex_.size() && std::isdigit(static_cast<unsigned char>(rex_[loc_ + 1]))) || std::isdigit(static_cast<unsigned char>(c)))
+    {
+      // recursion, subroutine call, or (?P=name) backreference
+      loc_ = rex_.find(')', loc_);
+      if (loc_ == std::string::npos)
+      {
+        bad_ = true;
+        return;
+      }
+      ++loc_;
+      item.nul = false; // a subroutine call may match empty, but then the PCRE2 match starts here anyway
+      item.cut = true;
+      hyb_ = true;
+      return;
+    }
+    else
+    {
+      // inline options (?imnsxUJ-imnsxUJ) and (?^) or option-setting group (?imnsxUJ-imnsxUJ:...)
+      bool on = true;
+      while (loc_ < rex_.size() && rex_[loc_] != ')' && rex_[loc_] != ':')
+      {
+        switch (rex_[loc_++])
+        {
+          case '-':
+            on = false;
+            break;
+          case '^':
+            icase_group = false;
+            ext_group = false;
+            break;
+          case 'i':
+            icase_group = on;
+            break;
+          case 'x':
+            ext_group = on;
+            break;
+          case 'm':
+          case 'n':
+          case 's':
+          case 'U':
+          case 'J':
+            break;
+          default:
+            bad_ = true;
+            return;
+        }
+      }
+      if (loc_ >= rex_.size())
+      {
+        bad_ = true;
+        return;
+      }
+      if (rex_[loc_++] == ')')
+      {
+        icase = icase_group;
+        ext = ext_group;
+        return;
+      }
+    }
+  }
+  Item inner;
+  alternation(inner, icase_group, ext_group);
+  if (bad_ || loc_ >= rex_.size() || rex_[loc_] != ')')
+  {
+    bad_ = true;
+    return;
+  }
+  ++loc_;
+  if (drop)
+  {
+    hyb_ = true;
+    return;
+  }
+  item = inner;
+  if (!item.str.empty())
+    item.str.insert(0, "(?:").push_back(')');
+}
+
+void PCRE2Prefilter::bracket(Item& item, bool icase)
+{
+  bool set[256] = { };
+  bool neg = false;
+  bool exact = true;
+  ++loc_;
+  if (loc_ < rex_.size() && rex_[loc_] == '^')
+  {
+    neg = true;
+    ++loc_;
+  }
+  bool first = true;
+  while (loc_ < rex_.size() && (first || rex_[loc_] != ']'))
+  {
+    first = false;
+    int c = -1;
+    if (rex_[loc_] == '[' && loc_ + 1 < rex_.size() && (rex_[loc_ + 1] == ':' || rex_[loc_ + 1] == '.' || rex_[loc_ + 1] == '='))
+    {
+      size_t k = rex_.find(rex_[loc_ + 1], loc_ + 2);
+      if (k == std::string::npos || k + 1 >= rex_.size() || rex_[k + 1] != ']')
+      {
+        bad_ = true;
+        return;
+      }
+      loc_ = k + 2;
+      exact = false;
+      continue;
+    }
+    if (rex_[loc_] == '\\')
+    {
+      if (loc_ + 1 >= rex_.size() || rex_[loc_ + 1] == 'Q' || rex_[loc_ + 1] == 'E')
+      {
+        bad_ = true;
+        return;
+      }
+      c = code();
+      if (c == -2)
+      {
+        // \d \w \s are ASCII without PCRE2_UCP
+        char e = rex_[loc_ - 1];
+        if (!ucp_ && (e == 'd' || e == 'w' || e == 's'))
+          for (int i = 0; i < 128; ++i)
+            set[i] = set[i] || shorthand(e, i);
+        else
+          exact = false;
+        continue;
+      }
+      if (c < 0)
+      {
+        bad_ = true;
+        return;
+      }
+    }
+    else
+    {
+      c = static_cast<unsigned char>(rex_[loc_++]);
+    }
+    if (c >= 0x80)
+      exact = false;
+    if (loc_ + 1 < rex_.size() && rex_[loc_] == '-' && rex_[loc_ + 1] != ']')
+    {
+      ++loc_;
+      int d;
+      if (rex_[loc_] == '\\')
+      {
+        d = code();
+        if (d == -2)
+        {
+          bad_ = true; // PCRE2 error: invalid range
+          return;
+        }
+      }
+      else if (rex_[loc_] == '[')
+      {
+        bad_ = true;
+        return;
+      }
+      else
+      {
+        d = static_cast<unsigned char>(rex_[loc_++]);
+      }
+      if (d < c)
+      {
+        bad_ = true;
+        return;
+      }
+      if (d >= 0x80)
+        exact = false;
+      for (int i = c; i <= d && i < 128; ++i)
+        set[i] = true;
+      continue;
+    }
+    if (c < 128)
+      set[c] = true;
+  }
+  if (loc_ >= rex_.size())
+  {
+    bad_ = true;
+    return;
+  }
+  ++loc_;
+  if (neg && utf_)
+    exact = false;
+  if (icase && utf_ && (set['K'] || set['k'] || set['S'] || set['s']))
+    exact = false; // U+212A and U+017F fold to k and s
+  if (!exact)
+  {
+    any(item);
+    return;
+  }
+  if (icase)
+    for (int i = 'a'; i <= 'z'; ++i)
+      set[i] = set[i - 'a' + 'A'] = set[i] || set[i - 'a' + 'A'];
+  item.str.push_back('[');
+  for (int i = 0; i < 256; ++i)
+  {
+    if (set[i] != neg)
+    {
+      int j = i;
+      while (j < 255 && set[j + 1] != neg)
+        ++j;
+      hex(item.str, i);
+      if (j > i)
+      {
+        item.str.push_back('-');
+        hex(item.str, j);
+      }
+      i = j;
+    }
+  }
+  item.str.push_back(']');
+  if (item.str.size() == 2)
+  {
+    bad_ = true; // empty set
+    return;
+  }
+  item.nul = false;
+  item.max = 1;
+}
+
+void PCRE2Prefilter::escape(Item& item, bool icase)
+{
+  if (loc_ + 1 >= rex_.size())
+  {
+    bad_ = true;
+    return;
+  }
+  char c = rex_[loc_ + 1];
+  if (std::isdigit(static_cast<unsigned char>(c)) && c != '0')
+  {
+    // backreference (or an octal character code, which is approximated just as well by a cut)
+    loc_ += 2;
+    while (loc_ < rex_.size() && std::isdigit(static_cast<unsigned char>(rex_[loc_])))
+      ++loc_;
+    backreference(item);
+    return;
+  }
+  switch (c)
+  {
+    case 'g':
+    case 'k':
+      loc_ += 2;
+      if (loc_ < rex_.size() && (rex_[loc_] == '{' || rex_[loc_] == '<' || rex_[loc_] == '\''))
+      {
+        char d = rex_[loc_] == '{' ? '}' : rex_[loc_] == '<' ? '>' : '\'';
+        loc_ = rex_.find(d, loc_ + 1);
+        if (loc_ == std::string::npos)
+        {
+          bad_ = true;
+          return;
+        }
+        ++loc_;
+      }
+      else
+      {
+        if (loc_ < rex_.size() && (rex_[loc_] == '+' || rex_[loc_] == '-'))
+          ++loc_;
+        while (loc_ < rex_.size() && std::isdigit(static_cast<unsigned char>(rex_[loc_])))
+          ++loc_;
+      }
+      backreference(item);
+      return;
+    case 'b':
+    case 'B':
+    case 'A':
+    case 'z':
+    case 'Z':
+      loc_ += 2;
+      return;
+    case 'K':
+      loc_ += 2;
+      hyb_ = true;
+      return;
+    case 'Q':
+      loc_ += 2;
+      quo_ = true;
+      return;
+    case 'E':
+      loc_ += 2;
+      if (loc_ < rex_.size() && std::strchr("*+?{", rex_[loc_]) != NULL)
+        bad_ = true; // a quantifier applies to the last quoted character
+      return;
+    case 'X':
+      loc_ += 2;
+      any(item);
+      item.cut = true;
+      return;
+    case 'R':
+    {
+      loc_ += 2;
+      any(item);
+      std::string one(item.str);
+      item.str.append("(?:").append(one).append(")?");
+      item.max *= 2;
+      return;
+    }
+    case 'N':
+      if (loc_ + 2 < rex_.size() && rex_[loc_ + 2] == '{')
+      {
+        bad_ = true;
+        return;
+      }
+      break;
+    case 'G':
+      bad_ = true;
+      return;
+  }
+  int cp = code();
+  if (cp == -2)
+  {
+    char e = rex_[loc_ - 1];
+    if (!ucp_ && (e == 'd' || e == 'w' || e == 's'))
+    {
+      item.str.push_back('[');
+      for (int i = 0; i < 128; ++i)
+      {
+        if (shorthand(e, i))
+        {
+          int j = i;
+          while (j < 127 && shorthand(e, j + 1))
+            ++j;
+          hex(item.str, i);
+          if (j > i)
+          {
+            item.str.push_back('-');
+            hex(item.str, j);
+          }
+          i = j;
+        }
+      }
+      item.str.push_back(']');
+      item.nul = false;
+      item.max = 1;
+    }
+    else
+    {
+      any(item);
+    }
+  }
+  else if (cp < 0)
+  {
+    bad_ = true;
+  }
+  else
+  {
+    character(item, cp, icase);
+  }
+}
+
+int PCRE2Prefilter::code()
+{
+  ++loc_;
+  if (loc_ >= rex_.size())
+    return -1;
+  unsigned char c = static_cast<unsigned char>(rex_[loc_++]);
+  switch (c)
+  {
+    case 'a':
+      return 0x07;
+    case 'e':
+      return 0x1B;
+    case 'f':
+      return 0x0C;
+    case 'n':
+      return 0x0A;
+    case 'r':
+      return 0x0D;
+    case 't':
+      return 0x09;
+    case 'c':
+      if (loc_ >= rex_.size())
+        return -1;
+      return std::toupper(static_cast<unsigned char>(rex_[loc_++])) ^ 0x40;
+    case '0':
+    {
+      int n = 0;
+      for (int i = 0; i < 2 && loc_ < rex_.size() && rex_[loc_] >= '0' && rex_[loc_] <= '7'; ++i)
+        n = 8 * n + (rex_[loc_++] - '0');
+      return n;
+    }
+    case 'o':
+    case 'x':
+    {
+      int base = c == 'o' ? 8 : 16;
+      bool brace = loc_ < rex_.size() && rex_[loc_] == '{';
+      if (brace)
+        ++loc_;
+      else if (c == 'o')
+        return -1;
+      int n = 0;
+      int k = 0;
+      while (loc_ < rex_.size() && (brace || k < 2))
+      {
+        int d = digit(rex_[loc_]);
+        if (d < 0 || d >= base)
+          break;
+        n = std::min(base * n + d, 0x10FFFF + 1);
+        ++loc_;
+        ++k;
+      }
+      if (brace)
+      {
+        if (loc_ >= rex_.size() || rex_[loc_] != '}' || k == 0)
+          return -1;
+        ++loc_;
+      }
+      if (n > 0x10FFFF || (!utf_ && n > 0xFF))
+        return -1;
+      return n;
+    }
+    case 'd':
+    case 'D':
+    case 'w':
+    case 'W':
+    case 's':
+    case 'S':
+    case 'h':
+    case 'H':
+    case 'v':
+    case 'V':
+    case 'N':
+    case 'C':
+      return -2;
+    case 'p':
+    case 'P':
+      if (loc_ < rex_.size() && rex_[loc_] == '{')
+      {
+        loc_ = rex_.find('}', loc_);
+        if (loc_ == std::string::npos)
+          return -1;
+        ++loc_;
+        return -2;
+      }
+      if (loc_ >= rex_.size())
+        return -1;
+      ++loc_;
+      return -2;
+  }
+  if (c < 0x80 && std::isalnum(c))
+    return -1;
+  if (c >= 0x80 && utf_)
+  {
+    // escaped UTF-8 multibyte character
+    int n = c;
+    int len = c >= 0xF0 ? 3 : c >= 0xE0 ? 2 : c >= 0xC0 ? 1 : 0;
+    n &= 0x3F >> len;
+    for (int i = 0; i < len && loc_ < rex_.size(); ++i)
+      n = (n << 6) | (static_cast<unsigned char>(rex_[loc_++]) & 0x3F);
+    return n;
+  }
+  return c;
+}
+
+void PCRE2Prefilter::literal(Item& item, bool icase)
+{
+  unsigned char c = static_cast<unsigned char>(rex_[loc_++]);
+  if (c >= 0x80 && c < 0xC0 && utf_)
+  {
+    bad_ = true;
+    return;
+  }
+  if (c < 0xC0 || !utf_)
+  {
+    character(item, c, icase);
+    return;
+  }
+  int n = c;
+  int len = c >= 0xF0 ? 3 : c >= 0xE0 ? 2 : 1;
+  n &= 0x3F >> len;
+  for (int i = 0; i < len && loc_ < rex_.size(); ++i)
+    n = (n << 6) | (static_cast<unsigned char>(rex_[loc_++]) & 0x3F);
+  character(item, n, icase);
+}
+
+void PCRE2Prefilter::character(Item& item, int c, bool icase)
+{
+  item.nul = false;
+  if (icase && c < 0x80 && std::isalpha(c))
+  {
+    int l = std::tolower(c);
+    if (utf_ && (l == 'k' || l == 's'))
+    {
+      // U+212A (Kelvin sign) and U+017F (long s) fold to k and s
+      item.str.assign(l == 'k' ? "(?:[Kk]|\\xe2\\x84\\xaa)" : "(?:[Ss]|\\xc5\\xbf)");
+      item.max = 3;
+      return;
+    }
+    item.str.push_back('[');
+    hex(item.str, std::toupper(c));
+    hex(item.str, l);
+    item.str.push_back(']');
+    item.max = 1;
+    return;
+  }
+  if (c < 0x80 || !utf_)
+  {
+    hex(item.str, c);
+    item.max = 1;
+    return;
+  }
+  if (icase)
+  {
+    any(item);
+    return;
+  }
+  item.str.assign("(?:");
+  if (c < 0x800)
+  {
+    hex(item.str, 0xC0 | (c >> 6));
+    item.max = 2;
+  }
+  else
+  {
+    if (c < 0x10000)
+    {
+      hex(item.str, 0xE0 | (c >> 12));
+      item.max = 3;
+    }
+    else
+    {
+      hex(item.str, 0xF0 | (c >> 18));
+      hex(item.str, 0x80 | ((c >> 12) & 0x3F));
+      item.max = 4;
+    }
+    hex(item.str, 0x80 | ((c >> 6) & 0x3F));
+  }
+  hex(item.str, 0x80 | (c & 0x3F));
+  item.str.push_back(')');
+}
+
+void PCRE2Prefilter::any(Item& item)
+{
+  item.str.assign(utf_ ? "(?:[\\x00-\\xff][\\x80-\\xbf]{0,3})" : "[\\x00-\\xff]");
+  item.nul = false;
+  item.max = utf_ ? 4 : 1;
+}
+
+void PCRE2Prefilter::backreference(Item& item)
+{
+  item.cut = true;
+  hyb_ = true;
+}
+
+bool PCRE2Prefilter::shorthand(char e, int c)
+{
+  if (e == 'd')
+    return c >= '0' && c <= '9';
+  if (e == 'w')
+    return std::isalnum(c) || c == '_';
+  return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+int PCRE2Prefilter::digit(char c)
+{
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  return -1;
+}
+
+void PCRE2Prefilter::hex(std::string& str, int c)
+{
+  static const char digits[] = "0123456789abcdef";
+  str.append("\\x");
+  str.push_back(digits[(c >> 4) & 0xF]);
+  str.push_back(digits[c & 0xF]);
+}
+
+void PCRE2Prefilter::dec(std::string& str, size_t n)
+{
+  if (n >= 10)
+    dec(str, n / 10);
+  str.push_back(static_cast<char>('0' + n % 10));
+}
+
+size_t PCRE2Prefilter::add(size_t a, size_t b)
+{
+  return a + b < a ? static_cast<size_t>(-1) : a + b;
+}
+
+size_t PCRE2Prefilter::mul(size_t a, size_t b)
+{
+  return b != 0 && a > static_cast<size_t>(-1) / b ? static_cast<size_t>(-1) : a * b;
+}
+
+} // namespace reflex
@@ -111,4 +111,164 @@ size_t simd_nlcount_sse2(const char*& b, const char *e)
 #endif
 }
 
+#if defined(HAVE_AVX512BW) || defined(HAVE_AVX2)
+
+// Keiser-Lemire UTF-8 validation error flags of the 4-bit nibble lookups
+#define UTF8_TOO_SHORT   (1 << 0)
+#define UTF8_TOO_LONG    (1 << 1)
+#define UTF8_OVERLONG_3  (1 << 2)
+#define UTF8_TOO_LARGE   (1 << 3)
+#define UTF8_SURROGATE   (1 << 4)
+#define UTF8_OVERLONG_2  (1 << 5)
+#define UTF8_TOO_LARGE_1000 (1 << 6)
+#define UTF8_OVERLONG_4  (1 << 6)
+#define UTF8_TWO_CONTS   (1 << 7)
+#define UTF8_CARRY       (UTF8_TOO_SHORT | UTF8_TOO_LONG | UTF8_TWO_CONTS)
+
+// bytes of the 32 byte block v shifted in from the end of the previous block w by n
+#define UTF8_PREV(v, w, n) _mm256_alignr_epi8(v, _mm256_permute2x128_si256(w, v, 0x21), 16 - (n))
+
+#endif
+
+// Returns the end of the valid UTF-8 prefix of string b up to e checked in blocks of 32 bytes, stops at the start of the UTF-8 sequence that is invalid or incomplete in the block
+const char *simd_utf8_avx2(const char *b, const char *e)
+{
+#if defined(HAVE_AVX512BW) || defined(HAVE_AVX2)
+  const __m256i vbyte_1_high = _mm256_setr_epi8(
+      // 0_______ ________ ASCII in byte 1
+      UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+      UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+      // 10______ ________ continuation in byte 1
+      UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS,
+      // 1100____ ________ two byte lead in byte 1
+      UTF8_TOO_SHORT | UTF8_OVERLONG_2,
+      // 1101____ ________ two byte lead in byte 1
+      UTF8_TOO_SHORT,
+      // 1110____ ________ three byte lead in byte 1
+      UTF8_TOO_SHORT | UTF8_OVERLONG_3 | UTF8_SURROGATE,
+      // 1111____ ________ four byte lead in byte 1
+      UTF8_TOO_SHORT | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4,
+      UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+      UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+      UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS,
+      UTF8_TOO_SHORT | UTF8_OVERLONG_2,
+      UTF8_TOO_SHORT,
+      UTF8_TOO_SHORT | UTF8_OVERLONG_3 | UTF8_SURROGATE,
+      UTF8_TOO_SHORT | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4);
+  const __m256i vbyte_1_low = _mm256_setr_epi8(
+      // ____0000 ________
+      UTF8_CARRY | UTF8_OVERLONG_3 | UTF8_OVERLONG_2 | UTF8_OVERLONG_4,
+      // ____0001 ________
+      UTF8_CARRY | UTF8_OVERLONG_2,
+      // ____001_ ________
+      UTF8_CARRY,
+      UTF8_CARRY,
+      // ____0100 ________
+      UTF8_CARRY | UTF8_TOO_LARGE,
+      // ____0101 ________ and up
+      UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+      UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+      UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+      UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+      UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+      UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+      UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+      UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+      // ____1101 ________
+      UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_SURROGATE,
+      UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+      UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+      UTF8_CARRY | UTF8_OVERLONG_3 | UTF8_OVERLONG_2 | UTF8_OVERLONG_4,
+      UTF8_CARRY | UTF8_OVERLONG_2,
+      UTF8_CARRY,
+      UTF8_CARRY,
+      UTF8_CARRY | UTF8_TOO_LARGE,
+      UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+      UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+      UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+      UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+      UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+      UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+      UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+      UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+      UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_SURROGATE,
+      UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+      UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000);
+  const __m256i vbyte_2_high = _mm256_setr_epi8(
+      // ________ 0_______ ASCII in byte 2
+      UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+      UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+      // ________ 1000____
+      UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4,
+      // ________ 1001____
+      UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE,
+      // ________ 101_____
+      UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE,
+      UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE,
+      // ________ 11______
+      UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+      UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+      UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+      UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4,
+      UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE,
+      UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE,
+      UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE,
+      UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT);
+  // a byte at the end of the previous block > max is the lead of an incomplete sequence
+  const __m256i vmax = _mm256_setr_epi8(
+      -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+      -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+      static_cast<char>(0xEF), static_cast<char>(0xDF), static_cast<char>(0xBF));
+  const __m256i v0f = _mm256_set1_epi8(0x0F);
+  const __m256i v80 = _mm256_set1_epi8(static_cast<char>(0x80));
+  const __m256i vthird = _mm256_set1_epi8(static_cast<char>(0xE0 - 0x80));
+  const __m256i vfourth = _mm256_set1_epi8(static_cast<char>(0xF0 - 0x80));
+  const char *s = b;
+  __m256i vprev = _mm256_setzero_si256();
+  __m256i vincomplete = _mm256_setzero_si256();
+  while (s + 32 <= e)
+  {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s));
+    __m256i verror;
+    if (_mm256_movemask_epi8(v) == 0)
+    {
+      // ASCII is valid unless the previous block ends with an incomplete sequence
+      verror = vincomplete;
+    }
+    else
+    {
+      __m256i vprev1 = UTF8_PREV(v, vprev, 1);
+      __m256i vspecial = _mm256_and_si256(_mm256_and_si256(
+            _mm256_shuffle_epi8(vbyte_1_high, _mm256_and_si256(_mm256_srli_epi16(vprev1, 4), v0f)),
+            _mm256_shuffle_epi8(vbyte_1_low, _mm256_and_si256(vprev1, v0f))),
+          _mm256_shuffle_epi8(vbyte_2_high, _mm256_and_si256(_mm256_srli_epi16(v, 4), v0f)));
+      __m256i vprev2 = UTF8_PREV(v, vprev, 2);
+      __m256i vprev3 = UTF8_PREV(v, vprev, 3);
+      __m256i vmust23 = _mm256_or_si256(_mm256_subs_epu8(vprev2, vthird), _mm256_subs_epu8(vprev3, vfourth));
+      verror = _mm256_xor_si256(_mm256_and_si256(vmust23, v80), vspecial);
+      vincomplete = _mm256_subs_epu8(v, vmax);
+    }
+    if (!_mm256_testz_si256(verror, verror))
+      break;
+    vprev = v;
+    s += 32;
+  }
+  // back up to the start of an incomplete sequence at the end of the valid blocks
+  for (int i = 1; i <= 3 && s - i >= b; ++i)
+  {
+    int c = static_cast<unsigned char>(s[-i]);
+    if ((c & 0xC0) != 0x80)
+    {
+      if (c >= 0xC0 && 2 + (c >= 0xE0) + (c >= 0xF0) > i)
+        s -= i;
+      break;
+    }
+  }
+  return s;
+#else
+  (void)e;
+  return b;
+#endif
+}
+
 } // namespace reflex
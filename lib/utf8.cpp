@@ -35,6 +35,7 @@
 */
 
 #include <reflex/utf8.h>
+#include <reflex/simd.h>
 
 namespace reflex {
 
@@ -278,4 +279,71 @@ std::string utf8(int a, int b, int esc, const char *par, bool strict)
   return regex;
 }
 
+std::wstring wcs(const char *s, size_t n)
+{
+  std::wstring ws;
+  if (n == 0)
+    return ws;
+  // each UTF-8 byte produces at most one wide character, including UTF-16 surrogate pairs for 4-byte UTF-8,
+  // plus one for a surrogate pair of a truncated UTF-8 sequence at the end that utf8() reads beyond s + n
+  ws.resize(n + 1);
+  wchar_t *w = &ws[0];
+  const char *e = s + n;
+  while (s < e)
+  {
+#if defined(HAVE_AVX512BW) || defined(HAVE_AVX2) || defined(HAVE_SSE2)
+    // widen 16 ASCII bytes at a time
+    const __m128i vzero = _mm_setzero_si128();
+    while (s + 16 <= e)
+    {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+      if (_mm_movemask_epi8(v) != 0)
+        break;
+      __m128i vlo = _mm_unpacklo_epi8(v, vzero);
+      __m128i vhi = _mm_unpackhi_epi8(v, vzero);
+      if (sizeof(wchar_t) == 2)
+      {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(w), vlo);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(w + 8), vhi);
+      }
+      else
+      {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(w), _mm_unpacklo_epi16(vlo, vzero));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(w + 4), _mm_unpackhi_epi16(vlo, vzero));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(w + 8), _mm_unpacklo_epi16(vhi, vzero));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(w + 12), _mm_unpackhi_epi16(vhi, vzero));
+      }
+      s += 16;
+      w += 16;
+    }
+    // convert the rest of the block with the non-ASCII UTF-8 one character at a time
+    const char *b = s + 16 < e ? s + 16 : e;
+#else
+    const char *b = e;
+#endif
+    while (s < b)
+    {
+      int wc = utf8(s, &s);
+      if (sizeof(wchar_t) == 2 && wc > 0xFFFF)
+      {
+        if (wc <= 0x10FFFF)
+        {
+          *w++ = static_cast<wchar_t>(0xD800 | (wc - 0x010000) >> 10); // first half of UTF-16 surrogate pair
+          *w++ = static_cast<wchar_t>(0xDC00 | (wc & 0x03FF));         // second half of UTF-16 surrogate pair
+        }
+        else
+        {
+          *w++ = 0xFFFD;
+        }
+      }
+      else
+      {
+        *w++ = static_cast<wchar_t>(wc);
+      }
+    }
+  }
+  ws.resize(w - ws.data());
+  return ws;
+}
+
 } // namespace reflex
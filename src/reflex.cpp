@@ -72,6 +72,7 @@ static const char *options_table[] = {
   "default",
   "dotall",
   "exception",
+  "explain",
   "extra_type",
   "fast",
   "find",
@@ -128,6 +129,7 @@ static const char *options_table[] = {
   "tabs",
   "token_eof",
   "token_type",
+  "trace",
   "unicode",
   "unput",
   "verbose",
@@ -643,10 +645,14 @@ void Reflex::help(const char *message, const char *arg)
     Debugging:\n\
         -d, --debug\n\
                 enable debug mode in scanner\n\
+        --explain\n\
+                report the search strategy of the patterns to stdout\n\
         -p, --perf-report\n\
                 scanner reports detailed performance statistics to stderr\n\
         -s, --nodefault\n\
                 disable the default rule in scanner that echoes unmatched text\n\
+        --trace\n\
+                scanner records rule action spans when compiled with WITH_TRACE\n\
         -v, --verbose\n\
                 report summary of scanner statistics to stdout\n\
         -w, --nowarn\n\
@@ -1909,6 +1915,8 @@ void Reflex::write_prelude()
     *out << "\n// --debug option enables ASSERT:\n#define ASSERT(c) assert(c)\n";
   if (!options["perf_report"].empty())
     *out << "\n// --perf-report option requires a timer:\n#include <reflex/timer.h>\n";
+  if (!options["trace"].empty())
+    *out << "\n// --trace option records rule action spans when compiled with -DWITH_TRACE=1:\n#include <reflex/trace.h>\n";
 }
 
 /// Write Flex-compatible #defines to lex.yy.cpp
@@ -2985,6 +2993,11 @@ void Reflex::write_lexer()
         has_code = rule->code.line != "|";
         if (has_code)
         {
+          bool trace = !eof_rule && !options["trace"].empty();
+          if (trace)
+            *out <<
+              "            {\n"
+              "            REFLEX_TRACE_SPAN(\"rule " << escape_bs(rule->code.file) << ":" << rule->code.lineno << "\");\n";
           if (!eof_rule)
           {
             if (!options["perf_report"].empty())
@@ -3006,6 +3019,9 @@ void Reflex::write_lexer()
             *out <<
               "            YY_USER_ACTION\n";
           write_code(rule->code);
+          if (trace)
+            *out <<
+              "            }\n";
           if (!options["flex"].empty())
             *out <<
               "            YY_BREAK\n";
@@ -3240,6 +3256,18 @@ void Reflex::write_final()
             << std::setw(10) << pattern.edges() << " edges (" << pattern.edges_time() << " ms)\n"
             << std::setw(10) << pattern.words() << " words (" << pattern.words_time() << " ms)\n";
         }
+        if (!options["explain"].empty())
+        {
+          std::cout << "    ";
+          if (inclusive.find(start) != inclusive.end())
+            std::cout << "%s ";
+          else
+            std::cout << "%x ";
+          std::cout << conditions[start] << " search strategy:\n";
+          std::string report = pattern.explain();
+          for (size_t from = 0, to; (to = report.find('\n', from)) != std::string::npos; from = to + 1)
+            std::cout << "      " << report.substr(from, to - from + 1);
+        }
       }
       catch (reflex::regex_error& e)
       {
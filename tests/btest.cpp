@@ -1,5 +1,6 @@
 
 #include <reflex/boostmatcher.h>
+#include <sstream>
 
 // #define INTERACTIVE // for interactive mode testing
 
@@ -562,6 +563,47 @@ int main()
   if (test != "ä/a/b/ç/c/d/")
     error("wunput");
   //
+  banner("TEST BUDGET");
+  //
+  std::istringstream budget_stream("an apple a day keeps the doctor away");
+  matcher.pattern(pattern8);
+  matcher.input(budget_stream);
+  matcher.buffer(4);
+  for (int steps = 0; steps < 2; ++steps)
+  {
+    if (steps)
+    {
+      matcher.input("an apple a day keeps the doctor away");
+      matcher.budget(0, 2);
+    }
+    else
+    {
+      matcher.budget(8);
+    }
+    test = "";
+    int interrupts = 0;
+    while (true)
+    {
+      // find() returns zero when interrupted, the search resumes with a new budget
+      if (!matcher.find())
+      {
+        if (!matcher.interrupted())
+          break;
+        ++interrupts;
+        if (steps)
+          matcher.budget(0, 2);
+        else
+          matcher.budget(8);
+        continue;
+      }
+      std::cout << matcher.text() << "/";
+      test.append(matcher.text()).append("/");
+    }
+    std::cout << std::endl << "INTERRUPTS = " << interrupts << std::endl;
+    if (test != "an/apple/a/day/keeps/the/doctor/away/" || interrupts == 0)
+      error("budget resume results");
+  }
+  //
   banner("TEST WRAP");
   //
   WrappedMatcher wrapped_matcher;
@@ -0,0 +1,108 @@
+// Benchmark reflex::EpollScanner aggregate throughput and per-stream latency
+// with many socketpair streams fed by a writer thread
+//
+// > make -f Make ebench
+// > ./ebench [streams] [MB]
+
+#include <reflex/epoll.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <sys/resource.h>
+#include <sys/socket.h>
+
+static double now()
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int main(int argc, char **argv)
+{
+  size_t streams = argc > 1 ? static_cast<size_t>(atoi(argv[1])) : 10000;
+  size_t size = (argc > 2 ? static_cast<size_t>(atoi(argv[2])) : 256) * 1000000;
+  // two descriptors per stream
+  struct rlimit rl;
+  if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < 2 * streams + 64)
+  {
+    rl.rlim_cur = std::min<rlim_t>(rl.rlim_max, 2 * streams + 64);
+    (void)setrlimit(RLIMIT_NOFILE, &rl);
+  }
+  // each record is a line of words ending in a sequence number that is matched to measure latency
+  static const char *words[] = { "lorem ", "ipsum ", "dolor ", "sit ", "amet ", "consectetur ", "adipiscing ", "elit " };
+  std::string filler;
+  srand(1);
+  while (filler.size() < 200)
+    filler.append(words[rand() % 8]);
+  size_t records = size / streams / (filler.size() + 8);
+  if (records == 0)
+    records = 1;
+  std::vector<int> wfds(streams);
+  std::vector< std::atomic<double> > sent(streams * records);
+  std::vector<double> latency;
+  latency.reserve(streams * records);
+  reflex::Pattern pattern("#[0-9]+\\n");
+  reflex::EpollScanner<> scanner(pattern, reflex::AbstractMatcher::Const::FIND);
+  size_t bytes = 0;
+  scanner.on_match([&](int fd, reflex::AbstractMatcher& matcher, size_t) {
+    size_t seq = static_cast<size_t>(strtoul(matcher.begin() + 1, NULL, 10));
+    latency.push_back(now() - sent[seq].load(std::memory_order_acquire));
+    (void)fd;
+  });
+  scanner.on_close([&](int fd, int err) {
+    if (err != 0)
+      fprintf(stderr, "read error on %d: %d\n", fd, err);
+  });
+  for (size_t i = 0; i < streams; ++i)
+  {
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0 || !scanner.add(sv[0]))
+    {
+      perror("ebench");
+      return EXIT_FAILURE;
+    }
+    wfds[i] = sv[1];
+  }
+  double t0 = now();
+  std::thread writer([&]() {
+    char line[512];
+    for (size_t r = 0; r < records; ++r)
+    {
+      for (size_t i = 0; i < streams; ++i)
+      {
+        size_t seq = i * records + r;
+        int len = snprintf(line, sizeof(line), "%s#%zu\n", filler.c_str(), seq);
+        sent[seq].store(now(), std::memory_order_release);
+        const char *p = line;
+        while (len > 0)
+        {
+          ssize_t n = write(wfds[i], p, static_cast<size_t>(len));
+          if (n <= 0)
+            break;
+          p += n;
+          len -= static_cast<int>(n);
+          bytes += static_cast<size_t>(n);
+        }
+      }
+    }
+    for (size_t i = 0; i < streams; ++i)
+      close(wfds[i]);
+  });
+  if (!scanner.run())
+    perror("ebench");
+  writer.join();
+  double t1 = now();
+  std::sort(latency.begin(), latency.end());
+  size_t n = latency.size();
+  printf("%zu streams  %zu matches of %zu  %8.1f MB/s  latency p50 %8.1f us  p99 %8.1f us  max %8.1f us\n",
+      streams,
+      n,
+      streams * records,
+      static_cast<double>(bytes) / 1e6 / (t1 - t0),
+      n > 0 ? 1e6 * latency[n / 2] : 0.0,
+      n > 0 ? 1e6 * latency[n * 99 / 100] : 0.0,
+      n > 0 ? 1e6 * latency[n - 1] : 0.0);
+  return n == streams * records ? EXIT_SUCCESS : EXIT_FAILURE;
+}
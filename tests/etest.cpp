@@ -0,0 +1,161 @@
+// Test reflex::EpollScanner with socketpair streams (Linux)
+//
+// > make -f Make etest
+
+#include <reflex/epoll.h>
+#include <type_traits>
+#include <sys/socket.h>
+
+static void banner(const char *title)
+{
+  int i;
+  printf("\n\n/");
+  for (i = 0; i < 78; i++)
+    putchar('*');
+  printf("\\\n *%76s*\n * %-75s*\n *%76s*\n\\", "", title, "");
+  for (i = 0; i < 78; i++)
+    putchar('*');
+  printf("/\n\n");
+}
+
+static void error(const char *text)
+{
+  std::cout << "FAILED: " << text << std::endl;
+  exit(EXIT_FAILURE);
+}
+
+using namespace reflex;
+
+// create a socketpair, returns the end to scan and sets the end to write
+static int stream(int& writer)
+{
+  int sv[2];
+  if (::socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0)
+    error("socketpair");
+  writer = sv[1];
+  return sv[0];
+}
+
+static void send(int fd, const char *data)
+{
+  size_t n = strlen(data);
+  if (::write(fd, data, n) != static_cast<ssize_t>(n))
+    error("write");
+}
+
+int main()
+{
+  static_assert(!std::is_copy_constructible< EpollScanner<> >::value, "EpollScanner is not copyable");
+  static_assert(!std::is_copy_assignable< EpollScanner<> >::value, "EpollScanner is not assignable");
+  Pattern pattern("\\w+");
+  std::string test;
+  //
+  banner("TEST MATCHES");
+  //
+  {
+    EpollScanner<> scanner(pattern, Matcher::Const::FIND);
+    scanner.on_match([&](int fd, AbstractMatcher& matcher, size_t) {
+      test.append(std::to_string(fd)).append(":").append(matcher.text()).append("/");
+    });
+    scanner.on_close([&](int fd, int err) {
+      test.append(std::to_string(fd)).append(":").append(err == 0 ? "EOF" : "ERR").append("/");
+    });
+    int w1, w2;
+    int r1 = stream(w1);
+    int r2 = stream(w2);
+    if (!scanner.add(r1) || !scanner.add(r2) || scanner.size() != 2)
+      error("add");
+    // words split across writes are matched when complete
+    send(w1, "a");
+    while (scanner.poll(0) > 0)
+      continue;
+    send(w1, "b cd");
+    send(w2, "ef ");
+    while (scanner.poll(0) > 0)
+      continue;
+    std::string r1s = std::to_string(r1) + ":";
+    std::string r2s = std::to_string(r2) + ":";
+    std::cout << test << std::endl;
+    if (test != r1s + "ab/" + r2s + "ef/")
+      error("matches");
+    test.clear();
+    ::close(w1);
+    ::close(w2);
+    if (!scanner.run() || scanner.size() != 0)
+      error("run");
+    std::cout << test << std::endl;
+    if (test != r1s + "cd/" + r1s + "EOF/" + r2s + "EOF/")
+      error("matches at the end of the input");
+  }
+  //
+  banner("TEST WITHOUT MATCH HANDLER");
+  //
+  {
+    EpollScanner<> scanner(pattern, Matcher::Const::FIND, NULL, 256);
+    size_t closed = 0;
+    scanner.on_close([&](int, int err) {
+      if (err == 0)
+        ++closed;
+    });
+    int w;
+    int r = stream(w);
+    if (!scanner.add(r))
+      error("add");
+    // the input is drained, not kept as pending input of the matcher
+    std::string data;
+    for (int i = 0; i < 100; ++i)
+      data.append("lorem ipsum ");
+    send(w, data.c_str());
+    while (scanner.poll(0) > 0)
+      if (scanner.matcher(r)->pending() != 0)
+        error("pending input without match handler");
+    ::close(w);
+    if (!scanner.run() || closed != 1)
+      error("close without match handler");
+  }
+  //
+  banner("TEST REMOVE IN MATCH HANDLER");
+  //
+  {
+    EpollScanner<> scanner(pattern, Matcher::Const::FIND);
+    int w, w2 = -1, r2 = -1;
+    int r = stream(w);
+    // the last match at the end of the input removes fd and adds a new stream that may reuse fd
+    scanner.on_match([&](int fd, AbstractMatcher& matcher, size_t) {
+      test.append(matcher.text()).append("/");
+      if (fd == r && r2 < 0)
+      {
+        scanner.remove(fd);
+        r2 = stream(w2);
+        if (!scanner.add(r2))
+          error("add");
+      }
+    });
+    size_t closed = 0;
+    scanner.on_close([&](int, int) {
+      ++closed;
+    });
+    if (!scanner.add(r))
+      error("add");
+    test.clear();
+    send(w, "ab");
+    ::close(w);
+    while (r2 < 0)
+      if (scanner.poll() < 0)
+        error("poll");
+    std::cout << "reused fd " << (r2 == r ? "yes" : "no") << std::endl;
+    if (scanner.matcher(r2) == NULL || closed != 0)
+      error("remove in match handler");
+    send(w2, "cd");
+    ::close(w2);
+    if (!scanner.run() || closed != 1)
+      error("run after remove in match handler");
+    std::cout << test << std::endl;
+    if (test != "ab/cd/")
+      error("matches after remove in match handler");
+  }
+  //
+  banner("DONE");
+  //
+  exit(EXIT_SUCCESS);
+}
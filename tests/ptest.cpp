@@ -330,6 +330,28 @@ int main()
     error("find with nullable results");
   matcher.reset("");
   //
+  banner("TEST PREFILTER");
+  //
+  // lookarounds and backreferences are matched by PCRE2 after the DFA prefilter skips ahead, including optional items
+  const char *prefilter_tests[] = {
+    "(?<=\\$)(USD|)\\d+(?=\\.)", "$USD12. $34. USD56. $USD7 $8.", "USD12/34/8/",
+    "(?<=:)(a\\d+b)?c\\w",       ":a12bcx :cy a1bcz :a1c :a1bc", "a12bcx/cy/",
+    "(\\w)(x|)\\1",              "aa axa abxb bxbb",             "aa/axa/bxb/bxb/",
+    NULL, NULL, NULL };
+  for (const char **prefilter_test = prefilter_tests; *prefilter_test != NULL; prefilter_test += 3)
+  {
+    MATCHER prefilter_matcher(prefilter_test[0], prefilter_test[1]);
+    test = "";
+    while (prefilter_matcher.find())
+    {
+      std::cout << prefilter_matcher.text() << "/";
+      test.append(prefilter_matcher.text()).append("/");
+    }
+    std::cout << std::endl;
+    if (test != prefilter_test[2])
+      error("prefilter find results");
+  }
+  //
   banner("TEST SPLIT");
   //
   matcher.pattern(pattern3);
@@ -558,6 +580,35 @@ int main()
     error("wunput");
   }
   //
+  banner("TEST BUDGET");
+  //
+  std::string budget_text;
+  for (int i = 0; i < 1000; ++i)
+    budget_text.append("ab ");
+  matcher.pattern(pattern8);
+  matcher.input(budget_text);
+  matcher.budget(0, 100);
+  int matches = 0;
+  int interrupts = 0;
+  while (true)
+  {
+    // find() returns zero when interrupted, the search resumes with a new budget
+    if (!matcher.find())
+    {
+      if (!matcher.interrupted())
+        break;
+      ++interrupts;
+      matcher.budget(0, 100);
+      continue;
+    }
+    if (matcher.str() != "ab")
+      error("budget results");
+    ++matches;
+  }
+  std::cout << "MATCHES = " << matches << " INTERRUPTS = " << interrupts << std::endl;
+  if (matches != 1000 || interrupts == 0)
+    error("budget resume results");
+  //
   banner("TEST WRAP");
   //
   WrappedMatcher wrapped_matcher;
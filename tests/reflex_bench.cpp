@@ -0,0 +1,725 @@
+// Benchmark suite with reproducible synthetic corpora, pattern families and
+// matcher engines, writes results in JSON
+//
+// > make -f Make reflex_bench
+// > ./reflex_bench [-s MB] [-r RUNS] [-f FILTER] [-p] [-q] [-o FILE]
+//
+// or with CMake:
+//
+// > cmake --build build --target reflex_bench
+//
+// -s MB      size of each corpus in MB (default 16)
+// -r RUNS    number of runs, the fastest run is reported (default 3)
+// -f FILTER  only run benchmarks with a name that contains FILTER
+// -p         collect hardware performance counters with perf_event_open(2)
+// -q         quick mode, skips the 100k literal set and uses 1 MB corpora
+// -o FILE    write JSON to FILE instead of stdout
+//
+// The corpora are generated with a fixed seed, the same options produce the
+// same corpora on every platform.  Define HAVE_PCRE2 and/or HAVE_BOOST_REGEX
+// and link -lpcre2-8 and/or -lboost_regex to include the PCRE2 and Boost.Regex
+// engines.  The lexer benchmarks also report the "Matcher JIT" engine, which
+// matches with the pattern compiled with Pattern option j to x86-64 code.
+//
+// Each result reports the corpus size in bytes, pattern compile time in ms,
+// GB/s and matches/s of the fastest run, and the peak RSS of the process in
+// KB measured after the benchmark, which is the peak of all benchmarks so far.
+//
+// With -p on Linux, each result also reports the cycles, instructions, branch
+// misses and L1d, L1i and LLC read misses per byte of the fastest run, and the
+// instructions per cycle.  Counters that are not available, for example in a
+// container or when perf_event_paranoid is too high, are reported as null.
+
+#include <reflex/matcher.h>
+#include <reflex/linematcher.h>
+#include "../fuzzy/fuzzymatcher.h"
+#ifdef HAVE_PCRE2
+#include <reflex/pcre2matcher.h>
+#endif
+#ifdef HAVE_BOOST_REGEX
+#include <reflex/boostmatcher.h>
+#endif
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+static double now()
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// peak resident set size of the process in KB
+static long peak_rss()
+{
+#ifdef _WIN32
+  return 0;
+#else
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+    return 0;
+#ifdef __APPLE__
+  return static_cast<long>(usage.ru_maxrss / 1024);
+#else
+  return static_cast<long>(usage.ru_maxrss);
+#endif
+#endif
+}
+
+// deterministic 64-bit LCG, unlike rand() it produces the same sequence everywhere
+class Random {
+ public:
+  Random(uint64_t seed) : x_(seed) { }
+  uint32_t next()
+  {
+    x_ = x_ * 6364136223846793005ULL + 1442695040888963407ULL;
+    return static_cast<uint32_t>(x_ >> 33);
+  }
+  size_t operator()(size_t n)
+  {
+    return next() % n;
+  }
+ private:
+  uint64_t x_;
+};
+
+// hardware performance counters of this thread measured with perf_event_open(2), when available
+class Perf {
+ public:
+  enum { CYCLES, INSTRUCTIONS, BRANCH_MISSES, L1D_MISSES, L1I_MISSES, LLC_MISSES, N };
+  Perf()
+  {
+    for (int i = 0; i < N; ++i)
+      fd_[i] = -1;
+  }
+  ~Perf()
+  {
+#ifdef __linux__
+    for (int i = 0; i < N; ++i)
+      if (fd_[i] >= 0)
+        close(fd_[i]);
+#endif
+  }
+  // open the counters, returns the number of counters available
+  int open()
+  {
+    int k = 0;
+#ifdef __linux__
+    static const uint32_t type[N] = {
+      PERF_TYPE_HARDWARE,
+      PERF_TYPE_HARDWARE,
+      PERF_TYPE_HARDWARE,
+      PERF_TYPE_HW_CACHE,
+      PERF_TYPE_HW_CACHE,
+      PERF_TYPE_HW_CACHE,
+    };
+    static const uint64_t config[N] = {
+      PERF_COUNT_HW_CPU_CYCLES,
+      PERF_COUNT_HW_INSTRUCTIONS,
+      PERF_COUNT_HW_BRANCH_MISSES,
+      PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+      PERF_COUNT_HW_CACHE_L1I | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+      PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+    };
+    for (int i = 0; i < N; ++i)
+    {
+      struct perf_event_attr attr;
+      memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = type[i];
+      attr.config = config[i];
+      attr.disabled = 1;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      // counters are multiplexed when there are more counters than hardware registers, scale by the time enabled
+      attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+      fd_[i] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+      if (fd_[i] >= 0)
+        ++k;
+    }
+#endif
+    return k;
+  }
+  void start()
+  {
+#ifdef __linux__
+    for (int i = 0; i < N; ++i)
+    {
+      if (fd_[i] >= 0)
+      {
+        ioctl(fd_[i], PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd_[i], PERF_EVENT_IOC_ENABLE, 0);
+      }
+    }
+#endif
+  }
+  // stop the counters and store their values, -1 when not available
+  void stop(double value[N])
+  {
+    for (int i = 0; i < N; ++i)
+    {
+      value[i] = -1;
+#ifdef __linux__
+      if (fd_[i] >= 0)
+      {
+        ioctl(fd_[i], PERF_EVENT_IOC_DISABLE, 0);
+        uint64_t data[3];
+        if (read(fd_[i], data, sizeof(data)) == sizeof(data) && data[2] > 0)
+          value[i] = static_cast<double>(data[0]) * static_cast<double>(data[1]) / static_cast<double>(data[2]);
+      }
+#endif
+    }
+  }
+  static const char *name(int i)
+  {
+    static const char *names[N] = { "cycles", "instructions", "branch_misses", "l1d_misses", "l1i_misses", "llc_misses" };
+    return names[i];
+  }
+ private:
+  int fd_[N];
+};
+
+static Perf perf;
+static bool use_perf = false;
+static double counters[Perf::N];
+
+static const char *words[] = {
+  "request", "response", "server", "client", "session", "timeout", "connect", "socket",
+  "buffer", "cache", "index", "query", "token", "worker", "thread", "stream",
+  "module", "config", "handler", "update", "delete", "create", "commit", "retry",
+};
+
+static const size_t nwords = sizeof(words) / sizeof(*words);
+
+// ASCII log lines with timestamps, levels, key=value pairs
+static std::string log_corpus(size_t size, Random& rnd)
+{
+  static const char *levels[] = { "INFO", "INFO", "INFO", "DEBUG", "DEBUG", "WARN", "ERROR" };
+  std::string text;
+  text.reserve(size + 256);
+  char line[256];
+  while (text.size() < size)
+  {
+    snprintf(line, sizeof(line), "2024-%02u-%02uT%02u:%02u:%02u.%03uZ %-5s [worker-%u] %s %s id=%08x status=%u latency=%ums\n",
+        1 + static_cast<unsigned>(rnd(12)),
+        1 + static_cast<unsigned>(rnd(28)),
+        static_cast<unsigned>(rnd(24)),
+        static_cast<unsigned>(rnd(60)),
+        static_cast<unsigned>(rnd(60)),
+        static_cast<unsigned>(rnd(1000)),
+        levels[rnd(sizeof(levels) / sizeof(*levels))],
+        static_cast<unsigned>(rnd(64)),
+        words[rnd(nwords)],
+        words[rnd(nwords)],
+        rnd.next(),
+        rnd(8) == 0 ? 500 : 200,
+        static_cast<unsigned>(rnd(2000)));
+    text.append(line);
+  }
+  return text;
+}
+
+// UTF-8 text with Latin, Greek, Cyrillic, Han, Arabic words and emoji
+static std::string utf8_corpus(size_t size, Random& rnd)
+{
+  static const char *mwords[] = {
+    "text", "caf\xc3\xa9", "na\xc3\xafve", "stra\xc3\x9f" "e",
+    "\xce\xb1\xce\xbb\xcf\x86\xce\xb1", "\xce\xbb\xcf\x8c\xce\xb3\xce\xbf\xcf\x82",
+    "\xd0\xbc\xd0\xb8\xd1\x80", "\xd0\xb4\xd0\xbe\xd0\xbc",
+    "\xe4\xb8\xad\xe6\x96\x87", "\xe6\xbc\xa2\xe5\xad\x97",
+    "\xd8\xb3\xd9\x84\xd8\xa7\xd9\x85", "\xf0\x9f\x98\x80",
+  };
+  std::string text;
+  text.reserve(size + 64);
+  while (text.size() < size)
+  {
+    text.append(mwords[rnd(sizeof(mwords) / sizeof(*mwords))]);
+    text.push_back(rnd(12) == 0 ? '\n' : ' ');
+  }
+  return text;
+}
+
+// C-like source code
+static std::string code_corpus(size_t size, Random& rnd)
+{
+  std::string text;
+  text.reserve(size + 256);
+  char line[256];
+  while (text.size() < size)
+  {
+    switch (rnd(6))
+    {
+      case 0:
+        snprintf(line, sizeof(line), "int %s_%s(int %s, const char *%s)\n{\n", words[rnd(nwords)], words[rnd(nwords)], words[rnd(nwords)], words[rnd(nwords)]);
+        break;
+      case 1:
+        snprintf(line, sizeof(line), "  if (%s > %u && %s != NULL)\n    return %u;\n", words[rnd(nwords)], static_cast<unsigned>(rnd(1000)), words[rnd(nwords)], static_cast<unsigned>(rnd(10)));
+        break;
+      case 2:
+        snprintf(line, sizeof(line), "  %s = %s(\"%s %s\", %u.%u);\n", words[rnd(nwords)], words[rnd(nwords)], words[rnd(nwords)], words[rnd(nwords)], static_cast<unsigned>(rnd(100)), static_cast<unsigned>(rnd(100)));
+        break;
+      case 3:
+        snprintf(line, sizeof(line), "  // %s the %s before the %s\n", words[rnd(nwords)], words[rnd(nwords)], words[rnd(nwords)]);
+        break;
+      case 4:
+        snprintf(line, sizeof(line), "  for (int i = 0; i < %u; ++i)\n    %s[i] += 0x%x;\n", static_cast<unsigned>(rnd(256)), words[rnd(nwords)], rnd.next() & 0xffff);
+        break;
+      default:
+        snprintf(line, sizeof(line), "}\n\n");
+        break;
+    }
+    text.append(line);
+  }
+  return text;
+}
+
+// random bytes with embedded ASCII words
+static std::string binary_corpus(size_t size, Random& rnd)
+{
+  std::string text;
+  text.reserve(size + 64);
+  while (text.size() < size)
+  {
+    if (rnd(16) == 0)
+      text.append(words[rnd(nwords)]);
+    else
+      text.push_back(static_cast<char>(rnd.next() & 0xff));
+  }
+  return text;
+}
+
+// encode UTF-8 as UTF-16LE with a BOM
+static std::string utf16_encode(const std::string& utf8)
+{
+  std::string text("\xff\xfe", 2);
+  text.reserve(2 * utf8.size() + 2);
+  const unsigned char *s = reinterpret_cast<const unsigned char*>(utf8.c_str());
+  while (*s != '\0')
+  {
+    uint32_t c = *s++;
+    if (c >= 0xf0)
+    {
+      c = ((c & 0x07) << 18) | ((s[0] & 0x3f) << 12) | ((s[1] & 0x3f) << 6) | (s[2] & 0x3f);
+      s += 3;
+    }
+    else if (c >= 0xe0)
+    {
+      c = ((c & 0x0f) << 12) | ((s[0] & 0x3f) << 6) | (s[1] & 0x3f);
+      s += 2;
+    }
+    else if (c >= 0xc0)
+    {
+      c = ((c & 0x1f) << 6) | (s[0] & 0x3f);
+      s += 1;
+    }
+    if (c >= 0x10000)
+    {
+      c -= 0x10000;
+      uint32_t h = 0xd800 + (c >> 10);
+      text.push_back(static_cast<char>(h & 0xff));
+      text.push_back(static_cast<char>(h >> 8));
+      c = 0xdc00 + (c & 0x3ff);
+    }
+    text.push_back(static_cast<char>(c & 0xff));
+    text.push_back(static_cast<char>(c >> 8));
+  }
+  return text;
+}
+
+// a set of n distinct words, every tenth word occurs in the log corpus
+static std::string literal_set(size_t n, Random& rnd)
+{
+  std::string regex;
+  for (size_t i = 0; i < n; ++i)
+  {
+    if (i > 0)
+      regex.push_back('|');
+    if (i % 10 == 0)
+    {
+      regex.append(words[(i / 10) % nwords]);
+    }
+    else
+    {
+      size_t len = 6 + rnd(6);
+      for (size_t j = 0; j < len; ++j)
+        regex.push_back(static_cast<char>('a' + rnd(26)));
+    }
+  }
+  return regex;
+}
+
+// a corpus is a string or a UTF-16 file decoded by reflex::Input
+struct Corpus {
+  const char        *name;
+  const std::string *text;
+  FILE              *file;
+  size_t             size;
+};
+
+// engine flags
+enum {
+  MATCHER = 1,
+  FUZZY   = 2,
+  LINE    = 4,
+  PCRE2   = 8,
+  BOOST   = 16,
+  JIT     = 32,
+  ALL     = MATCHER | FUZZY | PCRE2 | BOOST,
+  DFA     = MATCHER | FUZZY | JIT,
+};
+
+// a benchmark matches a pattern family regex on a corpus with the specified engines
+struct Bench {
+  const char *family;
+  const char *name;
+  std::string regex;
+  const char *corpus;
+  int         engines;
+  bool        scan;
+};
+
+struct Options {
+  size_t      size;
+  int         runs;
+  const char *filter;
+  bool        quick;
+  bool        perf;
+  const char *out;
+};
+
+static std::string json_escape(const std::string& s)
+{
+  std::string t;
+  for (size_t i = 0; i < s.size(); ++i)
+  {
+    unsigned char c = static_cast<unsigned char>(s[i]);
+    if (c == '"' || c == '\\')
+    {
+      t.push_back('\\');
+      t.push_back(static_cast<char>(c));
+    }
+    else if (c < 0x20)
+    {
+      char buf[8];
+      snprintf(buf, sizeof(buf), "\\u%04x", c);
+      t.append(buf);
+    }
+    else
+    {
+      t.push_back(static_cast<char>(c));
+    }
+  }
+  return t;
+}
+
+static FILE *fd = stdout;
+static bool first = true;
+
+static void report(const Bench& bench, const Corpus& corpus, const char *engine, double compile, double elapsed, size_t matches)
+{
+  double gbps = elapsed > 0 ? static_cast<double>(corpus.size) / elapsed / 1e9 : 0;
+  double mps = elapsed > 0 ? static_cast<double>(matches) / elapsed : 0;
+  fprintf(fd, "%s\n    {\"family\": \"%s\", \"name\": \"%s\", \"corpus\": \"%s\", \"engine\": \"%s\", \"bytes\": %zu, \"compile_ms\": %.3f, \"seconds\": %.6f, \"gbps\": %.4f, \"matches\": %zu, \"matches_per_s\": %.0f, \"peak_rss_kb\": %ld",
+      first ? "" : ",",
+      bench.family,
+      json_escape(bench.name).c_str(),
+      corpus.name,
+      engine,
+      corpus.size,
+      1e3 * compile,
+      elapsed,
+      gbps,
+      matches,
+      mps,
+      peak_rss());
+  if (use_perf)
+  {
+    // per-byte metrics of the fastest run
+    double bytes = static_cast<double>(corpus.size);
+    fprintf(fd, ", \"counters\": {");
+    for (int i = 0; i < Perf::N; ++i)
+    {
+      if (counters[i] >= 0)
+        fprintf(fd, "\"%s_per_byte\": %.6f, ", Perf::name(i), counters[i] / bytes);
+      else
+        fprintf(fd, "\"%s_per_byte\": null, ", Perf::name(i));
+    }
+    if (counters[Perf::CYCLES] > 0 && counters[Perf::INSTRUCTIONS] >= 0)
+      fprintf(fd, "\"ipc\": %.3f}", counters[Perf::INSTRUCTIONS] / counters[Perf::CYCLES]);
+    else
+      fprintf(fd, "\"ipc\": null}");
+  }
+  fprintf(fd, "}");
+  fflush(fd);
+  first = false;
+}
+
+static reflex::Input input(const Corpus& corpus)
+{
+  if (corpus.file != NULL)
+  {
+    rewind(corpus.file);
+    return reflex::Input(corpus.file);
+  }
+  return reflex::Input(*corpus.text);
+}
+
+// run the matcher the specified number of times, returns the fastest time and sets the counters of the fastest run
+template<typename M>
+static double run(M& matcher, const Corpus& corpus, bool scan, int runs, size_t& matches)
+{
+  double best = 0;
+  for (int i = 0; i < runs; ++i)
+  {
+    size_t n = 0;
+    double value[Perf::N];
+    if (use_perf)
+      perf.start();
+    double t0 = now();
+    matcher.input(input(corpus));
+    if (scan)
+      while (matcher.scan() != 0)
+        ++n;
+    else
+      while (matcher.find() != 0)
+        ++n;
+    double t = now() - t0;
+    if (use_perf)
+      perf.stop(value);
+    if (i == 0 || t < best)
+    {
+      best = t;
+      if (use_perf)
+        memcpy(counters, value, sizeof(counters));
+    }
+    matches = n;
+  }
+  return best;
+}
+
+// only the unicode family converts \w, \s and . to Unicode
+static reflex::convert_flag_type flags(const Bench& bench)
+{
+  return strcmp(bench.family, "unicode") == 0 ? reflex::convert_flag::unicode : reflex::convert_flag::none;
+}
+
+static void bench_reflex(const Bench& bench, const Corpus& corpus, const Options& options)
+{
+  size_t matches = 0;
+  double t0 = now();
+  reflex::Pattern pattern(reflex::Matcher::convert(bench.regex, flags(bench)));
+  double compile = now() - t0;
+  if ((bench.engines & MATCHER))
+  {
+    reflex::Matcher matcher(pattern);
+    double elapsed = run(matcher, corpus, bench.scan, options.runs, matches);
+    report(bench, corpus, "Matcher", compile, elapsed, matches);
+  }
+  if ((bench.engines & JIT))
+  {
+    // Pattern option j compiles the DFA to native code, compared to the Matcher engine selected by default
+    t0 = now();
+    reflex::Pattern jit_pattern(reflex::Matcher::convert(bench.regex, flags(bench)), "j");
+    double jit_compile = now() - t0;
+    reflex::Matcher matcher(jit_pattern);
+    double elapsed = run(matcher, corpus, bench.scan, options.runs, matches);
+    report(bench, corpus, "Matcher JIT", jit_compile, elapsed, matches);
+  }
+  if ((bench.engines & FUZZY) && !bench.scan)
+  {
+    reflex::FuzzyMatcher matcher(pattern, 1);
+    double elapsed = run(matcher, corpus, false, options.runs, matches);
+    report(bench, corpus, "FuzzyMatcher", compile, elapsed, matches);
+  }
+}
+
+static void bench_line(const Bench& bench, const Corpus& corpus, const Options& options)
+{
+  size_t matches = 0;
+  reflex::LineMatcher matcher;
+  double elapsed = run(matcher, corpus, false, options.runs, matches);
+  report(bench, corpus, "LineMatcher", 0, elapsed, matches);
+}
+
+#ifdef HAVE_PCRE2
+static void bench_pcre2(const Bench& bench, const Corpus& corpus, const Options& options)
+{
+  size_t matches = 0;
+  double t0 = now();
+  reflex::PCRE2Matcher matcher(reflex::PCRE2Matcher::convert(bench.regex, flags(bench)));
+  double compile = now() - t0;
+  double elapsed = run(matcher, corpus, bench.scan, options.runs, matches);
+  report(bench, corpus, "PCRE2Matcher", compile, elapsed, matches);
+}
+#endif
+
+#ifdef HAVE_BOOST_REGEX
+static void bench_boost(const Bench& bench, const Corpus& corpus, const Options& options)
+{
+  size_t matches = 0;
+  double t0 = now();
+  reflex::BoostMatcher matcher(reflex::BoostMatcher::convert(bench.regex, reflex::convert_flag::none));
+  double compile = now() - t0;
+  double elapsed = run(matcher, corpus, bench.scan, options.runs, matches);
+  report(bench, corpus, "BoostMatcher", compile, elapsed, matches);
+}
+#endif
+
+static void help(const char *prog)
+{
+  fprintf(stderr, "Usage: %s [-s MB] [-r RUNS] [-f FILTER] [-p] [-q] [-o FILE]\n", prog);
+  exit(EXIT_FAILURE);
+}
+
+int main(int argc, char **argv)
+{
+  Options options = { 16, 3, NULL, false, false, NULL };
+  bool size_set = false;
+  for (int i = 1; i < argc; ++i)
+  {
+    const char *arg = argv[i];
+    if (strcmp(arg, "-q") == 0)
+      options.quick = true;
+    else if (strcmp(arg, "-p") == 0)
+      options.perf = true;
+    else if (i + 1 >= argc)
+      help(argv[0]);
+    else if (strcmp(arg, "-s") == 0)
+      options.size = static_cast<size_t>(atoi(argv[++i])), size_set = true;
+    else if (strcmp(arg, "-r") == 0)
+      options.runs = atoi(argv[++i]);
+    else if (strcmp(arg, "-f") == 0)
+      options.filter = argv[++i];
+    else if (strcmp(arg, "-o") == 0)
+      options.out = argv[++i];
+    else
+      help(argv[0]);
+  }
+  if (options.quick && !size_set)
+    options.size = 1;
+  if (options.size == 0 || options.runs <= 0)
+    help(argv[0]);
+  size_t size = options.size * 1000000;
+  int available = 0;
+  if (options.perf)
+  {
+    available = perf.open();
+    if (available < Perf::N)
+      fprintf(stderr, "reflex_bench: %d of %d hardware performance counters are available, the others are reported as null\n", available, static_cast<int>(Perf::N));
+    use_perf = true;
+  }
+
+  // generate the corpora, each with its own seed
+  Random rnd_log(1), rnd_utf8(2), rnd_code(3), rnd_binary(4), rnd_set(5);
+  std::string log = log_corpus(size, rnd_log);
+  std::string utf8 = utf8_corpus(size, rnd_utf8);
+  std::string code = code_corpus(size, rnd_code);
+  std::string binary = binary_corpus(size, rnd_binary);
+  std::string utf16 = utf16_encode(utf8);
+  FILE *file = tmpfile();
+  if (file == NULL || fwrite(utf16.data(), 1, utf16.size(), file) != utf16.size())
+  {
+    perror("reflex_bench: cannot create UTF-16 corpus");
+    exit(EXIT_FAILURE);
+  }
+  fflush(file);
+
+  Corpus corpora[] = {
+    { "log",    &log,    NULL, log.size() },
+    { "utf8",   &utf8,   NULL, utf8.size() },
+    { "utf16",  NULL,    file, utf16.size() },
+    { "code",   &code,   NULL, code.size() },
+    { "binary", &binary, NULL, binary.size() },
+  };
+
+  std::vector<Bench> benches;
+  benches.push_back(Bench{ "literal", "literal", "ERROR", "log", ALL, false });
+  benches.push_back(Bench{ "literal", "literal-rare", "zyzzyva", "log", ALL, false });
+  benches.push_back(Bench{ "literal", "literal-binary", "socket", "binary", ALL, false });
+  benches.push_back(Bench{ "literal-set", "literal-set-10", literal_set(10, rnd_set), "log", ALL, false });
+  benches.push_back(Bench{ "literal-set", "literal-set-1k", literal_set(1000, rnd_set), "log", MATCHER | PCRE2 | BOOST, false });
+  if (!options.quick)
+    benches.push_back(Bench{ "literal-set", "literal-set-100k", literal_set(100000, rnd_set), "log", MATCHER, false });
+  benches.push_back(Bench{ "regex", "timestamp", "\\d{4}-\\d\\d-\\d\\dT\\d\\d:\\d\\d", "log", ALL, false });
+  benches.push_back(Bench{ "regex", "key-value", "\\w+=\\w+", "log", ALL, false });
+  benches.push_back(Bench{ "unicode", "unicode-greek", "\\p{Greek}+", "utf8", MATCHER | PCRE2, false });
+  benches.push_back(Bench{ "unicode", "unicode-han", "\\p{Han}+", "utf8", MATCHER | PCRE2, false });
+  benches.push_back(Bench{ "unicode", "unicode-words", "\\w+", "utf8", MATCHER | PCRE2, false });
+  benches.push_back(Bench{ "unicode", "unicode-greek-utf16", "\\p{Greek}+", "utf16", MATCHER | PCRE2, false });
+  benches.push_back(Bench{ "unicode", "unicode-words-utf16", "\\w+", "utf16", MATCHER | PCRE2, false });
+  benches.push_back(Bench{ "lexer", "lexer-c", "([A-Za-z_]\\w*)|(0x[0-9a-fA-F]+|\\d+(?:\\.\\d+)?)|(\"[^\"\\n]*\")|(//[^\\n]*)|([ \\t\\n]+)|([-+*/%=<>!&|^~]+)|(.)", "code", MATCHER | JIT | PCRE2 | BOOST, true });
+  benches.push_back(Bench{ "lexer", "lexer-log", "(\\d+)|(\\w+)|(\\s+)|(.)", "log", MATCHER | JIT | PCRE2 | BOOST, true });
+  benches.push_back(Bench{ "lexer", "lexer-keywords", "(int|char|long|short|float|double|void|if|else|while|for|do|return|break|continue|switch|case|default|struct|union|enum|typedef|static|const|sizeof)(?=\\W)|([A-Za-z_]\\w*)|(0x[0-9a-fA-F]+|\\d+(?:\\.\\d+)?)|(\"[^\"\\n]*\")|(//[^\\n]*)|([ \\t\\n]+)|([-+*/%=<>!&|^~]+)|(.)", "code", MATCHER | JIT | PCRE2 | BOOST, true });
+  benches.push_back(Bench{ "pathological", "dfa-blowup", "(a|b)*a(a|b){10}", "log", MATCHER, false });
+  benches.push_back(Bench{ "pathological", "backtrack-nested", "(\\w+\\s?)+;", "code", MATCHER, false });
+  benches.push_back(Bench{ "pathological", "backtrack-alternation", "(a|aa|aaa)+b", "binary", DFA, false });
+  benches.push_back(Bench{ "lines", "lines-log", "", "log", LINE, false });
+  benches.push_back(Bench{ "lines", "lines-code", "", "code", LINE, false });
+
+  if (options.out != NULL)
+  {
+    fd = fopen(options.out, "w");
+    if (fd == NULL)
+    {
+      perror("reflex_bench: cannot open output file");
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  fprintf(fd, "{\n  \"config\": {\"corpus_mb\": %zu, \"runs\": %d, \"quick\": %s, \"pcre2\": %s, \"boost\": %s, \"perf_counters\": %d},\n  \"results\": [",
+      options.size,
+      options.runs,
+      options.quick ? "true" : "false",
+#ifdef HAVE_PCRE2
+      "true",
+#else
+      "false",
+#endif
+#ifdef HAVE_BOOST_REGEX
+      "true",
+#else
+      "false",
+#endif
+      available);
+
+  for (std::vector<Bench>::const_iterator bench = benches.begin(); bench != benches.end(); ++bench)
+  {
+    if (options.filter != NULL && strstr(bench->name, options.filter) == NULL)
+      continue;
+    const Corpus *corpus = NULL;
+    for (size_t i = 0; i < sizeof(corpora) / sizeof(*corpora); ++i)
+      if (strcmp(corpora[i].name, bench->corpus) == 0)
+        corpus = &corpora[i];
+    if (corpus == NULL)
+      continue;
+    if ((bench->engines & LINE))
+      bench_line(*bench, *corpus, options);
+    if ((bench->engines & DFA))
+      bench_reflex(*bench, *corpus, options);
+#ifdef HAVE_PCRE2
+    if ((bench->engines & PCRE2))
+      bench_pcre2(*bench, *corpus, options);
+#endif
+#ifdef HAVE_BOOST_REGEX
+    if ((bench->engines & BOOST))
+      bench_boost(*bench, *corpus, options);
+#endif
+  }
+
+  fprintf(fd, "\n  ]\n}\n");
+  if (fd != stdout)
+    fclose(fd);
+  fclose(file);
+  return 0;
+}
@@ -0,0 +1,302 @@
+// Benchmark reflex::Pattern compilation time and memory as the number of
+// rules, Unicode classes and repetition bounds increase, reports the growth
+// exponent of each sweep to detect superlinear regressions
+//
+// > make -f Make reflex_cbench
+// > ./reflex_cbench [-c LIMIT] [-f FILTER] [-j]
+//
+// or with CMake:
+//
+// > cmake --build build --target reflex_cbench
+//
+// -c LIMIT   exit with failure when the growth exponent of a checked sweep
+//            exceeds LIMIT (default 1.5, 0 to disable)
+// -f FILTER  only run sweeps with a name that contains FILTER
+// -j         write JSON instead of tables
+//
+// Each row reports the time in ms and the bytes allocated with operator new
+// in the parse, nodes (with edges), hashing and words compilation phases, and
+// the resulting nodes(), edges() and words().  The growth exponent is the
+// least squares slope of log(time) over log(n), 1 is linear, 2 is quadratic.
+// The pathological sweep grows exponentially and is reported but not checked.
+
+#include <reflex/matcher.h>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+
+// bytes allocated with operator new since the start of the program
+static size_t allocated = 0;
+
+void *operator new(size_t size)
+{
+  allocated += size;
+  void *ptr = malloc(size > 0 ? size : 1);
+  if (ptr == NULL)
+    throw std::bad_alloc();
+  return ptr;
+}
+
+void operator delete(void *ptr) noexcept
+{
+  free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+  free(ptr);
+}
+
+// compilation phases reported by reflex::Pattern::phase_hook()
+static const char *phases[] = { "parse", "nodes", "hashing", "words" };
+
+static const size_t nphases = sizeof(phases) / sizeof(*phases);
+
+static size_t phase_bytes[nphases];
+static size_t phase_mark = 0;
+
+static void phase_hook(const char *phase)
+{
+  for (size_t i = 0; i < nphases; ++i)
+  {
+    if (strcmp(phase, phases[i]) == 0)
+    {
+      phase_bytes[i] += allocated - phase_mark;
+      break;
+    }
+  }
+  phase_mark = allocated;
+}
+
+struct Row {
+  size_t n;
+  float  ms[nphases + 1]; // parse, nodes, hashing, words, edges
+  size_t bytes[nphases];
+  size_t nodes;
+  size_t edges;
+  size_t words;
+  float  total;
+};
+
+// a sweep compiles the regex returned by make(n) for each n
+struct Sweep {
+  const char *name;
+  std::string (*make)(size_t n);
+  size_t      from;
+  size_t      to;
+  const char *opt;
+  bool        check;
+};
+
+static const char *keywords[] = {
+  "if", "else", "while", "for", "do", "return", "break", "continue",
+  "switch", "case", "default", "goto", "struct", "union", "enum", "typedef",
+};
+
+// lexer with n keyword rules followed by identifier, number, string and operator rules
+static std::string rules(size_t n)
+{
+  std::string regex;
+  char buf[32];
+  for (size_t i = 0; i < n; ++i)
+  {
+    snprintf(buf, sizeof(buf), "(%s%zu)|", keywords[i % 16], i / 16);
+    regex.append(buf);
+  }
+  regex.append("([A-Za-z_]\\w*)|(\\d+(\\.\\d+)?([eE][-+]?\\d+)?)|(\"([^\"\\\\]|\\\\.)*\")|([-+*/%=<>!&|^~]=?)|(\\s+)");
+  return regex;
+}
+
+// n literal strings, similar to searching a word list
+static std::string literals(size_t n)
+{
+  std::string regex;
+  unsigned x = 1;
+  for (size_t i = 0; i < n; ++i)
+  {
+    if (i > 0)
+      regex.push_back('|');
+    size_t len = 4 + i % 8;
+    for (size_t j = 0; j < len; ++j)
+    {
+      x = 1103515245 * x + 12345;
+      regex.push_back(static_cast<char>('a' + (x >> 16) % 26));
+    }
+  }
+  return regex;
+}
+
+static const char *scripts[] = {
+  "Greek", "Cyrillic", "Armenian", "Hebrew", "Arabic", "Devanagari", "Bengali", "Thai",
+  "Georgian", "Hangul", "Hiragana", "Katakana", "Han", "Ethiopic", "Cherokee", "Latin",
+};
+
+// n rules with a Unicode script class each
+static std::string unicode(size_t n)
+{
+  std::string regex;
+  for (size_t i = 0; i < n; ++i)
+  {
+    if (i > 0)
+      regex.push_back('|');
+    regex.append("(\\p{").append(scripts[i % 16]).append("}+)");
+  }
+  return reflex::Matcher::convert(regex, reflex::convert_flag::unicode);
+}
+
+// bounded repetition of a character class
+static std::string repeat(size_t n)
+{
+  char buf[64];
+  snprintf(buf, sizeof(buf), "[a-z][a-z0-9_]{0,%zu}\\d{%zu}", n, n / 4 + 1);
+  return buf;
+}
+
+// the DFA of this pattern has 2^(n+1) states, one for each combination of the last n+1 letters
+static std::string pathological(size_t n)
+{
+  char buf[64];
+  snprintf(buf, sizeof(buf), "(a|b)*a(a|b){%zu}", n);
+  return buf;
+}
+
+static const Sweep sweeps[] = {
+  { "rules",        rules,        16, 4096, "",  true },
+  { "literals",     literals,     16, 65536, "", true },
+  { "literals-hfa", literals,     16, 4096, "h", true },
+  { "unicode",      unicode,      1,  16,   "",  true },
+  { "repeat",       repeat,       4,  256,  "",  true },
+  { "pathological", pathological, 2,  8,    "",  false },
+};
+
+static Row compile(const std::string& regex, const char *opt, size_t n)
+{
+  Row row;
+  for (size_t i = 0; i < nphases; ++i)
+    phase_bytes[i] = 0;
+  phase_mark = allocated;
+  reflex::Pattern pattern(regex, opt);
+  row.n = n;
+  row.ms[0] = pattern.parse_time();
+  row.ms[1] = pattern.nodes_time();
+  row.ms[2] = pattern.hashing_time();
+  row.ms[3] = pattern.words_time();
+  row.ms[4] = pattern.edges_time();
+  for (size_t i = 0; i < nphases; ++i)
+    row.bytes[i] = phase_bytes[i];
+  row.nodes = pattern.nodes();
+  row.edges = pattern.edges();
+  row.words = pattern.words();
+  row.total = row.ms[0] + row.ms[1] + row.ms[2] + row.ms[3] + row.ms[4];
+  return row;
+}
+
+// least squares slope of log(y) over log(n), ignores rows with y too small to measure
+static double exponent(const std::vector<Row>& rows, double (*y)(const Row&))
+{
+  double sx = 0, sy = 0, sxx = 0, sxy = 0;
+  size_t k = 0;
+  for (size_t i = 0; i < rows.size(); ++i)
+  {
+    double v = y(rows[i]);
+    if (v < 0.05)
+      continue;
+    double lx = log(static_cast<double>(rows[i].n));
+    double ly = log(v);
+    sx += lx;
+    sy += ly;
+    sxx += lx * lx;
+    sxy += lx * ly;
+    ++k;
+  }
+  if (k < 2 || k * sxx - sx * sx == 0)
+    return 0;
+  return (k * sxy - sx * sy) / (k * sxx - sx * sx);
+}
+
+static double total(const Row& row)
+{
+  return row.total;
+}
+
+static double nodes(const Row& row)
+{
+  return static_cast<double>(row.nodes);
+}
+
+static double bytes(const Row& row)
+{
+  return static_cast<double>(row.bytes[0] + row.bytes[1] + row.bytes[2] + row.bytes[3]);
+}
+
+int main(int argc, char **argv)
+{
+  double limit = 1.5;
+  const char *filter = NULL;
+  bool json = false;
+  for (int i = 1; i < argc; ++i)
+  {
+    if (strcmp(argv[i], "-j") == 0)
+      json = true;
+    else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc)
+      limit = atof(argv[++i]);
+    else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc)
+      filter = argv[++i];
+    else
+    {
+      fprintf(stderr, "Usage: %s [-c LIMIT] [-f FILTER] [-j]\n", argv[0]);
+      exit(EXIT_FAILURE);
+    }
+  }
+  reflex::Pattern::phase_hook() = phase_hook;
+  bool fail = false;
+  bool first = true;
+  if (json)
+    printf("[");
+  for (size_t s = 0; s < sizeof(sweeps) / sizeof(*sweeps); ++s)
+  {
+    const Sweep& sweep = sweeps[s];
+    if (filter != NULL && strstr(sweep.name, filter) == NULL)
+      continue;
+    if (!json)
+    {
+      printf("\n%s\n", sweep.name);
+      printf("%8s %9s %9s %9s %9s %9s %11s %11s %11s %8s %9s %9s\n", "n", "parse ms", "nodes ms", "edges ms", "hash ms", "words ms", "parse B", "nodes B", "words B", "nodes", "edges", "words");
+    }
+    std::vector<Row> rows;
+    for (size_t n = sweep.from; n <= sweep.to; n *= 2)
+    {
+      Row row = compile(sweep.make(n), sweep.opt, n);
+      rows.push_back(row);
+      if (!json)
+        printf("%8zu %9.2f %9.2f %9.2f %9.2f %9.2f %11zu %11zu %11zu %8zu %9zu %9zu\n", row.n, row.ms[0], row.ms[1], row.ms[4], row.ms[2], row.ms[3], row.bytes[0], row.bytes[1], row.bytes[2] + row.bytes[3], row.nodes, row.edges, row.words);
+    }
+    double et = exponent(rows, total);
+    double en = exponent(rows, nodes);
+    double eb = exponent(rows, bytes);
+    bool over = sweep.check && limit > 0 && et > limit;
+    fail = fail || over;
+    if (json)
+    {
+      printf("%s\n  {\"sweep\": \"%s\", \"time_exponent\": %.3f, \"nodes_exponent\": %.3f, \"bytes_exponent\": %.3f, \"checked\": %s, \"superlinear\": %s, \"rows\": [", first ? "" : ",", sweep.name, et, en, eb, sweep.check ? "true" : "false", over ? "true" : "false");
+      for (size_t i = 0; i < rows.size(); ++i)
+      {
+        const Row& row = rows[i];
+        printf("%s\n    {\"n\": %zu, \"parse_ms\": %.3f, \"nodes_ms\": %.3f, \"edges_ms\": %.3f, \"hashing_ms\": %.3f, \"words_ms\": %.3f, \"parse_bytes\": %zu, \"nodes_bytes\": %zu, \"hashing_bytes\": %zu, \"words_bytes\": %zu, \"nodes\": %zu, \"edges\": %zu, \"words\": %zu}", i > 0 ? "," : "", row.n, row.ms[0], row.ms[1], row.ms[4], row.ms[2], row.ms[3], row.bytes[0], row.bytes[1], row.bytes[2], row.bytes[3], row.nodes, row.edges, row.words);
+      }
+      printf("\n  ]}");
+    }
+    else
+    {
+      printf("growth exponent: time %.2f nodes %.2f bytes %.2f%s\n", et, en, eb, !sweep.check ? " (not checked)" : over ? " SUPERLINEAR" : "");
+    }
+    first = false;
+  }
+  if (json)
+    printf("\n]\n");
+  return fail ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -5,6 +5,9 @@
 // c++ -std=gnu++11 -Wall test.cpp pattern.cpp matcher.cpp
 
 #include <reflex/matcher.h>
+#include <reflex/async.h>
+#include <chrono>
+#include <sstream>
 
 // #define INTERACTIVE // for interactive mode testing
 
@@ -49,6 +52,95 @@ class WrappedMatcher : public Matcher {
   int source;
 };
 
+// an interactive source that blocks when read past its data, to detect reading ahead after a match
+class InteractiveBuffer : public std::streambuf {
+ public:
+  InteractiveBuffer(const char *data) : blocked(false), data(data)
+  { }
+  bool blocked;
+ private:
+  virtual int underflow()
+  {
+    if (*data == '\0')
+    {
+      blocked = true;
+      return EOF;
+    }
+    setg(const_cast<char*>(data), const_cast<char*>(data), const_cast<char*>(data) + 1);
+    return static_cast<unsigned char>(*data++);
+  }
+  const char *data;
+};
+
+// the results of scan, find or split with the matcher
+static std::string match_results(Matcher& matcher, int method)
+{
+  std::string results;
+  size_t accept;
+  while ((accept = matcher.perform(method)) != 0)
+  {
+    results.append(std::to_string(accept)).append(":").append(matcher.text()).append("/");
+    if (accept == Matcher::Const::EMPTY)
+      break;
+  }
+  return results;
+}
+
+// the results of scan, find or split with an AsyncMatcher fed in chunks
+static std::string async_results(AsyncMatcher<>& matcher, const std::string& text, size_t chunk, int method)
+{
+  std::string results;
+  size_t pos = 0;
+  while (true)
+  {
+    size_t accept = matcher.perform(method);
+    if (accept == 0 && matcher.interrupted())
+    {
+      if (!matcher.waiting())
+        return "not waiting";
+      if (pos < text.size())
+      {
+        size_t n = std::min(chunk, text.size() - pos);
+        matcher.feed(text.data() + pos, n);
+        pos += n;
+      }
+      else
+      {
+        matcher.close();
+      }
+      continue;
+    }
+    if (accept == 0)
+      break;
+    results.append(std::to_string(accept)).append(":").append(matcher.text()).append("/");
+    if (accept == Matcher::Const::EMPTY)
+      break;
+  }
+  return results;
+}
+
+#ifdef REFLEX_ASYNC_COROUTINES
+// a coroutine that starts eagerly and runs to completion
+struct AsyncTask {
+  struct promise_type {
+    AsyncTask get_return_object() { return AsyncTask(); }
+    std::suspend_never initial_suspend() noexcept { return std::suspend_never(); }
+    std::suspend_never final_suspend() noexcept { return std::suspend_never(); }
+    void return_void() { }
+    void unhandled_exception() { std::terminate(); }
+  };
+};
+
+// collect the results of async_scan() in the coroutine
+static AsyncTask async_scan_results(AsyncMatcher<>& matcher, std::string& results)
+{
+  size_t accept;
+  while ((accept = co_await matcher.async_scan()) != 0)
+    results.append(std::to_string(accept)).append(":").append(matcher.text()).append("/");
+  results.append("$");
+}
+#endif
+
 struct Test {
   const char *pattern;
   const char *popts;
@@ -252,6 +344,10 @@ Test tests[] = {
   { "(?m)[ \\t]*\\i|^[ \\t]+|[ \\t]*\\j|a|[ \\n]|(?^^[ \\t]*#\n)", "m", "", "a\n  a\n    #\n  a\n    a\n#\n  a\na\n", { 4, 5, 1, 4, 5, 2, 4, 5, 1, 4, 5, 3, 4, 5, 3, 4, 5 } },
   { "[ \\t]*\\i|^[ \\t]+|[ \\t]*\\j|a|[ \\n]|(?^\\\\\n[ \\t]+)", "m", "", "a\n  a\n  a\\\n      a a\n    a\n  a\na\n", { 4, 5, 1, 4, 5, 2, 4, 4, 5, 4, 5, 1, 4, 5, 3, 4, 5, 3, 4, 5 } },
   // { "(?m)[ \\t]*\\i|^[ \\t]+|[ \\t]*\\j|a|[ \\n]|(?^\\\\\n[ \\t]*)", "m", "", "a\n  a\n  a\\\na\n    a\n  a\na\n", { 4, 5, 1, 4, 5, 2, 4, 4, 5, 1, 4, 5, 2, 3, 4, 5, 3, 4, 5 } }, // TODO line continuation stopping at left margin triggers dedent
+  // Skip loops over self-looping DFA states, spanning SIMD blocks of 16, 32 and 64 bytes
+  { "\"[^\"\\\\\n]*\"|\\w+|\\s", "", "", "\"a string that is long enough to span more than a couple of SIMD blocks of sixty four bytes\" x\n\"\"", { 1, 3, 2, 3, 1 } },
+  { "/\\*(.|\\n)*?\\*/|\\w+|\\s", "", "", "x /* a comment that is long enough to span more than a couple of SIMD blocks ** of sixty four bytes */ y", { 2, 3, 1, 3, 2 } },
+  { "a[^\\n]*b|[^\\n]|\\n", "", "", "a0123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890bx\naxx", { 1, 2, 3, 2, 2, 2 } },
   // Unicode or UTF-8 (TODO: requires a flag and changes to the parser so that UTF-8 multibyte chars are parsed as ONE char)
   { "(©)+", "", "", "©", { 1 } },
   { NULL, NULL, NULL, NULL, { } }
@@ -296,6 +392,68 @@ int main()
     }
     printf("OK\n\n");
   }
+  banner("PATTERN TESTS WITH JIT");
+  for (const Test *test = tests; test->pattern != NULL; ++test)
+  {
+    std::string options(test->popts);
+    options.append("j");
+    Pattern pattern(test->pattern, options);
+    Matcher matcher(pattern, test->cstring, test->mopts);
+    size_t i = 0;
+    while (matcher.scan() && matcher.accept() == test->accepts[i])
+      ++i;
+    if (matcher.accept() != 0 || test->accepts[i] != 0 || !matcher.at_end())
+    {
+      printf("ERROR: JIT test \"%s\" against \"%s\" failed at accept = %zu\n", test->pattern, test->cstring, matcher.accept());
+      exit(1);
+    }
+  }
+  // JIT code buffers more input in the middle of a match when reading input in small blocks
+  const char *jit_regexs[] = { "\\w+|\\s+|.", "\"[^\"\\n]*\"|[a-z]+(?=\\()|[a-z]+|\\d+(\\.\\d+)?|\\s|.", "(a|b)*abb", NULL };
+  std::string jit_text("\"a string\" f(x) 3.14 abba abb bab babb\n\"\"xy\"z");
+  for (const char **regex = jit_regexs; *regex != NULL; ++regex)
+  {
+    Pattern pattern(*regex);
+    Pattern jit_pattern(*regex, "j");
+    for (int method = Matcher::Const::SCAN; method <= Matcher::Const::FIND; ++method)
+    {
+      for (size_t blk = 1; blk <= 4; ++blk)
+      {
+        std::istringstream stream(jit_text), jit_stream(jit_text);
+        Matcher matcher(pattern, stream);
+        Matcher jit_matcher(jit_pattern, jit_stream);
+        matcher.buffer(blk);
+        jit_matcher.buffer(blk);
+        if (match_results(matcher, method) != match_results(jit_matcher, method))
+        {
+          printf("ERROR: JIT test \"%s\" with buffer(%zu) failed\n", *regex, blk);
+          exit(1);
+        }
+      }
+    }
+  }
+  // an exception thrown when buffering more input propagates through JIT code
+  Pattern jit_pattern("\\w+", "j");
+  Matcher jit_matcher(jit_pattern);
+  jit_matcher.buffer_policy(256, 8192);
+  std::istringstream jit_stream(" " + std::string(10000, 'x'));
+  jit_matcher.input(jit_stream);
+  bool jit_thrown = false;
+  try
+  {
+    while (jit_matcher.find())
+      continue;
+  }
+  catch (const std::bad_alloc&)
+  {
+    jit_thrown = true;
+  }
+  if (!jit_thrown)
+  {
+    printf("ERROR: JIT test exception not thrown\n");
+    exit(1);
+  }
+  printf("OK\n\n");
   Pattern pattern1("\\w+|\\W", "f=dump.cpp");
   Pattern pattern2("\\<.*\\>", "f=dump.gv");
   Pattern pattern3(" ");
@@ -305,6 +463,8 @@ int main()
   Pattern pattern7("[[:alpha:]]");
   Pattern pattern8("\\w+");
   Pattern pattern9(Matcher::convert("(?u:\\p{L})"));
+  Pattern pattern10("(([^*])*)*?");
+  Pattern pattern11("ab|c");
 
   Matcher matcher(pattern1);
   std::string test;
@@ -351,6 +511,63 @@ int main()
     error("find with nullable results");
   matcher.reset("");
   //
+  banner("TEST FIND COLUMNS");
+  //
+  size_t first[3], size[3], accept[3], lineno[3], columns;
+  matcher.pattern(pattern8);
+  matcher.input("an apple\na day\n\nkeeps");
+  test = "";
+  while ((columns = matcher.find_columns(3, first, size, accept, lineno)) > 0)
+  {
+    for (size_t i = 0; i < columns; ++i)
+      test.append(std::to_string(first[i])).append(",").append(std::to_string(size[i])).append(",").append(std::to_string(accept[i])).append(",").append(std::to_string(lineno[i])).append("/");
+    test.append("|");
+  }
+  std::cout << test << std::endl;
+  if (test != "0,2,1,1/3,5,1,1/9,1,1,2/|11,3,1,2/16,5,1,4/|")
+    error("find columns results");
+  //
+  matcher.pattern(pattern5);
+  matcher.reset("N");
+  matcher.input("a a\nb");
+  test = "";
+  while ((columns = matcher.find_columns(3, first, size, NULL, lineno)) > 0)
+  {
+    for (size_t i = 0; i < columns; ++i)
+      test.append(std::to_string(first[i])).append(",").append(std::to_string(size[i])).append(",").append(std::to_string(lineno[i])).append("/");
+    test.append("|");
+  }
+  std::cout << test << std::endl;
+  if (test != "0,0,1/1,0,1/2,0,1/|3,0,1/4,0,2/|")
+    error("find columns with nullable results");
+  matcher.reset("");
+  // the line numbers of the matches are counted in one pass, also when the buffer shifts and with a list of inputs
+  std::string columns_text;
+  for (int i = 0; i < 1000; ++i)
+    columns_text.append(std::to_string(i)).append(i % 3 != 0 ? " x\n" : "\n\n");
+  std::string columns_expected;
+  for (int j = 0; j < 2; ++j)
+  {
+    Matcher lineno_matcher(pattern8, columns_text);
+    while (lineno_matcher.find())
+      columns_expected.append(std::to_string(j)).append(",").append(std::to_string(lineno_matcher.first())).append(",").append(std::to_string(lineno_matcher.lineno())).append("/");
+  }
+  std::istringstream columns_stream1(columns_text);
+  std::istringstream columns_stream2(columns_text);
+  std::vector<Input> columns_inputs;
+  columns_inputs.push_back(columns_stream1);
+  columns_inputs.push_back(columns_stream2);
+  Matcher columns_matcher(pattern8);
+  columns_matcher.buffer_policy(256);
+  columns_matcher.inputs(columns_inputs);
+  size_t columns_first[7], columns_lineno[7], columns_source[7];
+  test = "";
+  while ((columns = columns_matcher.find_columns(7, columns_first, NULL, NULL, columns_lineno, columns_source)) > 0)
+    for (size_t i = 0; i < columns; ++i)
+      test.append(std::to_string(columns_source[i])).append(",").append(std::to_string(columns_first[i])).append(",").append(std::to_string(columns_lineno[i])).append("/");
+  if (test != columns_expected)
+    error("find columns line numbers");
+  //
   banner("TEST SPLIT");
   //
   matcher.pattern(pattern3);
@@ -461,6 +678,18 @@ int main()
   if (test != "-/")
     error("split results");
   //
+  matcher.pattern(pattern10);
+  matcher.input(",");
+  test = "";
+  while (matcher.split())
+  {
+    std::cout << matcher.text() << "/";
+    test.append(matcher.text()).append("/");
+  }
+  std::cout << std::endl;
+  if (test != "/,//")
+    error("split with nullable results");
+  //
   matcher.pattern(pattern4);
   matcher.input("ab c  d");
   int n = 2; // split 2
@@ -576,6 +805,467 @@ int main()
   if (test != "ä/a/b/ç/c/d/")
     error("wunput");
   //
+  banner("TEST INTERACTIVE");
+  //
+  InteractiveBuffer interactive_buffer("ab");
+  std::istream interactive_stream(&interactive_buffer);
+  matcher.pattern(pattern11);
+  matcher.input(interactive_stream);
+  matcher.interactive();
+  test = "";
+  if (matcher.scan())
+  {
+    std::cout << matcher.text() << "/";
+    test.append(matcher.text()).append("/");
+  }
+  std::cout << std::endl;
+  if (test != "ab/" || interactive_buffer.blocked)
+    error("interactive read ahead");
+  //
+  banner("TEST TABLES");
+  //
+  Pattern pattern12("\"[^\"\\n]*\"|\\w+|\\s");
+  Pattern pattern13("\"[^\"\\n]*\"|abcdefghijklmnopqrstuvwxyz|\\w+|\\s");
+  if (pattern12.explain().find("shuffle DFA") == std::string::npos)
+    error("shuffle DFA expected");
+  if (pattern13.explain().find("compact DFA table") == std::string::npos)
+    error("compact DFA table expected");
+  for (int i = 0; i < 2; ++i)
+  {
+    matcher.pattern(i == 0 ? pattern12 : pattern13);
+    matcher.input("\"a string that is long enough to span more than a couple of SIMD blocks of sixty four bytes\" abcdefghijklmnopqrstuvwxyz\n\"\"");
+    test = "";
+    while (matcher.scan())
+    {
+      std::cout << matcher.accept() << "/";
+      test.append(std::to_string(matcher.accept())).append("/");
+    }
+    std::cout << std::endl;
+    if (test != (i == 0 ? "1/3/2/3/1/" : "1/4/2/4/1/"))
+      error("table skip results");
+    InteractiveBuffer table_buffer("\"abc\"");
+    std::istream table_stream(&table_buffer);
+    matcher.input(table_stream);
+    matcher.interactive();
+    if (matcher.scan() != 1 || table_buffer.blocked)
+      error("table interactive read ahead");
+    matcher.input(",");
+    test = "";
+    while (matcher.split())
+    {
+      std::cout << matcher.text() << "/";
+      test.append(matcher.text()).append("/");
+    }
+    std::cout << std::endl;
+    if (test != ",/")
+      error("table split results");
+  }
+  //
+  banner("TEST EXPLAIN");
+  //
+  // the reported strategy is the search that Matcher::advance() executes, which depends on the SIMD flags of the build,
+  // compile with the same flags as the library, e.g. CXXMFLAGS="-msse2 -DHAVE_SSE2", to check the SIMD strategies
+  const char *strategies[] = {
+    "a",               "strategy:    memchr",
+    "abc",             "strategy:    string search",
+    "\\w+",            "strategy:    predict-match",
+    "a|$",             "strategy:    none",
+#if defined(HAVE_AVX512BW) || defined(HAVE_AVX2) || defined(HAVE_SSE2) || defined(HAVE_NEON)
+    "ab|cd",           "strategy:    needle search for 2 needles",
+#endif
+    NULL, NULL };
+  for (int i = 0; strategies[i] != NULL; i += 2)
+  {
+    std::string report = Pattern(strategies[i]).explain();
+    std::cout << strategies[i] << std::endl << report;
+    if (report.compare(0, strlen(strategies[i + 1]), strategies[i + 1]) != 0)
+      error("explain strategy");
+  }
+  // 16 needles are searched with AVX2 only, SSE2 and non-SIMD builds fall back to bitap
+  std::string report = Pattern("[a-j][k-t][0-9]").explain();
+  std::cout << "[a-j][k-t][0-9]" << std::endl << report;
+#if defined(HAVE_AVX512BW) || defined(HAVE_AVX2)
+  if (report.find(have_HW_AVX2() ? "strategy:    needle search for 16 needles" : "strategy:    bitap over 3 positions") != 0)
+#else
+  if (report.find("strategy:    bitap over 3 positions") != 0)
+#endif
+    error("explain strategy for 16 needles");
+  //
+  banner("TEST BUDGET");
+  //
+  std::istringstream budget_stream("an apple a day keeps the doctor away");
+  matcher.pattern(pattern8);
+  matcher.input(budget_stream);
+  matcher.buffer(4);
+  matcher.budget(8);
+  test = "";
+  int interrupts = 0;
+  while (true)
+  {
+    // find() returns zero when interrupted, a loop over find() ends at an interruption
+    int budget_matches = 0;
+    while (matcher.find())
+    {
+      if (++budget_matches > 100)
+        error("budget loop does not end");
+      std::cout << matcher.text() << "/";
+      test.append(matcher.text()).append("/");
+    }
+    if (!matcher.interrupted())
+      break;
+    if (matcher.size() != 0 || matcher.accept() != Matcher::Const::INTR)
+      error("budget interrupt");
+    ++interrupts;
+    matcher.budget(8);
+  }
+  std::cout << std::endl << "INTERRUPTS = " << interrupts << std::endl;
+  if (test != "an/apple/a/day/keeps/the/doctor/away/" || interrupts == 0)
+    error("budget resume results");
+  // matches() is false when interrupted, the match is retried by the next matches()
+  std::istringstream budget_match_stream("anapple!");
+  matcher.input(budget_match_stream);
+  matcher.buffer(4);
+  matcher.budget(2);
+  if (matcher.matches() || !matcher.interrupted())
+    error("budget matches");
+  matcher.budget(0);
+  if (matcher.matches() || matcher.interrupted())
+    error("budget matches resume");
+  //
+  matcher.input("an apple a day");
+  test = "";
+  if (matcher.find() != 1)
+    error("cancel");
+  test.append(matcher.text()).append("/");
+  matcher.cancel();
+  if (matcher.find() != 0 || !matcher.interrupted() || matcher.find() != 0 || !matcher.interrupted())
+    error("cancel");
+  matcher.cancel(false);
+  while (matcher.find())
+    test.append(matcher.text()).append("/");
+  std::cout << test << std::endl;
+  if (test != "an/apple/a/day/")
+    error("cancel resume results");
+  //
+  banner("TEST INPUTS");
+  //
+  std::istringstream inputs_stream("a\nb");
+  std::vector<Input> inputs;
+  inputs.push_back("");
+  inputs.push_back(inputs_stream);
+  inputs.push_back("");
+  inputs.push_back("");
+  inputs.push_back("c d");
+  inputs.push_back("");
+  matcher.pattern(pattern8);
+  matcher.inputs(inputs);
+  test = "";
+  while (matcher.find())
+  {
+    std::cout << matcher.source() << ":" << matcher.lineno() << ":" << matcher.text() << "/";
+    test.append(std::to_string(matcher.source())).append(":").append(std::to_string(matcher.lineno())).append(":").append(matcher.text()).append("/");
+  }
+  std::cout << std::endl;
+  if (test != "1:1:a/1:2:b/4:1:c/4:1:d/")
+    error("inputs results");
+  // a match never spans two inputs, not even with a small buffer
+  std::istringstream barrier_stream("xxxxab");
+  inputs.clear();
+  inputs.push_back(barrier_stream);
+  inputs.push_back("");
+  inputs.push_back("cd");
+  matcher.pattern(pattern11);
+  matcher.inputs(inputs);
+  matcher.buffer(4);
+  test = "";
+  while (matcher.find())
+  {
+    std::cout << matcher.source() << ":" << matcher.first() << ":" << matcher.text() << "/";
+    test.append(std::to_string(matcher.source())).append(":").append(std::to_string(matcher.first())).append(":").append(matcher.text()).append("/");
+  }
+  std::cout << std::endl;
+  if (test != "0:4:ab/2:0:c/")
+    error("inputs barrier results");
+  Pattern pattern14("b\n?c");
+  matcher.pattern(pattern14);
+  inputs.clear();
+  inputs.push_back("ab");
+  inputs.push_back("cd");
+  matcher.inputs(inputs);
+  if (matcher.find() || matcher.source() != 1)
+    error("inputs match across inputs");
+  matcher.pattern(pattern3);
+  inputs.clear();
+  inputs.push_back("a b");
+  inputs.push_back("");
+  inputs.push_back("c");
+  matcher.inputs(inputs);
+  test = "";
+  while (matcher.split())
+  {
+    std::cout << matcher.source() << ":" << matcher.text() << "/";
+    test.append(std::to_string(matcher.source())).append(":").append(matcher.text()).append("/");
+  }
+  std::cout << std::endl;
+  if (test != "0:a/0:b/1:/2:c/")
+    error("inputs split results");
+  matcher.pattern(pattern8);
+  matcher.inputs(std::vector<Input>());
+  if (matcher.find())
+    error("inputs empty list");
+  //
+  banner("TEST IOVEC");
+  //
+  Pattern pattern15("\\w+|a d|y\\sk");
+  std::string iov_text("an apple a day keeps the doctor away");
+  std::string expected;
+  matcher.pattern(pattern15);
+  matcher.input(iov_text);
+  while (matcher.find())
+    expected.append(matcher.text()).append("/");
+  std::cout << expected << std::endl;
+  // split the text into segments at all pairs of positions, with empty segments
+  for (size_t i = 0; i <= iov_text.size(); ++i)
+  {
+    for (size_t j = i; j <= iov_text.size(); ++j)
+    {
+      iovec iov[5];
+      iov[0].iov_base = &iov_text[0];
+      iov[0].iov_len = i;
+      iov[1].iov_base = &iov_text[0];
+      iov[1].iov_len = 0;
+      iov[2].iov_base = &iov_text[0] + i;
+      iov[2].iov_len = j - i;
+      iov[3].iov_base = &iov_text[0] + j;
+      iov[3].iov_len = iov_text.size() - j;
+      iov[4].iov_base = &iov_text[0];
+      iov[4].iov_len = 0;
+      Input iov_input(iov, 5);
+      if (iov_input.size() != iov_text.size())
+        error("iovec size");
+      matcher.input(iov_input);
+      if (j == i + 1)
+        matcher.buffer(1);
+      test = "";
+      while (matcher.find())
+        test.append(matcher.text()).append("/");
+      if (test != expected)
+        error("iovec results");
+    }
+  }
+  // a match across segments of an input that is larger than the buffer
+  std::string iov_large(Matcher::Const::LARGE + 5, 'x');
+  iov_large[Matcher::Const::LARGE + 4] = 'a';
+  std::string iov_small("b c");
+  iovec iov[3];
+  iov[0].iov_base = &iov_large[0];
+  iov[0].iov_len = iov_large.size();
+  iov[1].iov_base = &iov_small[0];
+  iov[1].iov_len = iov_small.size();
+  iov[2].iov_base = &iov_large[0];
+  iov[2].iov_len = iov_large.size();
+  matcher.pattern(pattern11);
+  matcher.input(Input(iov, 3));
+  test = "";
+  while (matcher.find())
+    test.append(std::to_string(matcher.first())).append(":").append(matcher.text()).append("/");
+  std::cout << test << std::endl;
+  if (test != std::to_string(Matcher::Const::LARGE + 4) + ":ab/" + std::to_string(Matcher::Const::LARGE + 7) + ":c/")
+    error("iovec large results");
+  // large segments are scanned in place, a match across segments is copied to a small buffer
+  std::string iov_seg1, iov_seg2;
+  while (iov_seg1.size() < 8 * Matcher::Const::BLOCK)
+    iov_seg1.append("abc\n");
+  iov_seg1.append("hel");
+  iov_seg2.append("lo\n");
+  while (iov_seg2.size() < 8 * Matcher::Const::BLOCK)
+    iov_seg2.append("abc\n");
+  std::string iov_copy1(iov_seg1), iov_copy2(iov_seg2);
+  iov[0].iov_base = &iov_seg1[0];
+  iov[0].iov_len = iov_seg1.size();
+  iov[1].iov_base = &iov_seg2[0];
+  iov[1].iov_len = iov_seg2.size();
+  size_t iov_memory = Matcher::buffer_memory();
+  {
+    Matcher iov_matcher(pattern15, Input(iov, 2));
+    size_t iov_count = 0, iov_inplace = 0;
+    bool iov_hello = false;
+    while (iov_matcher.find())
+    {
+      ++iov_count;
+      if ((iov_matcher.begin() >= iov_seg1.data() && iov_matcher.end() <= iov_seg1.data() + iov_seg1.size()) ||
+          (iov_matcher.begin() >= iov_seg2.data() && iov_matcher.end() <= iov_seg2.data() + iov_seg2.size()))
+        ++iov_inplace;
+      else if (iov_matcher.str() == "hello")
+        iov_hello = iov_matcher.first() == iov_seg1.size() - 3 && iov_matcher.lineno() == 2 * Matcher::Const::BLOCK + 1 && iov_matcher.columno() == 0;
+      if (Matcher::buffer_memory() - iov_memory > 2 * Matcher::Const::BLOCK)
+        error("iovec in place buffer size");
+    }
+    std::cout << iov_count << " matches, " << iov_inplace << " in place" << std::endl;
+    if (iov_count != 4 * Matcher::Const::BLOCK + 1 || !iov_hello || iov_inplace < 3 * iov_count / 4)
+      error("iovec in place results");
+  }
+  if (iov_seg1 != iov_copy1 || iov_seg2 != iov_copy2)
+    error("iovec in place segments changed");
+  //
+  banner("TEST BUFFER POLICY");
+  //
+  size_t memory = Matcher::buffer_memory();
+  {
+    Matcher policy_matcher(pattern8, "abc");
+    // the default policy selects a small buffer for a short string, BUFSZ for input of unknown size
+    if (policy_matcher.buffer_capacity() != 64 || Matcher::buffer_memory() != memory + 64)
+      error("buffer policy string size");
+    std::string word(10000, 'w');
+    std::istringstream policy_stream1(" " + word + " x");
+    policy_matcher.input(policy_stream1);
+    if (policy_matcher.buffer_capacity() != Matcher::Const::BUFSZ)
+      error("buffer policy stream size");
+    // a match that is larger than the initial buffer grows the buffer by the growth factor
+    for (size_t factor = 2; factor <= 3; ++factor)
+    {
+      std::istringstream policy_stream(" " + word + " x");
+      policy_matcher.buffer_policy(256, 0, factor);
+      policy_matcher.input(policy_stream);
+      if (policy_matcher.buffer_capacity() != 256)
+        error("buffer policy initial size");
+      test = "";
+      while (policy_matcher.find())
+        test.append(std::to_string(policy_matcher.size())).append("/");
+      std::cout << test << " " << policy_matcher.buffer_capacity() << std::endl;
+      if (test != "10000/1/" || policy_matcher.buffer_capacity() != (factor == 2 ? 16384 : 20736))
+        error("buffer policy growth");
+      if (Matcher::buffer_memory() != memory + policy_matcher.buffer_capacity())
+        error("buffer policy memory");
+    }
+    // a match that does not fit the max buffer size throws std::bad_alloc
+    std::istringstream policy_stream2(" " + word + " x");
+    policy_matcher.buffer_policy(256, 8192);
+    policy_matcher.input(policy_stream2);
+    bool thrown = false;
+    try
+    {
+      while (policy_matcher.find())
+        continue;
+    }
+    catch (const std::bad_alloc&)
+    {
+      thrown = true;
+    }
+    if (!thrown || policy_matcher.buffer_capacity() != 8192)
+      error("buffer policy max size");
+    // huge page buffers are multiples of Const::LARGE
+    std::string large(Matcher::Const::LARGE + 100, 'x');
+    policy_matcher.buffer_policy(0, 0, 2, true);
+    policy_matcher.input(large);
+    if (policy_matcher.buffer_capacity() != Matcher::Const::LARGE)
+      error("buffer policy huge size");
+    if (policy_matcher.find() != 1 || policy_matcher.size() != large.size() || policy_matcher.buffer_capacity() != 2 * Matcher::Const::LARGE)
+      error("buffer policy huge growth");
+    if (Matcher::buffer_memory() != memory + policy_matcher.buffer_capacity())
+      error("buffer policy huge memory");
+    // alternating large and small inputs of an inputs() list keep the buffer, input() shrinks it
+    std::string megabyte(1024 * 1024, 'x');
+    std::vector<Input> alternating;
+    for (int i = 0; i < 4; ++i)
+    {
+      alternating.push_back(megabyte);
+      alternating.push_back("abc");
+    }
+    policy_matcher.buffer_policy(0);
+    policy_matcher.inputs(alternating);
+    size_t capacity = 0;
+    size_t count = 0;
+    while (policy_matcher.find())
+    {
+      if (policy_matcher.source() == 0)
+        capacity = policy_matcher.buffer_capacity();
+      else if (policy_matcher.buffer_capacity() != capacity)
+        error("buffer policy inputs kept");
+      ++count;
+    }
+    if (count != 8 || capacity < megabyte.size())
+      error("buffer policy inputs");
+    policy_matcher.input("abc");
+    if (policy_matcher.buffer_capacity() != 64)
+      error("buffer policy input shrink");
+    if (Matcher::buffer_memory() != memory + 64)
+      error("buffer policy shrink memory");
+  }
+  if (Matcher::buffer_memory() != memory)
+    error("buffer policy memory released");
+  //
+  banner("TEST ASYNC");
+  //
+  Pattern pattern16("(?m)\\w+$|\\w+|\\s");
+  const char *async_texts[] = { "\"a b\" c\n\"\"  de", "ab c\ndef \n", "", NULL };
+  const Pattern *async_patterns[] = { &pattern12, &pattern16, &pattern3, NULL };
+  const int async_methods[] = { Matcher::Const::SCAN, Matcher::Const::FIND, Matcher::Const::SPLIT };
+  for (int i = 0; async_patterns[i] != NULL; ++i)
+  {
+    for (int j = 0; async_texts[j] != NULL; ++j)
+    {
+      for (int k = 0; k < 3; ++k)
+      {
+        matcher.pattern(*async_patterns[i]);
+        matcher.input(async_texts[j]);
+        std::string expected = match_results(matcher, async_methods[k]);
+        for (size_t chunk = 1; chunk <= 4; ++chunk)
+        {
+          AsyncMatcher<> async_matcher(*async_patterns[i]);
+          test = async_results(async_matcher, async_texts[j], chunk, async_methods[k]);
+          if (test != expected)
+          {
+            std::cout << expected << std::endl << test << std::endl;
+            error("async results");
+          }
+        }
+      }
+    }
+  }
+  // a long token fed in small chunks: the suspended match resumes where it stopped instead of rescanning the token from its start
+  const char *long_regex[] = { "\\w+|\\s", "a{20}|\\w+|\\s", "\\w+(?=;)|\\w+|\\s", ";", NULL };
+  std::string long_text(1 << 20, 'x');
+  long_text.append(" y");
+  for (int i = 0; long_regex[i] != NULL; ++i)
+  {
+    Pattern long_pattern(long_regex[i]);
+    int method = i == 3 ? Matcher::Const::SPLIT : Matcher::Const::SCAN;
+    matcher.pattern(long_pattern);
+    matcher.input(long_text);
+    std::string expected = match_results(matcher, method);
+    AsyncMatcher<> async_matcher(long_pattern);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    test = async_results(async_matcher, long_text, 64, method);
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << long_regex[i] << " " << elapsed << "s" << std::endl;
+    if (test != expected)
+      error("async long token results");
+    if (elapsed > 2.0)
+      error("async long token time");
+  }
+#ifdef REFLEX_ASYNC_COROUTINES
+  for (size_t chunk = 1; chunk <= 4; ++chunk)
+  {
+    matcher.pattern(pattern12);
+    matcher.input(async_texts[0]);
+    std::string expected = match_results(matcher, Matcher::Const::SCAN).append("$");
+    AsyncMatcher<> async_matcher(pattern12);
+    test = "";
+    async_scan_results(async_matcher, test);
+    for (const char *s = async_texts[0]; *s != '\0'; s += std::min(chunk, std::strlen(s)))
+    {
+      if (test.find('$') != std::string::npos)
+        error("async coroutine completed early");
+      async_matcher.feed(s, std::min(chunk, std::strlen(s)));
+    }
+    async_matcher.close();
+    std::cout << test << std::endl;
+    if (test != expected)
+      error("async coroutine results");
+  }
+#endif
+  //
   banner("TEST WRAP");
   //
   WrappedMatcher wrapped_matcher;
@@ -0,0 +1,103 @@
+// Benchmark std::istream::read() and std::getline() throughput of the
+// reflex::Input stream buffers
+//
+// > make -f Make sbench
+// > ./sbench [MB]
+
+#include <reflex/input.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+static double now()
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+template<typename S>
+static void bench(const char *name, const std::string& data)
+{
+  char block[65536];
+  std::string line;
+  size_t n = 0;
+  double t0 = now();
+  {
+    reflex::Input input(data);
+    S streambuf(input);
+    std::istream stream(&streambuf);
+    while (stream.read(block, sizeof(block)) || stream.gcount() > 0)
+      n += static_cast<size_t>(stream.gcount());
+  }
+  double t1 = now();
+  size_t k = 0;
+  {
+    reflex::Input input(data);
+    S streambuf(input);
+    std::istream stream(&streambuf);
+    while (std::getline(stream, line))
+      ++k;
+  }
+  double t2 = now();
+  double mb = static_cast<double>(data.size()) / 1e6;
+  printf("%-36s read %8.1f MB/s  getline %8.1f MB/s  (%zu bytes, %zu lines)\n", name, mb / (t1 - t0), mb / (t2 - t1), n, k);
+}
+
+static void bench_dos(const std::string& data)
+{
+  char block[65536];
+  size_t n = 0;
+  double t0 = now();
+  reflex::Input input(data);
+  input.dos(true);
+  size_t k;
+  while ((k = input.get(block, sizeof(block))) > 0)
+    n += k;
+  double t1 = now();
+  double mb = static_cast<double>(data.size()) / 1e6;
+  printf("%-36s get  %8.1f MB/s  (%zu bytes)\n", "reflex::Input::dos(true)", mb / (t1 - t0), n);
+}
+
+static void bench_utf8(const char *name, const std::string& data, reflex::Input::utf8_validation_type mode)
+{
+  char block[65536];
+  size_t n = 0;
+  double t0 = now();
+  reflex::Input input(data);
+  input.utf8_validation(mode);
+  size_t k;
+  while ((k = input.get(block, sizeof(block))) > 0)
+    n += k;
+  double t1 = now();
+  double mb = static_cast<double>(data.size()) / 1e6;
+  printf("%-36s get  %8.1f MB/s  (%zu bytes)\n", name, mb / (t1 - t0), n);
+}
+
+int main(int argc, char **argv)
+{
+  size_t size = (argc > 1 ? static_cast<size_t>(atoi(argv[1])) : 64) * 1000000;
+  std::string data;
+  data.reserve(size);
+  srand(1);
+  while (data.size() < size)
+  {
+    size_t len = rand() % 120;
+    for (size_t i = 0; i < len; ++i)
+      data.push_back(static_cast<char>('a' + rand() % 26));
+    data.append("\r\n");
+  }
+  bench<reflex::Input::streambuf>("reflex::Input::streambuf", data);
+  bench<reflex::Input::dos_streambuf>("reflex::Input::dos_streambuf", data);
+  bench<reflex::BufferedInput::streambuf>("reflex::BufferedInput::streambuf", data);
+  bench<reflex::BufferedInput::dos_streambuf>("reflex::BufferedInput::dos_streambuf", data);
+  bench_dos(data);
+  // UTF-8 text with 2, 3 and 4 byte sequences
+  std::string text;
+  text.reserve(size);
+  static const char *words[] = { "text ", "caf\xc3\xa9 ", "\xe2\x82\xac ", "\xf0\x9f\x98\x80 ", "na\xc3\xafve ", "\xce\xb1\xce\xb2\xce\xb3 " };
+  while (text.size() < size)
+    text.append(words[rand() % 6]);
+  bench_utf8("reflex::Input get", text, reflex::Input::utf8_validation::none);
+  bench_utf8("reflex::Input utf8_validation report", text, reflex::Input::utf8_validation::report);
+  bench_utf8("reflex::Input utf8_validation repair", text, reflex::Input::utf8_validation::repair);
+  return 0;
+}
@@ -1,4 +1,7 @@
 #include <reflex/input.h>
+#ifndef _WIN32
+#include <unistd.h>
+#endif
 
 void make_streambuf1(reflex::Input& input, size_t size);
 void make_streambuf2(reflex::Input& input, size_t size);
@@ -8,6 +11,11 @@ void make_buffered_streambuf1(reflex::Input& input, size_t size);
 void make_buffered_streambuf2(reflex::Input& input, size_t size);
 void make_buffered_dos_streambuf1(reflex::Input& input, size_t size);
 void make_buffered_dos_streambuf2(reflex::Input& input, size_t size);
+void make_pipe_streambufs();
+void test_dos_get();
+void test_file_encodings();
+void test_wstring_encodings();
+void test_utf8_validation();
 
 int main()
 {
@@ -93,6 +101,21 @@ int main()
   std::cout << "\nFile converted from UTF-16 to UTF-8 by std::istream(reflex::BufferedInput::streambuf*)" << std::endl;
   fclose(fd);
 
+  // test CRLF to LF replacement by Input::get() with CRLF pairs split across blocks
+  test_dos_get();
+
+  // test FILE* conversion to UTF-8 and size() with UTF-8 sequences split across get() calls
+  test_file_encodings();
+
+  // test wide string conversion to UTF-8, size() and the wcs() round trip with surrogates and invalid code points
+  test_wstring_encodings();
+
+  // test UTF-8 validation with invalid and truncated UTF-8 sequences split across blocks
+  test_utf8_validation();
+
+  // test that reading lines from a pipe that is kept open does not block
+  make_pipe_streambufs();
+
   // done
   exit(EXIT_SUCCESS);
 }
@@ -231,3 +254,323 @@ void make_buffered_dos_streambuf2(reflex::Input& input, size_t size)
   }
 }
 
+
+#ifndef _WIN32
+// stream buffer that reads a file descriptor with read(), which returns the bytes available in a pipe
+class fd_streambuf : public std::streambuf {
+ public:
+  explicit fd_streambuf(int fd)
+    :
+      fd_(fd)
+  {
+    setg(buf_, buf_, buf_);
+  }
+ protected:
+  virtual int_type underflow()
+  {
+    if (gptr() < egptr())
+      return traits_type::to_int_type(*gptr());
+    ssize_t n = read(fd_, buf_, sizeof(buf_));
+    if (n <= 0)
+      return traits_type::eof();
+    setg(buf_, buf_, buf_ + n);
+    return traits_type::to_int_type(*gptr());
+  }
+  int  fd_;
+  char buf_[256];
+};
+#endif
+
+void make_pipe_streambufs()
+{
+#ifndef _WIN32
+  // fail instead of blocking forever when a streambuf reads ahead
+  alarm(10);
+  int fds[2];
+  if (pipe(fds) != 0)
+    exit(EXIT_FAILURE);
+  FILE *fd = fdopen(fds[0], "r");
+  if (fd == NULL || write(fds[1], "line1\nline2\r\n", 14) != 14)
+    exit(EXIT_FAILURE);
+  reflex::Input input(fd);
+  reflex::Input::streambuf sb(input);
+  std::istream is(&sb);
+  std::string line;
+  if (!std::getline(is, line) || line != "line1")
+  {
+    std::cerr << "Failed reflex::Input::streambuf pipe getline()" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  // a new Input object, because the first Input object holds back the first byte read from the FILE*
+  reflex::Input dinput(fd);
+  reflex::Input::dos_streambuf dsb(dinput);
+  std::istream dis(&dsb);
+  if (!std::getline(dis, line) || line != "line2")
+  {
+    std::cerr << "Failed reflex::Input::dos_streambuf pipe getline()" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  // a std::istream over the pipe, reading only the bytes available like std::cin does
+  fd_streambuf fsb(fds[0]);
+  std::istream fis(&fsb);
+  if (write(fds[1], "line3\n", 6) != 6)
+    exit(EXIT_FAILURE);
+  reflex::Input sinput(fis);
+  reflex::Input::streambuf ssb(sinput);
+  std::istream sis(&ssb);
+  if (!std::getline(sis, line) || line != "line3")
+  {
+    std::cerr << "Failed reflex::Input::streambuf std::istream pipe getline()" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  if (write(fds[1], "line4\r\n", 7) != 7)
+    exit(EXIT_FAILURE);
+  reflex::Input dsinput(fis);
+  reflex::Input::dos_streambuf dssb(dsinput);
+  std::istream dsis(&dssb);
+  if (!std::getline(dsis, line) || line != "line4")
+  {
+    std::cerr << "Failed reflex::Input::dos_streambuf std::istream pipe getline()" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  alarm(0);
+  close(fds[1]);
+  fclose(fd);
+#endif
+}
+
+void test_dos_get()
+{
+  std::string text("\r\na\r\r\nb\rc\n\r\n\r\r");
+  for (int i = 0; i < 3; ++i)
+    text.append("0123456789abcd\r\n0123456789abcde\r\n0123456789abcdef\r\r\n");
+  text.append("\r");
+  // expected: CRLF replaced by LF, other CR kept
+  std::string expected;
+  for (size_t i = 0; i < text.size(); ++i)
+    if (text[i] != '\r' || i + 1 == text.size() || text[i + 1] != '\n')
+      expected.push_back(text[i]);
+  // read in blocks of n bytes, so that CRLF pairs are split across blocks at all positions
+  for (size_t n = 1; n <= 40; ++n)
+  {
+    reflex::Input input(text);
+    input.dos(true);
+    std::string result;
+    char buf[40];
+    size_t k;
+    while ((k = input.get(buf, n)) > 0)
+      result.append(buf, k);
+    if (result != expected)
+    {
+      std::cerr << "Failed reflex::Input::get() with dos(true) block size=" << n << std::endl;
+      exit(EXIT_FAILURE);
+    }
+  }
+}
+
+void test_file_encodings()
+{
+  // BOM and "abcd" followed by "A\u00E9\u20AC\U0001F600\n" repeated, so that the 16K blocks of size() split the converted units
+  std::string utf16be("\xFE\xFF\0a\0b\0c\0d", 10);
+  std::string utf16le("\xFF\xFE" "a\0b\0c\0d\0", 10);
+  std::string utf32be("\0\0\xFE\xFF\0\0\0a\0\0\0b\0\0\0c\0\0\0d", 20);
+  std::string utf32le("\xFF\xFE\0\0a\0\0\0b\0\0\0c\0\0\0d\0\0\0", 20);
+  std::string utf8("abcd");
+  for (int i = 0; i < 2000; ++i)
+  {
+    utf16be.append("\0A\0\xE9\x20\xAC\xD8\x3D\xDE\x00\0\n", 12);
+    utf16le.append("A\0\xE9\0\xAC\x20\x3D\xD8\x00\xDE\n\0", 12);
+    utf32be.append("\0\0\0A\0\0\0\xE9\0\0\x20\xAC\0\x01\xF6\x00\0\0\0\n", 20);
+    utf32le.append("A\0\0\0\xE9\0\0\0\xAC\x20\0\0\x00\xF6\x01\0\n\0\0\0", 20);
+    utf8.append("A\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80\n");
+  }
+  // "abcd" followed by "A\u00E9\u00FF\n" or "A\u20AC\u00E9\n" in CP 1252 repeated
+  std::string latin("abcd");
+  std::string cp1252("abcd");
+  std::string latin_utf8("abcd");
+  std::string cp1252_utf8("abcd");
+  for (int i = 0; i < 10000; ++i)
+  {
+    latin.append("A\xE9\xFF\n");
+    cp1252.append("A\x80\xE9\n");
+    latin_utf8.append("A\xC3\xA9\xC3\xBF\n");
+    cp1252_utf8.append("A\xE2\x82\xAC\xC3\xA9\n");
+  }
+  const std::string *texts[] = { &utf16be, &utf16le, &utf32be, &utf32le, &latin, &cp1252 };
+  const std::string *expected[] = { &utf8, &utf8, &utf8, &utf8, &latin_utf8, &cp1252_utf8 };
+  const reflex::Input::file_encoding_type encodings[] = {
+    reflex::Input::file_encoding::utf16be,
+    reflex::Input::file_encoding::utf16le,
+    reflex::Input::file_encoding::utf32be,
+    reflex::Input::file_encoding::utf32le,
+    reflex::Input::file_encoding::latin,
+    reflex::Input::file_encoding::cp1252,
+  };
+  for (int i = 0; i < 6; ++i)
+  {
+    FILE *fd = tmpfile();
+    if (fd == NULL || fwrite(texts[i]->data(), 1, texts[i]->size(), fd) != texts[i]->size())
+      exit(EXIT_FAILURE);
+    // read with get() of 1 and 3 bytes, check size() against the number of bytes that remain to be returned
+    for (size_t n = 1; n <= 3; n += 2)
+    {
+      rewind(fd);
+      reflex::Input input(fd, encodings[i]);
+      std::string result;
+      char buf[3];
+      size_t k;
+      while (true)
+      {
+        if (input.size() != expected[i]->size() - result.size())
+        {
+          std::cerr << "Failed reflex::Input::size() of FILE* with encoding " << encodings[i] << " get() size=" << n << " at " << result.size() << std::endl;
+          exit(EXIT_FAILURE);
+        }
+        if ((k = input.get(buf, n)) == 0)
+          break;
+        result.append(buf, k);
+      }
+      if (result != *expected[i])
+      {
+        std::cerr << "Failed reflex::Input::get() of FILE* with encoding " << encodings[i] << " get() size=" << n << std::endl;
+        exit(EXIT_FAILURE);
+      }
+    }
+    fclose(fd);
+  }
+}
+
+void test_wstring_encodings()
+{
+  // wide characters, their UTF-8 and the wide characters that wcs() returns for that UTF-8
+  std::wstring nonchar;
+  for (const char *p = REFLEX_NONCHAR_UTF8; *p != '\0'; )
+  {
+    int c = reflex::utf8(p, &p);
+    nonchar.push_back(static_cast<wchar_t>(sizeof(wchar_t) == 2 && c > 0xFFFF ? 0xFFFD : c));
+  }
+  const wchar_t pair[] = { static_cast<wchar_t>(0xD83D), static_cast<wchar_t>(0xDE00), 0 };
+  const wchar_t high[] = { static_cast<wchar_t>(0xD83D), L'b', 0 };
+  const wchar_t low[] = { static_cast<wchar_t>(0xDE00), 0 };
+  const wchar_t big[] = { static_cast<wchar_t>(sizeof(wchar_t) == 2 ? 0xDFFF : 0x110000), 0 };
+  const wchar_t max[] = { static_cast<wchar_t>(sizeof(wchar_t) == 2 ? 0xDC00 : 0x7FFFFFFF), 0 };
+  const std::wstring smiley = sizeof(wchar_t) == 2 ? std::wstring(pair) : std::wstring(1, static_cast<wchar_t>(0x1F600));
+  struct { std::wstring wide; std::string utf8; std::wstring back; } pieces[] = {
+    { L"a", "a", L"a" },
+    { L"abcdefghijklmnopqrstuvwxyz", "abcdefghijklmnopqrstuvwxyz", L"abcdefghijklmnopqrstuvwxyz" },
+    { std::wstring(1, static_cast<wchar_t>(0xE9)), "\xC3\xA9", std::wstring(1, static_cast<wchar_t>(0xE9)) },
+    { std::wstring(1, static_cast<wchar_t>(0x20AC)), "\xE2\x82\xAC", std::wstring(1, static_cast<wchar_t>(0x20AC)) },
+    { pair, "\xF0\x9F\x98\x80", smiley },
+    { high, REFLEX_NONCHAR_UTF8 "b", nonchar + L"b" },
+    { low, REFLEX_NONCHAR_UTF8, nonchar },
+    { big, REFLEX_NONCHAR_UTF8, nonchar },
+    { max, REFLEX_NONCHAR_UTF8, nonchar },
+  };
+  const size_t npieces = sizeof(pieces) / sizeof(pieces[0]);
+  std::wstring wide;
+  std::string utf8;
+  std::wstring back;
+  unsigned int seed = 1;
+  for (int i = 0; i < 3000; ++i)
+  {
+    seed = seed * 1103515245 + 12345;
+    size_t j = (seed >> 16) % npieces;
+    // a lone low surrogate after a lone high surrogate at the end would make a pair
+    if (j == 6 && !wide.empty() && (wide[wide.size() - 1] & 0xFC00) == 0xD800)
+      j = 0;
+    wide.append(pieces[j].wide);
+    utf8.append(pieces[j].utf8);
+    back.append(pieces[j].back);
+  }
+  // a lone high surrogate at the end
+  wide.push_back(static_cast<wchar_t>(0xD83D));
+  utf8.append(REFLEX_NONCHAR_UTF8);
+  back.append(nonchar);
+  // read in small blocks, check size() against the number of bytes that remain to be returned
+  const size_t sizes[] = { 1, 2, 3, 4, 5, 7, 16, 64, 0 };
+  for (int i = 0; sizes[i] != 0; ++i)
+  {
+    reflex::Input input(wide);
+    std::string result;
+    char buf[64];
+    size_t k;
+    while (true)
+    {
+      if (input.size() != utf8.size() - result.size())
+      {
+        std::cerr << "Failed reflex::Input::size() of std::wstring get() size=" << sizes[i] << " at " << result.size() << std::endl;
+        exit(EXIT_FAILURE);
+      }
+      if ((k = input.get(buf, sizes[i])) == 0)
+        break;
+      result.append(buf, k);
+    }
+    if (result != utf8)
+    {
+      std::cerr << "Failed reflex::Input::get() of std::wstring get() size=" << sizes[i] << std::endl;
+      exit(EXIT_FAILURE);
+    }
+  }
+  if (reflex::wcs(utf8) != back)
+  {
+    std::cerr << "Failed reflex::wcs() round trip" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+}
+
+void test_utf8_validation()
+{
+  // UTF-8 sequences and their repair, with "\xEF\xBF\xBD" the UTF-8 of U+FFFD
+  const char *seqs[] = {
+    "\xE2\x82\xAC",     "\xE2\x82\xAC",
+    "\xF0\x9F\x98\x80", "\xF0\x9F\x98\x80",
+    "\x80",             "\xEF\xBF\xBD",
+    "\xE2\x82",         "\xEF\xBF\xBD",
+    "\xF0\x9F\x98",     "\xEF\xBF\xBD",
+    "\xC0\xAF",         "\xEF\xBF\xBD\xEF\xBF\xBD",
+    "\xED\xA0\x80",     "\xEF\xBF\xBD\xEF\xBF\xBD\xEF\xBF\xBD",
+    "\xF4\x90\x80\x80", "\xEF\xBF\xBD\xEF\xBF\xBD\xEF\xBF\xBD\xEF\xBF\xBD",
+    NULL, NULL };
+  const size_t sizes[] = { 1, 5, 31, 32, 33, 64, 4096, 0 };
+  for (int i = 0; seqs[i] != NULL; i += 2)
+  {
+    std::string seq(seqs[i]);
+    std::string rep(seqs[i + 1]);
+    // place the sequence before, across and after the 32 byte block boundary, followed by ASCII or at the end
+    for (size_t pad = 24; pad <= 40; ++pad)
+    {
+      for (int end = 0; end < 2; ++end)
+      {
+        std::string post(end ? "" : "x0123456789abcdefghijklmnopqrstuvwxyz0123456789");
+        std::string text = std::string(pad, 'a') + seq + post;
+        std::string expected = std::string(pad, 'a') + rep + post;
+        size_t error = seq == rep ? reflex::Input::npos : pad;
+        for (int j = 0; sizes[j] != 0; ++j)
+        {
+          char buf[4096];
+          size_t k;
+          reflex::Input input(text);
+          input.utf8_validation(reflex::Input::utf8_validation::report);
+          std::string result;
+          while ((k = input.get(buf, sizes[j])) > 0)
+            result.append(buf, k);
+          if (result != text || input.utf8_error() != error)
+          {
+            std::cerr << "Failed reflex::Input::get() with utf8_validation::report sequence=" << i / 2 << " offset=" << pad << " block size=" << sizes[j] << std::endl;
+            exit(EXIT_FAILURE);
+          }
+          input = text;
+          input.utf8_validation(reflex::Input::utf8_validation::repair);
+          result.clear();
+          while ((k = input.get(buf, sizes[j])) > 0)
+            result.append(buf, k);
+          if (result != expected)
+          {
+            std::cerr << "Failed reflex::Input::get() with utf8_validation::repair sequence=" << i / 2 << " offset=" << pad << " block size=" << sizes[j] << std::endl;
+            exit(EXIT_FAILURE);
+          }
+        }
+      }
+    }
+  }
+}